@@ -37,6 +37,7 @@ endif
 libc-$(CONFIG_LP_ARCH_X86_32)  += head.S
 libc-$(CONFIG_LP_ARCH_X86_64)  += head_64.S
 libc-$(CONFIG_LP_ARCH_X86_64) += pt.S
+libc-$(CONFIG_LP_ARCH_X86_64) += mmu.c
 libc-y += main.c sysinfo.c
 libc-y += timer.c coreboot.c util.S
 libc-y += virtual.c
@@ -29,6 +29,7 @@
 #include <exception.h>
 #include <libpayload.h>
 #include <arch/apic.h>
+#include <arch/mmu.h>
 
 int main_argc;    /**< The argc value to pass to main() */
 
@@ -47,6 +48,9 @@ int start_main(void)
 	/* Gather system information. */
 	lib_get_sysinfo();
 
+	/* Before the consoles, so a framebuffer console is drawn through WC already. */
+	mmu_init();
+
 	/* Optionally set up the consoles. */
 #if !CONFIG(LP_SKIP_CONSOLE_INIT)
 	console_init();
@@ -0,0 +1,195 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+
+#include <arch/cache.h>
+#include <arch/cpuid.h>
+#include <arch/mmu.h>
+#include <arch/msr.h>
+#include <libpayload.h>
+
+#define IA32_PAT		0x277
+
+/* PAT encodings */
+#define PAT_UC			0
+#define PAT_WC			1
+#define PAT_WT			4
+#define PAT_WP			5
+#define PAT_WB			6
+#define PAT_UC_MINUS		7
+
+/*
+ * Entries 0-3 are what the PWT and PCD bits select on their own, so they keep their reset
+ * values except for entry 1 which becomes WC. Entry 7 provides WT.
+ */
+#define PAT_VALUE(t0, t1, t2, t3, t4, t5, t6, t7) \
+	((u64)(t0) << 0 | (u64)(t1) << 8 | (u64)(t2) << 16 | (u64)(t3) << 24 | \
+	 (u64)(t4) << 32 | (u64)(t5) << 40 | (u64)(t6) << 48 | (u64)(t7) << 56)
+#define PAT_SETUP \
+	PAT_VALUE(PAT_WB, PAT_WC, PAT_UC_MINUS, PAT_UC, PAT_WB, PAT_WP, PAT_UC_MINUS, PAT_WT)
+
+#define PTE_PRES		(1ULL << 0)
+#define PTE_RW			(1ULL << 1)
+#define PTE_US			(1ULL << 2)
+#define PTE_PWT			(1ULL << 3)
+#define PTE_PCD			(1ULL << 4)
+#define PTE_A			(1ULL << 5)
+#define PTE_PS			(1ULL << 7)
+#define PTE_PAT_4K		(1ULL << 7)
+#define PTE_PAT_LARGE		(1ULL << 12)
+#define PTE_ADDR_MASK		0x000ffffffffff000ULL
+
+/* Same attributes as the tables set up by pt.S */
+#define PTE_TABLE		(PTE_PRES | PTE_RW | PTE_US | PTE_A)
+
+#define PAGE_SHIFT		12
+#define PAGE_SIZE		(1ULL << PAGE_SHIFT)
+#define TABLE_SHIFT		9
+#define TABLE_ENTRIES		(1 << TABLE_SHIFT)
+#define PML4_SHIFT		39
+
+/* From pt.S, only the first PML4 entry is in use. */
+extern u64 pml4e[];
+
+static bool pat_ready;
+
+static bool pat_init(void)
+{
+	if (pat_ready)
+		return true;
+
+	if (!(cpuid_edx(1) & (1 << 16))) {
+		printf("MMU: CPU has no PAT, can't change memory types\n");
+		return false;
+	}
+
+	/* Nothing is mapped with PWT, PCD or PAT set yet, so this doesn't alias. */
+	dcache_clean_invalidate_all();
+	_wrmsr(IA32_PAT, PAT_SETUP);
+	pat_ready = true;
+
+	return true;
+}
+
+static u64 memory_type_bits(enum mmu_memory_type type, bool large)
+{
+	const u64 pat = large ? PTE_PAT_LARGE : PTE_PAT_4K;
+
+	switch (type) {
+	case MMU_MEMORY_WC:
+		return PTE_PWT;			/* PAT entry 1 */
+	case MMU_MEMORY_UC:
+		return PTE_PCD | PTE_PWT;	/* PAT entry 3 */
+	case MMU_MEMORY_WT:
+		return pat | PTE_PCD | PTE_PWT;	/* PAT entry 7 */
+	case MMU_MEMORY_WB:
+	default:
+		return 0;
+	}
+}
+
+static void flush_tlb(void)
+{
+	unsigned long cr3;
+
+	asm volatile("mov %%cr3, %0" : "=r" (cr3));
+	asm volatile("mov %0, %%cr3" : : "r" (cr3) : "memory");
+}
+
+/*
+ * Replace the large page mapped by `entry` with a table of pages 1/512 of its size,
+ * keeping the memory type and the other attributes.
+ */
+static int split_large_page(u64 *entry, unsigned int shift)
+{
+	const unsigned int child_shift = shift - TABLE_SHIFT;
+	const bool child_large = child_shift > PAGE_SHIFT;
+	const u64 base = *entry & PTE_ADDR_MASK & ~PTE_PAT_LARGE;
+	u64 attrs = *entry & ~PTE_ADDR_MASK;
+	u64 *table;
+	int i;
+
+	table = memalign(PAGE_SIZE, PAGE_SIZE);
+	if (!table)
+		return -1;
+
+	if (!child_large) {
+		attrs &= ~PTE_PS;
+		if (*entry & PTE_PAT_LARGE)
+			attrs |= PTE_PAT_4K;
+	} else if (*entry & PTE_PAT_LARGE) {
+		attrs |= PTE_PAT_LARGE;
+	}
+
+	for (i = 0; i < TABLE_ENTRIES; i++)
+		table[i] = (base + ((u64)i << child_shift)) | attrs;
+
+	*entry = virt_to_phys(table) | PTE_TABLE;
+
+	return 0;
+}
+
+static int update_table(u64 *table, size_t num_entries, unsigned int shift,
+			u64 start, u64 end, enum mmu_memory_type type)
+{
+	const u64 entry_size = 1ULL << shift;
+	u64 addr = start;
+
+	while (addr < end) {
+		const size_t index = (addr >> shift) % TABLE_ENTRIES;
+		const u64 entry_base = ALIGN_DOWN(addr, entry_size);
+		const u64 chunk_end = MIN(end, entry_base + entry_size);
+		u64 *entry = &table[index];
+
+		if (index >= num_entries || !(*entry & PTE_PRES))
+			return -1;
+
+		if (shift == PAGE_SHIFT || (*entry & PTE_PS)) {
+			const bool large = shift != PAGE_SHIFT;
+
+			if (addr == entry_base && chunk_end == entry_base + entry_size) {
+				*entry &= ~memory_type_bits(MMU_MEMORY_WT, large);
+				*entry |= memory_type_bits(type, large);
+				addr = chunk_end;
+				continue;
+			}
+			if (split_large_page(entry, shift))
+				return -1;
+		}
+
+		if (update_table(phys_to_virt(*entry & PTE_ADDR_MASK), TABLE_ENTRIES,
+				 shift - TABLE_SHIFT, addr, chunk_end, type))
+			return -1;
+		addr = chunk_end;
+	}
+
+	return 0;
+}
+
+int mmu_set_memory_type(u64 base, u64 size, enum mmu_memory_type type)
+{
+	const u64 start = ALIGN_DOWN(base, PAGE_SIZE);
+	const u64 end = ALIGN_UP(base + size, PAGE_SIZE);
+	int ret;
+
+	if (!size || end < start || !pat_init())
+		return -1;
+
+	ret = update_table(pml4e, 1, PML4_SHIFT, start, end, type);
+
+	/* Lines cached under the old type must not linger in the caches. */
+	flush_tlb();
+	dcache_clean_invalidate_all();
+
+	return ret;
+}
+
+void mmu_init(void)
+{
+	const struct cb_framebuffer *fb = &lib_sysinfo.framebuffer;
+
+	if (!CONFIG(LP_X86_FRAMEBUFFER_WC) || !fb->physical_address)
+		return;
+
+	if (mmu_set_memory_type(fb->physical_address,
+				(u64)fb->bytes_per_line * fb->y_resolution, MMU_MEMORY_WC))
+		printf("MMU: Failed to map the framebuffer write-combining\n");
+}
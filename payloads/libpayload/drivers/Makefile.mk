@@ -87,6 +87,9 @@ libc-$(CONFIG_LP_STORAGE) += storage/storage.c
 libc-$(CONFIG_LP_STORAGE_AHCI) += storage/ahci.c
 libc-$(CONFIG_LP_STORAGE_AHCI) += storage/ahci_common.c
 libc-$(CONFIG_LP_STORAGE_NVME) += storage/nvme.c
+libc-$(CONFIG_LP_STORAGE_VIRTIO) += storage/virtio_pci.c
+libc-$(CONFIG_LP_STORAGE_VIRTIO_BLK) += storage/virtio_blk.c
+libc-$(CONFIG_LP_STORAGE_VIRTIO_SCSI) += storage/virtio_scsi.c
 ifeq ($(CONFIG_LP_STORAGE_ATA),y)
 libc-$(CONFIG_LP_STORAGE_ATA) += storage/ata.c
 libc-$(CONFIG_LP_STORAGE_ATA) += storage/ahci_ata.c
@@ -97,57 +97,69 @@ int ahci_error_recovery(ahci_dev_t *const dev, const u32 intr_status)
 		return -1;
 }
 
-static int ahci_dev_init(hba_ctrl_t *const ctrl,
-			 hba_port_t *const port,
-			 const int portnum)
+static void ahci_dev_free(ahci_dev_t *const dev)
 {
-	int ret = 1;
+	/* Only free if stopping succeeds, since otherwise the controller may
+	   still use the resources for DMA. */
+	if (!ahci_cmdengine_stop(dev->port)) {
+		dev->port->cmdlist_base = 0;
+		dev->port->frameinfo_base = 0;
+		if (dev->rcvd_fis)
+			free((void *)dev->rcvd_fis);
+		if (dev->cmdtable)
+			free((void *)dev->cmdtable);
+		if (dev->cmdlist)
+			free((void *)dev->cmdlist);
+	}
+	free(dev);
+}
 
+/** Set up the port's DMA structures and start its command engine. */
+static ahci_dev_t *ahci_dev_alloc(hba_ctrl_t *const ctrl,
+				  hba_port_t *const port)
+{
 	const int ncs = HBA_CAPS_DECODE_NCS(ctrl->caps);
 
 	if (ahci_cmdengine_stop(port))
-		return 1;
+		return NULL;
 
-	/* Allocate command list, one command table and received FIS. */
-	cmd_t *const cmdlist = memalign(1024, ncs * sizeof(cmd_t));
-	cmdtable_t *const cmdtable = memalign(128, sizeof(cmdtable_t));
-	rcvd_fis_t *const rcvd_fis = memalign(256, sizeof(rcvd_fis_t));
 	/* Allocate our device structure. */
 	ahci_dev_t *const dev = calloc(1, sizeof(ahci_dev_t));
-	if (!cmdlist || !cmdtable || !rcvd_fis || !dev)
+	if (!dev)
+		return NULL;
+	dev->ctrl = ctrl;
+	dev->port = port;
+
+	/* Allocate command list, one command table and received FIS. */
+	dev->cmdlist = memalign(1024, ncs * sizeof(cmd_t));
+	dev->cmdtable = memalign(128, sizeof(cmdtable_t));
+	dev->rcvd_fis = memalign(256, sizeof(rcvd_fis_t));
+	if (!dev->cmdlist || !dev->cmdtable || !dev->rcvd_fis)
 		goto _cleanup_ret;
-	memset((void *)cmdlist, '\0', ncs * sizeof(cmd_t));
-	memset((void *)cmdtable, '\0', sizeof(*cmdtable));
-	memset((void *)rcvd_fis, '\0', sizeof(*rcvd_fis));
+	memset((void *)dev->cmdlist, '\0', ncs * sizeof(cmd_t));
+	memset((void *)dev->cmdtable, '\0', sizeof(*dev->cmdtable));
+	memset((void *)dev->rcvd_fis, '\0', sizeof(*dev->rcvd_fis));
 
 	/* Set command list base and received FIS base. */
-	port->cmdlist_base = virt_to_phys(cmdlist);
-	port->frameinfo_base = virt_to_phys(rcvd_fis);
+	port->cmdlist_base = virt_to_phys(dev->cmdlist);
+	port->frameinfo_base = virt_to_phys(dev->rcvd_fis);
 	if (ahci_cmdengine_start(port))
 		goto _cleanup_ret;
 	/* Put port into active state. */
 	port->cmd_stat |= HBA_PxCMD_ICC_ACTIVE;
 
-	dev->ctrl = ctrl;
-	dev->port = port;
-	dev->cmdlist = cmdlist;
-	dev->cmdtable = cmdtable;
-	dev->rcvd_fis = rcvd_fis;
-
-	/*
-	 * Wait for D2H Register FIS with device' signature.
-	 * The drive has to spin up here, so wait up to 30s.
-	 */
-	const int timeout_s = 30; /* Time out after 30s. */
-	int timeout = timeout_s * 100;
-	while ((port->taskfile_data & HBA_PxTFD_BSY) && timeout--)
-		mdelay(10);
-
-	if (port->taskfile_data & HBA_PxTFD_BSY)
-		printf("ahci: Timed out after %d seconds "
-		       "of waiting for device to spin up.\n", timeout_s);
-
-	/* Initialize device or fall through to clean up. */
+	return dev;
+
+_cleanup_ret:
+	ahci_dev_free(dev);
+	return NULL;
+}
+
+/** Attach the device once it sent its signature. */
+static int ahci_dev_attach(ahci_dev_t *const dev, const int portnum)
+{
+	hba_port_t *const port = dev->port;
+
 	switch (port->signature) {
 	case HBA_PxSIG_ATA:
 		printf("ahci: ATA drive on port #%d.\n", portnum);
@@ -170,52 +182,126 @@ static int ahci_dev_init(hba_ctrl_t *const ctrl,
 				"on port #%d.\n", port->signature, portnum);
 		break;
 	}
-	ret = 2;
 
-_cleanup_ret:
 	/* Clean up (not reached for initialized devices). */
-	if (dev)
-		free(dev);
-	/* Only free if stopping succeeds, since otherwise the controller may
-	   still use the resources for DMA. */
-	if (!ahci_cmdengine_stop(port)) {
-		port->cmdlist_base = 0;
-		port->frameinfo_base = 0;
-		if (rcvd_fis)
-			free((void *)rcvd_fis);
-		if (cmdtable)
-			free((void *)cmdtable);
-		if (cmdlist)
-			free((void *)cmdlist);
+	ahci_dev_free(dev);
+	return 2;
+}
+
+/* Time for the link to come up after (staggered) spin-up, 10ms. */
+#define AHCI_LINK_TIMEOUT_US	(10 * 1000)
+/* The drive has to spin up before it sends its signature, 30s. */
+#define AHCI_SPIN_UP_TIMEOUT_US	(30 * 1000 * 1000)
+
+enum ahci_port_state {
+	AHCI_PORT_UNUSED = 0,
+	AHCI_PORT_SPIN_UP,	/* Waiting for our turn to spin up. */
+	AHCI_PORT_LINK_WAIT,	/* Waiting for the link to come up. */
+	AHCI_PORT_BSY_WAIT,	/* Waiting for the D2H Register FIS. */
+	AHCI_PORT_DONE,
+};
+
+struct ahci_port_probe {
+	enum ahci_port_state state;
+	u64 since;
+	ahci_dev_t *dev;
+};
+
+/** Advance the bring-up of one port. Returns true when it's done. */
+static bool ahci_port_step(hba_ctrl_t *const ctrl, const int i,
+			   struct ahci_port_probe *const probe,
+			   int *const spinning_up)
+{
+	hba_port_t *const port = &ctrl->ports[i];
+
+	switch (probe->state) {
+	case AHCI_PORT_SPIN_UP:
+		/* With staggered spin-up, spin up one device at a time. */
+		if (ctrl->caps & HBA_CAPS_SSS) {
+			if (*spinning_up >= 0)
+				return false;
+			*spinning_up = i;
+			port->cmd_stat |= HBA_PxCMD_SUD;
+		}
+		probe->state = AHCI_PORT_LINK_WAIT;
+		probe->since = timer_us(0);
+		return false;
+
+	case AHCI_PORT_LINK_WAIT:
+		if (!ahci_port_is_active(port)) {
+			if (timer_us(probe->since) < AHCI_LINK_TIMEOUT_US)
+				return false;
+			if (*spinning_up == i)
+				*spinning_up = -1;
+			return true;
+		}
+		if (*spinning_up == i)
+			*spinning_up = -1;
+
+		ahci_clear_status(port, sata_error);
+		ahci_clear_status(port, intr_status);
+
+		probe->dev = ahci_dev_alloc(ctrl, port);
+		if (!probe->dev)
+			return true;
+		probe->state = AHCI_PORT_BSY_WAIT;
+		probe->since = timer_us(0);
+		return false;
+
+	case AHCI_PORT_BSY_WAIT:
+		if (port->taskfile_data & HBA_PxTFD_BSY) {
+			if (timer_us(probe->since) < AHCI_SPIN_UP_TIMEOUT_US)
+				return false;
+			printf("ahci: Timed out after %d seconds "
+			       "of waiting for device to spin up.\n",
+			       AHCI_SPIN_UP_TIMEOUT_US / (1000 * 1000));
+		}
+		ahci_dev_attach(probe->dev, i + 1);
+		return true;
+
+	default:
+		return true;
 	}
-	return ret;
 }
 
-static void ahci_port_probe(hba_ctrl_t *const ctrl,
-			    hba_port_t *const port,
-			    const int portnum)
+/*
+ * Bring up all implemented ports at once: every port waits for its link
+ * and its drive to spin up in parallel, and drives get attached in the
+ * order they become ready. Only the spin-up itself is serialized when
+ * the controller asks for staggered spin-up.
+ */
+static void ahci_probe_ports(hba_ctrl_t *const ctrl)
 {
-	/* If staggered spin-up is supported, spin-up device. */
-	if (ctrl->caps & HBA_CAPS_SSS) {
-		port->cmd_stat |= HBA_PxCMD_SUD;
+	struct ahci_port_probe probes[32];
+	const u64 start = timer_us(0);
+	int spinning_up = -1;
+	int pending = 0;
+	int i;
+
+	memset(probes, 0, sizeof(probes));
+	for (i = 0; i < 32; ++i) {
+		if (ctrl->ports_impl & (1 << i)) {
+			probes[i].state = AHCI_PORT_SPIN_UP;
+			pending++;
+		}
 	}
 
-	/* Wait 1s if we just told the device to spin up or
-	           if it's the first port. */
-	if ((ctrl->caps & HBA_CAPS_SSS) ||
-			!(ctrl->ports_impl & ((1 << (portnum - 1)) - 1))) {
-		/* Wait for port to become active. */
-		int timeout = 100; /* Time out after 100 * 100us == 10ms. */
-		while (!ahci_port_is_active(port) && timeout--)
+	while (pending) {
+		for (i = 0; i < 32; ++i) {
+			if (probes[i].state == AHCI_PORT_UNUSED ||
+			    probes[i].state == AHCI_PORT_DONE)
+				continue;
+			if (ahci_port_step(ctrl, i, &probes[i], &spinning_up)) {
+				probes[i].state = AHCI_PORT_DONE;
+				pending--;
+			}
+		}
+		if (pending)
 			udelay(100);
 	}
-	if (!ahci_port_is_active(port))
-		return;
-
-	ahci_clear_status(port, sata_error);
-	ahci_clear_status(port, intr_status);
 
-	ahci_dev_init(ctrl, port, portnum);
+	printf("ahci: Probed all ports after %llu ms.\n",
+	       (unsigned long long)timer_us(start) / 1000);
 }
 
 #if CONFIG(LP_STORAGE_AHCI_ONLY_TESTED)
@@ -231,9 +317,8 @@ static u32 working_controllers[] = {
 
 void ahci_initialize(struct pci_dev *dev)
 {
-	int i;
-
 #if CONFIG(LP_STORAGE_AHCI_ONLY_TESTED)
+	int i;
 	const u32 vendor_device = dev->vendor_id | dev->device_id << 16;
 	for (i = 0; i < ARRAY_SIZE(working_controllers); ++i)
 		if (vendor_device == working_controllers[i])
@@ -250,7 +335,6 @@ void ahci_initialize(struct pci_dev *dev)
 		dev->bus, dev->dev, dev->func, dev->vendor_id, dev->device_id);
 
 	hba_ctrl_t *const ctrl = phys_to_virt(pci_read_long(dev, 0x24) & ~0x3ff);
-	hba_port_t *const ports = ctrl->ports;
 
 	/* Reset host controller. */
 	ctrl->global_ctrl |= HBA_CTRL_RESET;
@@ -272,8 +356,5 @@ void ahci_initialize(struct pci_dev *dev)
 	pci_write_word(dev, PCI_COMMAND, command | PCI_COMMAND_MASTER);
 
 	/* Probe for devices. */
-	for (i = 0; i < 32; ++i) {
-		if (ctrl->ports_impl & (1 << i))
-			ahci_port_probe(ctrl, &ports[i], i + 1);
-	}
+	ahci_probe_ports(ctrl);
 }
@@ -31,6 +31,7 @@
 #include <storage/ahci.h>
 #include <storage/nvme.h>
 #include <storage/storage.h>
+#include <storage/virtio.h>
 
 static storage_dev_t **devices = NULL;
 static size_t devices_length = 0;
@@ -111,6 +112,13 @@ void storage_initialize(void)
 #if CONFIG(LP_PCI)
 	struct pci_dev *dev;
 	for (dev = lib_sysinfo.pacc.devices; dev; dev = dev->next) {
+#if CONFIG(LP_STORAGE_VIRTIO)
+		/* virtio devices don't have a class of their own. */
+		if (dev->vendor_id == VIRTIO_PCI_VENDOR_ID) {
+			virtio_initialize(dev);
+			continue;
+		}
+#endif
 		switch (dev->device_class) {
 #if CONFIG(LP_STORAGE_AHCI)
 		case PCI_CLASS_STORAGE_AHCI:
@@ -0,0 +1,219 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/*
+ * Libpayload virtio-blk driver
+ */
+
+#include <endian.h>
+#include <libpayload.h>
+#include <pci.h>
+#include <storage/storage.h>
+
+#include "virtio_private.h"
+
+#define VIRTIO_BLK_F_SIZE_MAX	(1 << 1)
+
+#define VIRTIO_BLK_CFG_CAPACITY	0x00
+#define VIRTIO_BLK_CFG_SIZE_MAX	0x08
+
+#define VIRTIO_BLK_T_IN		0
+#define VIRTIO_BLK_S_OK		0
+
+/* Requests kept in flight, and blocks per request */
+#define VIRTIO_BLK_MAX_INFLIGHT	16
+#define VIRTIO_BLK_MAX_BLOCKS	256
+
+#define VIRTIO_BLK_TIMEOUT_US	(5 * 1000 * 1000)
+
+struct virtio_blk_req {
+	struct {
+		u32 type;
+		u32 reserved;
+		u64 sector;
+	} __packed hdr;
+	u8 status;
+	/* Not seen by the device */
+	bool busy;
+	size_t offset;
+};
+
+struct virtio_blk_dev {
+	storage_dev_t storage_dev;
+
+	struct virtio_dev vdev;
+	struct virtq vq;
+	struct virtio_blk_req *reqs;
+	unsigned int max_inflight;
+	u32 max_blocks;
+	u64 capacity;
+	bool failed;
+};
+
+static storage_poll_t virtio_blk_poll(struct storage_dev *dev)
+{
+	struct virtio_blk_dev *blk = (struct virtio_blk_dev *)dev;
+
+	return blk->failed ? POLL_ERROR : POLL_MEDIUM_PRESENT;
+}
+
+static struct virtio_blk_req *virtio_blk_get_req(struct virtio_blk_dev *blk)
+{
+	unsigned int i;
+
+	for (i = 0; i < blk->max_inflight; ++i) {
+		if (!blk->reqs[i].busy)
+			return &blk->reqs[i];
+	}
+	return NULL;
+}
+
+/*
+ * Split the transfer into requests of up to max_blocks each and keep up to
+ * max_inflight of them queued, so the device can work on the next one
+ * while we reap the last. The device is notified once per batch.
+ */
+static ssize_t virtio_blk_read_blocks512(
+		struct storage_dev *const dev,
+		const lba_t start, const size_t count, unsigned char *const buf)
+{
+	struct virtio_blk_dev *const blk = (struct virtio_blk_dev *)dev;
+	struct virtio_blk_req *req;
+	size_t submitted = 0, good = count;
+	unsigned int inflight = 0;
+	u64 last_progress;
+
+	if (blk->failed)
+		return -1;
+
+	last_progress = timer_us(0);
+	while (inflight || (submitted < count && good == count)) {
+		while (submitted < count && good == count &&
+		       (req = virtio_blk_get_req(blk))) {
+			const size_t blocks = MIN(count - submitted, blk->max_blocks);
+			const struct virtio_buf bufs[] = {
+				{ &req->hdr, sizeof(req->hdr), false },
+				{ buf + submitted * 512, blocks * 512, true },
+				{ &req->status, sizeof(req->status), true },
+			};
+
+			req->hdr.type = htole32(VIRTIO_BLK_T_IN);
+			req->hdr.reserved = 0;
+			req->hdr.sector = htole64(start + submitted);
+			req->status = 0xff;
+			req->offset = submitted;
+			if (virtq_add(&blk->vq, bufs, ARRAY_SIZE(bufs), req))
+				break;
+
+			req->busy = true;
+			submitted += blocks;
+			inflight++;
+		}
+		virtq_kick(&blk->vdev, &blk->vq);
+
+		while ((req = virtq_get_used(&blk->vq, NULL))) {
+			if (req->status != VIRTIO_BLK_S_OK) {
+				printf("virtio-blk: Read of sector %llu failed (%u).\n",
+				       (unsigned long long)le64toh(req->hdr.sector),
+				       req->status);
+				good = MIN(good, req->offset);
+			}
+			req->busy = false;
+			inflight--;
+			last_progress = timer_us(0);
+		}
+
+		if (inflight && timer_us(last_progress) > VIRTIO_BLK_TIMEOUT_US) {
+			printf("virtio-blk: Timeout, disabling device.\n");
+			/* Stop the device from writing into buffers we give back. */
+			virtio_reset(&blk->vdev);
+			blk->failed = true;
+			return -1;
+		}
+	}
+
+	return good;
+}
+
+static void virtio_blk_detach_device(struct storage_dev *dev)
+{
+	struct virtio_blk_dev *blk = (struct virtio_blk_dev *)dev;
+
+	virtio_reset(&blk->vdev);
+	virtio_vq_free(&blk->vq);
+	free(blk->reqs);
+}
+
+void virtio_blk_init(pcidev_t dev)
+{
+	struct virtio_blk_dev *blk;
+	u64 features;
+
+	printf("virtio-blk init (Device %02x:%02x.%02x)\n",
+	       PCI_BUS(dev), PCI_SLOT(dev), PCI_FUNC(dev));
+
+	blk = malloc(sizeof(*blk));
+	if (!blk) {
+		printf("virtio-blk ERROR: Failed to allocate driver struct.\n");
+		return;
+	}
+	memset(blk, 0, sizeof(*blk));
+
+	if (virtio_pci_init(&blk->vdev, dev))
+		goto _free_abort;
+
+	features = virtio_get_features(&blk->vdev) & VIRTIO_BLK_F_SIZE_MAX;
+	if (virtio_set_features(&blk->vdev, features)) {
+		printf("virtio-blk ERROR: Feature negotiation failed.\n");
+		goto _reset_abort;
+	}
+
+	/* Each request takes three descriptors: header, data and status. */
+	if (virtio_vq_setup(&blk->vdev, &blk->vq, 0, VIRTIO_BLK_MAX_INFLIGHT * 3))
+		goto _reset_abort;
+	blk->max_inflight = MIN(VIRTIO_BLK_MAX_INFLIGHT, blk->vq.num / 3);
+	if (!blk->max_inflight) {
+		printf("virtio-blk ERROR: Queue too small.\n");
+		goto _free_vq_abort;
+	}
+
+	blk->reqs = dma_malloc(blk->max_inflight * sizeof(*blk->reqs));
+	if (!blk->reqs) {
+		printf("virtio-blk ERROR: Failed to allocate requests.\n");
+		goto _free_vq_abort;
+	}
+	memset(blk->reqs, 0, blk->max_inflight * sizeof(*blk->reqs));
+
+	blk->max_blocks = VIRTIO_BLK_MAX_BLOCKS;
+	if (features & VIRTIO_BLK_F_SIZE_MAX) {
+		const u32 size_max = virtio_config_read32(&blk->vdev,
+							  VIRTIO_BLK_CFG_SIZE_MAX);
+		if (size_max >= 512)
+			blk->max_blocks = MIN(blk->max_blocks, size_max / 512);
+	}
+	blk->capacity = virtio_config_read64(&blk->vdev, VIRTIO_BLK_CFG_CAPACITY);
+
+	virtio_add_status(&blk->vdev, VIRTIO_STATUS_DRIVER_OK);
+
+	blk->storage_dev.port_type = PORT_TYPE_VIRTIO;
+	blk->storage_dev.poll = virtio_blk_poll;
+	blk->storage_dev.read_blocks512 = virtio_blk_read_blocks512;
+	blk->storage_dev.write_blocks512 = NULL;
+	blk->storage_dev.detach_device = virtio_blk_detach_device;
+
+	if (storage_attach_device(&blk->storage_dev)) {
+		virtio_blk_detach_device(&blk->storage_dev);
+		goto _free_abort;
+	}
+
+	printf("virtio-blk: %llu sectors, %u in flight, %s interface.\n",
+	       (unsigned long long)blk->capacity, blk->max_inflight,
+	       blk->vdev.modern ? "modern" : "legacy");
+	return;
+
+_free_vq_abort:
+	virtio_vq_free(&blk->vq);
+_reset_abort:
+	virtio_add_status(&blk->vdev, VIRTIO_STATUS_FAILED);
+_free_abort:
+	free(blk);
+	printf("virtio-blk init failed.\n");
+}
@@ -0,0 +1,442 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/*
+ * Libpayload virtio-pci transport and split virtqueues
+ */
+
+#include <arch/barrier.h>
+#include <endian.h>
+#include <libpayload.h>
+#include <pci.h>
+#include <pci/pci.h>
+#include <storage/virtio.h>
+
+#include "virtio_private.h"
+
+/* Vendor specific PCI capabilities describing the modern register layout */
+#define PCI_CAP_ID_VNDR			0x09
+#define PCI_STATUS_CAP_LIST		(1 << 4)
+
+#define VIRTIO_PCI_CAP_COMMON_CFG	1
+#define VIRTIO_PCI_CAP_NOTIFY_CFG	2
+#define VIRTIO_PCI_CAP_DEVICE_CFG	4
+
+/* Modern common configuration structure */
+#define VIRTIO_PCI_COMMON_DFSELECT	0x00
+#define VIRTIO_PCI_COMMON_DF		0x04
+#define VIRTIO_PCI_COMMON_GFSELECT	0x08
+#define VIRTIO_PCI_COMMON_GF		0x0c
+#define VIRTIO_PCI_COMMON_STATUS	0x14
+#define VIRTIO_PCI_COMMON_Q_SELECT	0x16
+#define VIRTIO_PCI_COMMON_Q_SIZE	0x18
+#define VIRTIO_PCI_COMMON_Q_ENABLE	0x1c
+#define VIRTIO_PCI_COMMON_Q_NOFF	0x1e
+#define VIRTIO_PCI_COMMON_Q_DESCLO	0x20
+#define VIRTIO_PCI_COMMON_Q_AVAILLO	0x28
+#define VIRTIO_PCI_COMMON_Q_USEDLO	0x30
+
+/* Legacy I/O port layout (MSI-X disabled) */
+#define VIRTIO_PCI_LEGACY_HOST_FEATURES		0x00
+#define VIRTIO_PCI_LEGACY_GUEST_FEATURES	0x04
+#define VIRTIO_PCI_LEGACY_QUEUE_PFN		0x08
+#define VIRTIO_PCI_LEGACY_QUEUE_NUM		0x0c
+#define VIRTIO_PCI_LEGACY_QUEUE_SEL		0x0e
+#define VIRTIO_PCI_LEGACY_QUEUE_NOTIFY		0x10
+#define VIRTIO_PCI_LEGACY_STATUS		0x12
+#define VIRTIO_PCI_LEGACY_CONFIG		0x14
+
+#define VIRTIO_PCI_LEGACY_VRING_ALIGN		4096
+
+static void *virtio_map_bar(pcidev_t dev, u8 bar, u32 offset)
+{
+	const u16 reg = PCI_BASE_ADDRESS_0 + bar * 4;
+	u32 lo;
+	u64 addr;
+
+	if (bar > 5)
+		return NULL;
+
+	lo = pci_read_config32(dev, reg);
+	if ((lo & PCI_BASE_ADDRESS_SPACE) == PCI_BASE_ADDRESS_SPACE_IO)
+		return NULL;
+
+	addr = lo & PCI_BASE_ADDRESS_MEM_MASK;
+	if ((lo & 0x6) == 0x4 && bar < 5) {
+		const u32 hi = pci_read_config32(dev, reg + 4);
+		if (hi && sizeof(uintptr_t) < sizeof(u64))
+			return NULL;
+		addr |= (u64)hi << 32;
+	}
+	if (!addr)
+		return NULL;
+
+	return phys_to_virt(addr + offset);
+}
+
+static int virtio_pci_find_modern(struct virtio_dev *vdev, pcidev_t dev)
+{
+	unsigned int loops = 0;
+	u8 pos;
+
+	if (!(pci_read_config16(dev, REG_STATUS) & PCI_STATUS_CAP_LIST))
+		return -1;
+
+	for (pos = pci_read_config8(dev, REG_CAP_POINTER) & ~3;
+	     pos && loops < 48; pos = pci_read_config8(dev, pos + 1) & ~3, ++loops) {
+		if (pci_read_config8(dev, pos) != PCI_CAP_ID_VNDR)
+			continue;
+
+		const u8 type = pci_read_config8(dev, pos + 3);
+		const u8 bar = pci_read_config8(dev, pos + 4);
+		const u32 offset = pci_read_config32(dev, pos + 8);
+
+		/* Only the first capability of each type is to be used. */
+		switch (type) {
+		case VIRTIO_PCI_CAP_COMMON_CFG:
+			if (!vdev->common)
+				vdev->common = virtio_map_bar(dev, bar, offset);
+			break;
+		case VIRTIO_PCI_CAP_NOTIFY_CFG:
+			if (!vdev->notify_base) {
+				vdev->notify_base = virtio_map_bar(dev, bar, offset);
+				vdev->notify_mult = pci_read_config32(dev, pos + 16);
+			}
+			break;
+		case VIRTIO_PCI_CAP_DEVICE_CFG:
+			if (!vdev->device)
+				vdev->device = virtio_map_bar(dev, bar, offset);
+			break;
+		}
+	}
+
+	if (!vdev->common || !vdev->notify_base || !vdev->device)
+		return -1;
+
+	vdev->modern = true;
+	return 0;
+}
+
+static u8 virtio_get_status(struct virtio_dev *vdev)
+{
+	if (vdev->modern)
+		return read8(vdev->common + VIRTIO_PCI_COMMON_STATUS);
+	else
+		return inb(vdev->io_base + VIRTIO_PCI_LEGACY_STATUS);
+}
+
+static void virtio_set_status(struct virtio_dev *vdev, u8 status)
+{
+	if (vdev->modern)
+		write8(vdev->common + VIRTIO_PCI_COMMON_STATUS, status);
+	else
+		outb(status, vdev->io_base + VIRTIO_PCI_LEGACY_STATUS);
+}
+
+void virtio_add_status(struct virtio_dev *vdev, u8 status)
+{
+	virtio_set_status(vdev, virtio_get_status(vdev) | status);
+}
+
+void virtio_reset(struct virtio_dev *vdev)
+{
+	const u64 start = timer_us(0);
+
+	virtio_set_status(vdev, 0);
+	if (!vdev->modern)
+		return;
+
+	/* Modern devices signal the end of the reset by reading back 0. */
+	while (virtio_get_status(vdev)) {
+		if (timer_us(start) > 100 * 1000) {
+			printf("virtio: Device did not finish reset.\n");
+			return;
+		}
+		udelay(10);
+	}
+}
+
+int virtio_pci_init(struct virtio_dev *vdev, pcidev_t dev)
+{
+	const u16 device_id = pci_read_config16(dev, REG_DEVICE_ID);
+
+	memset(vdev, 0, sizeof(*vdev));
+	vdev->pci_dev = dev;
+
+	if (virtio_pci_find_modern(vdev, dev)) {
+		const u32 bar0 = pci_read_config32(dev, PCI_BASE_ADDRESS_0);
+
+		if (device_id > VIRTIO_PCI_LEGACY_DEVICE_MAX ||
+		    (bar0 & PCI_BASE_ADDRESS_SPACE) != PCI_BASE_ADDRESS_SPACE_IO) {
+			printf("virtio: No usable register layout.\n");
+			return -1;
+		}
+		vdev->io_base = bar0 & PCI_BASE_ADDRESS_IO_MASK;
+	}
+
+	pci_write_config16(dev, PCI_COMMAND, pci_read_config16(dev, PCI_COMMAND) |
+			   PCI_COMMAND_IO | PCI_COMMAND_MEMORY | PCI_COMMAND_MASTER);
+
+	virtio_reset(vdev);
+	virtio_add_status(vdev, VIRTIO_STATUS_ACKNOWLEDGE | VIRTIO_STATUS_DRIVER);
+	return 0;
+}
+
+u64 virtio_get_features(struct virtio_dev *vdev)
+{
+	u64 features;
+
+	if (!vdev->modern)
+		return inl(vdev->io_base + VIRTIO_PCI_LEGACY_HOST_FEATURES);
+
+	write32(vdev->common + VIRTIO_PCI_COMMON_DFSELECT, 0);
+	features = read32(vdev->common + VIRTIO_PCI_COMMON_DF);
+	write32(vdev->common + VIRTIO_PCI_COMMON_DFSELECT, 1);
+	features |= (u64)read32(vdev->common + VIRTIO_PCI_COMMON_DF) << 32;
+	return features;
+}
+
+int virtio_set_features(struct virtio_dev *vdev, u64 features)
+{
+	if (!vdev->modern) {
+		outl(features, vdev->io_base + VIRTIO_PCI_LEGACY_GUEST_FEATURES);
+		return 0;
+	}
+
+	/* Modern devices only talk to drivers which accept virtio 1.0. */
+	features |= VIRTIO_F_VERSION_1;
+	if (!(virtio_get_features(vdev) & VIRTIO_F_VERSION_1))
+		return -1;
+
+	write32(vdev->common + VIRTIO_PCI_COMMON_GFSELECT, 0);
+	write32(vdev->common + VIRTIO_PCI_COMMON_GF, features);
+	write32(vdev->common + VIRTIO_PCI_COMMON_GFSELECT, 1);
+	write32(vdev->common + VIRTIO_PCI_COMMON_GF, features >> 32);
+
+	virtio_add_status(vdev, VIRTIO_STATUS_FEATURES_OK);
+	if (!(virtio_get_status(vdev) & VIRTIO_STATUS_FEATURES_OK))
+		return -1;
+	return 0;
+}
+
+u8 virtio_config_read8(struct virtio_dev *vdev, size_t offset)
+{
+	if (vdev->modern)
+		return read8(vdev->device + offset);
+	else
+		return inb(vdev->io_base + VIRTIO_PCI_LEGACY_CONFIG + offset);
+}
+
+u16 virtio_config_read16(struct virtio_dev *vdev, size_t offset)
+{
+	if (vdev->modern)
+		return le16toh(read16(vdev->device + offset));
+	else
+		return inw(vdev->io_base + VIRTIO_PCI_LEGACY_CONFIG + offset);
+}
+
+u32 virtio_config_read32(struct virtio_dev *vdev, size_t offset)
+{
+	if (vdev->modern)
+		return le32toh(read32(vdev->device + offset));
+	else
+		return inl(vdev->io_base + VIRTIO_PCI_LEGACY_CONFIG + offset);
+}
+
+u64 virtio_config_read64(struct virtio_dev *vdev, size_t offset)
+{
+	return virtio_config_read32(vdev, offset) |
+	       (u64)virtio_config_read32(vdev, offset + 4) << 32;
+}
+
+/* The legacy interface dictates this layout, we use it for modern devices too. */
+static size_t virtq_ring_size(u16 num)
+{
+	return ALIGN_UP(sizeof(struct virtq_desc) * num + sizeof(struct virtq_avail)
+			+ sizeof(u16) * (num + 1), VIRTIO_PCI_LEGACY_VRING_ALIGN)
+	       + sizeof(struct virtq_used) + sizeof(struct virtq_used_elem) * num
+	       + sizeof(u16);
+}
+
+static void write_le64_split(volatile u8 *lo, u64 value)
+{
+	write32(lo, value);
+	write32(lo + 4, value >> 32);
+}
+
+int virtio_vq_setup(struct virtio_dev *vdev, struct virtq *vq, u16 index, u16 max_num)
+{
+	u16 num;
+	unsigned int i;
+
+	memset(vq, 0, sizeof(*vq));
+	vq->index = index;
+
+	if (vdev->modern) {
+		write16(vdev->common + VIRTIO_PCI_COMMON_Q_SELECT, index);
+		num = read16(vdev->common + VIRTIO_PCI_COMMON_Q_SIZE);
+		/* Modern devices let us shrink the queue, keep it a power of 2. */
+		while (num / 2 >= max_num)
+			num >>= 1;
+	} else {
+		outw(index, vdev->io_base + VIRTIO_PCI_LEGACY_QUEUE_SEL);
+		num = inw(vdev->io_base + VIRTIO_PCI_LEGACY_QUEUE_NUM);
+	}
+	if (!num) {
+		printf("virtio: Queue %u is not available.\n", index);
+		return -1;
+	}
+
+	vq->ring_mem = dma_memalign(VIRTIO_PCI_LEGACY_VRING_ALIGN, virtq_ring_size(num));
+	vq->cookies = malloc(num * sizeof(*vq->cookies));
+	if (!vq->ring_mem || !vq->cookies) {
+		printf("virtio: Failed to allocate queue %u.\n", index);
+		virtio_vq_free(vq);
+		return -1;
+	}
+	memset(vq->ring_mem, 0, virtq_ring_size(num));
+
+	vq->num = num;
+	vq->num_free = num;
+	vq->desc = vq->ring_mem;
+	vq->avail = (void *)(vq->desc + num);
+	vq->used = vq->ring_mem + ALIGN_UP((uintptr_t)(&vq->avail->ring[num + 1]) -
+					   (uintptr_t)vq->ring_mem,
+					   VIRTIO_PCI_LEGACY_VRING_ALIGN);
+	for (i = 0; i < num; ++i)
+		vq->desc[i].next = htole16(i + 1);
+
+	/* We poll for completions. */
+	vq->avail->flags = htole16(VIRTQ_AVAIL_F_NO_INTERRUPT);
+
+	if (!vdev->modern) {
+		outl(virt_to_phys(vq->ring_mem) / VIRTIO_PCI_LEGACY_VRING_ALIGN,
+		     vdev->io_base + VIRTIO_PCI_LEGACY_QUEUE_PFN);
+		return 0;
+	}
+
+	write16(vdev->common + VIRTIO_PCI_COMMON_Q_SIZE, num);
+	write_le64_split(vdev->common + VIRTIO_PCI_COMMON_Q_DESCLO,
+			 virt_to_phys(vq->desc));
+	write_le64_split(vdev->common + VIRTIO_PCI_COMMON_Q_AVAILLO,
+			 virt_to_phys(vq->avail));
+	write_le64_split(vdev->common + VIRTIO_PCI_COMMON_Q_USEDLO,
+			 virt_to_phys(vq->used));
+	vq->notify = (volatile u16 *)(vdev->notify_base + vdev->notify_mult *
+			read16(vdev->common + VIRTIO_PCI_COMMON_Q_NOFF));
+	write16(vdev->common + VIRTIO_PCI_COMMON_Q_ENABLE, 1);
+
+	return 0;
+}
+
+void virtio_vq_free(struct virtq *vq)
+{
+	free(vq->ring_mem);
+	free(vq->cookies);
+	vq->ring_mem = NULL;
+	vq->cookies = NULL;
+	vq->num = 0;
+}
+
+int virtq_add(struct virtq *vq, const struct virtio_buf *bufs, size_t count, void *cookie)
+{
+	const u16 head = vq->free_head;
+	u16 i = head, last = head;
+	size_t n;
+
+	if (!count || count > vq->num_free)
+		return -1;
+
+	for (n = 0; n < count; ++n) {
+		volatile struct virtq_desc *const d = &vq->desc[i];
+
+		d->addr = htole64(virt_to_phys(bufs[n].addr));
+		d->len = htole32(bufs[n].len);
+		d->flags = htole16((bufs[n].device_writes ? VIRTQ_DESC_F_WRITE : 0) |
+				   (n + 1 < count ? VIRTQ_DESC_F_NEXT : 0));
+		last = i;
+		i = le16toh(d->next);
+	}
+	vq->free_head = le16toh(vq->desc[last].next);
+	vq->num_free -= count;
+	vq->cookies[head] = cookie;
+
+	vq->avail->ring[vq->avail_idx % vq->num] = htole16(head);
+	/* Descriptors and ring entry have to be visible before the index. */
+	wmb();
+	vq->avail->idx = htole16(++vq->avail_idx);
+	vq->kick_pending = true;
+
+	return 0;
+}
+
+void virtq_kick(struct virtio_dev *vdev, struct virtq *vq)
+{
+	if (!vq->kick_pending)
+		return;
+	vq->kick_pending = false;
+
+	mb();
+	if (vdev->modern)
+		write16(vq->notify, vq->index);
+	else
+		outw(vq->index, vdev->io_base + VIRTIO_PCI_LEGACY_QUEUE_NOTIFY);
+}
+
+void *virtq_get_used(struct virtq *vq, u32 *len)
+{
+	volatile struct virtq_used_elem *elem;
+	void *cookie;
+	u16 head, i;
+
+	if (le16toh(vq->used->idx) == vq->last_used)
+		return NULL;
+	/* Read the element only after we saw the index move. */
+	rmb();
+
+	elem = &vq->used->ring[vq->last_used++ % vq->num];
+	head = le32toh(elem->id);
+	if (len)
+		*len = le32toh(elem->len);
+
+	/* Return the chain to the free list. */
+	for (i = head; le16toh(vq->desc[i].flags) & VIRTQ_DESC_F_NEXT;
+	     i = le16toh(vq->desc[i].next))
+		vq->num_free++;
+	vq->num_free++;
+	vq->desc[i].next = htole16(vq->free_head);
+	vq->free_head = head;
+
+	cookie = vq->cookies[head];
+	vq->cookies[head] = NULL;
+	return cookie;
+}
+
+void virtio_initialize(struct pci_dev *dev)
+{
+	const pcidev_t pcidev = PCI_DEV(dev->bus, dev->dev, dev->func);
+	u16 type;
+
+	if (dev->vendor_id != VIRTIO_PCI_VENDOR_ID ||
+	    dev->device_id < VIRTIO_PCI_LEGACY_DEVICE_MIN ||
+	    dev->device_id > VIRTIO_PCI_MODERN_DEVICE_MAX)
+		return;
+
+	if (dev->device_id >= VIRTIO_PCI_MODERN_DEVICE_BASE)
+		type = dev->device_id - VIRTIO_PCI_MODERN_DEVICE_BASE;
+	else
+		type = pci_read_config16(pcidev, REG_SUBSYS_ID);
+
+	switch (type) {
+#if CONFIG(LP_STORAGE_VIRTIO_BLK)
+	case VIRTIO_ID_BLOCK:
+		virtio_blk_init(pcidev);
+		break;
+#endif
+#if CONFIG(LP_STORAGE_VIRTIO_SCSI)
+	case VIRTIO_ID_SCSI:
+		virtio_scsi_init(pcidev);
+		break;
+#endif
+	default:
+		break;
+	}
+}
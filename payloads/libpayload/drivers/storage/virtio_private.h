@@ -0,0 +1,138 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/*
+ * Libpayload virtio-pci transport and split virtqueues
+ */
+
+#ifndef _VIRTIO_PRIVATE_H
+#define _VIRTIO_PRIVATE_H
+
+#include <pci.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <storage/virtio.h>
+
+#define VIRTIO_PCI_LEGACY_DEVICE_MIN	0x1000
+#define VIRTIO_PCI_LEGACY_DEVICE_MAX	0x103f
+#define VIRTIO_PCI_MODERN_DEVICE_BASE	0x1040
+#define VIRTIO_PCI_MODERN_DEVICE_MAX	0x107f
+
+/* Device types, as found in the modern device ID and the legacy subsystem ID */
+#define VIRTIO_ID_BLOCK		2
+#define VIRTIO_ID_SCSI		8
+
+#define VIRTIO_STATUS_ACKNOWLEDGE	(1 << 0)
+#define VIRTIO_STATUS_DRIVER		(1 << 1)
+#define VIRTIO_STATUS_DRIVER_OK		(1 << 2)
+#define VIRTIO_STATUS_FEATURES_OK	(1 << 3)
+#define VIRTIO_STATUS_FAILED		(1 << 7)
+
+#define VIRTIO_F_VERSION_1		(1ULL << 32)
+
+#define VIRTQ_DESC_F_NEXT	(1 << 0)
+#define VIRTQ_DESC_F_WRITE	(1 << 1)
+
+#define VIRTQ_AVAIL_F_NO_INTERRUPT	(1 << 0)
+
+struct virtq_desc {
+	u64 addr;
+	u32 len;
+	u16 flags;
+	u16 next;
+} __packed;
+
+struct virtq_avail {
+	u16 flags;
+	u16 idx;
+	u16 ring[];
+} __packed;
+
+struct virtq_used_elem {
+	u32 id;
+	u32 len;
+} __packed;
+
+struct virtq_used {
+	u16 flags;
+	u16 idx;
+	struct virtq_used_elem ring[];
+} __packed;
+
+struct virtq {
+	u16 index;
+	u16 num;
+	u16 num_free;
+	u16 free_head;
+	u16 avail_idx;		/* Shadow of avail->idx */
+	u16 last_used;		/* Next used->ring entry to look at */
+	bool kick_pending;
+
+	volatile struct virtq_desc *desc;
+	volatile struct virtq_avail *avail;
+	volatile struct virtq_used *used;
+	void *ring_mem;
+	void **cookies;		/* Per head descriptor, handed back on completion */
+
+	volatile u16 *notify;	/* Modern devices only */
+};
+
+struct virtio_dev {
+	pcidev_t pci_dev;
+	bool modern;
+
+	/* Legacy (transitional) devices: everything lives in I/O BAR0 */
+	u16 io_base;
+
+	/* Modern devices: regions located through vendor capabilities */
+	volatile u8 *common;
+	volatile u8 *device;
+	volatile u8 *notify_base;
+	u32 notify_mult;
+};
+
+/* A buffer making up one descriptor of a request */
+struct virtio_buf {
+	void *addr;
+	u32 len;
+	bool device_writes;
+};
+
+/*
+ * Probe the transport of a virtio PCI function, reset the device and
+ * acknowledge it. Modern (virtio 1.0) register layout is preferred,
+ * transitional devices fall back to the legacy I/O port layout.
+ */
+int virtio_pci_init(struct virtio_dev *vdev, pcidev_t dev);
+void virtio_reset(struct virtio_dev *vdev);
+void virtio_add_status(struct virtio_dev *vdev, u8 status);
+
+u64 virtio_get_features(struct virtio_dev *vdev);
+/* Write the driver features and complete negotiation. */
+int virtio_set_features(struct virtio_dev *vdev, u64 features);
+
+u8 virtio_config_read8(struct virtio_dev *vdev, size_t offset);
+u16 virtio_config_read16(struct virtio_dev *vdev, size_t offset);
+u32 virtio_config_read32(struct virtio_dev *vdev, size_t offset);
+u64 virtio_config_read64(struct virtio_dev *vdev, size_t offset);
+
+/*
+ * Set up queue `index`. Modern devices get the queue shrunk to the smallest
+ * power of 2 holding `max_num` descriptors, legacy ones dictate the size.
+ */
+int virtio_vq_setup(struct virtio_dev *vdev, struct virtq *vq, u16 index, u16 max_num);
+void virtio_vq_free(struct virtq *vq);
+
+/*
+ * Chain `count` buffers into one request. The device is not notified
+ * before virtq_kick(), so several requests can be queued with one exit.
+ * Returns 0 on success, -1 if there are not enough free descriptors.
+ */
+int virtq_add(struct virtq *vq, const struct virtio_buf *bufs, size_t count, void *cookie);
+void virtq_kick(struct virtio_dev *vdev, struct virtq *vq);
+/* Reap one completed request. Returns its cookie or NULL if none is done. */
+void *virtq_get_used(struct virtq *vq, u32 *len);
+
+void virtio_blk_init(pcidev_t dev);
+void virtio_scsi_init(pcidev_t dev);
+
+#endif /* _VIRTIO_PRIVATE_H */
@@ -0,0 +1,372 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/*
+ * Libpayload virtio-scsi driver
+ */
+
+#include <endian.h>
+#include <libpayload.h>
+#include <pci.h>
+#include <storage/storage.h>
+
+#include "virtio_private.h"
+
+#define VIRTIO_SCSI_CFG_MAX_SECTORS	0x08
+#define VIRTIO_SCSI_CFG_MAX_TARGET	0x1e
+
+/* Queue 0 and 1 are control and event queues, which we don't need. */
+#define VIRTIO_SCSI_REQUEST_QUEUE	2
+
+#define VIRTIO_SCSI_CDB_SIZE		32
+#define VIRTIO_SCSI_SENSE_SIZE		96
+#define VIRTIO_SCSI_S_OK		0
+
+#define SCSI_STATUS_GOOD		0x00
+
+#define SCSI_TEST_UNIT_READY		0x00
+#define SCSI_INQUIRY			0x12
+#define SCSI_READ_CAPACITY_10		0x25
+#define SCSI_READ_10			0x28
+#define SCSI_READ_16			0x88
+#define SCSI_SERVICE_ACTION_IN_16	0x9e
+#define SCSI_SAI_READ_CAPACITY_16	0x10
+
+#define SCSI_TYPE_DISK			0x00
+
+/* Requests kept in flight, and blocks per request */
+#define VIRTIO_SCSI_MAX_INFLIGHT	16
+#define VIRTIO_SCSI_MAX_BLOCKS		256
+#define VIRTIO_SCSI_MAX_TARGETS		64
+
+#define VIRTIO_SCSI_TIMEOUT_US		(5 * 1000 * 1000)
+
+struct virtio_scsi_req {
+	struct {
+		u8 lun[8];
+		u64 tag;
+		u8 task_attr;
+		u8 prio;
+		u8 crn;
+		u8 cdb[VIRTIO_SCSI_CDB_SIZE];
+	} __packed cmd;
+	struct {
+		u32 sense_len;
+		u32 residual;
+		u16 status_qualifier;
+		u8 status;
+		u8 response;
+		u8 sense[VIRTIO_SCSI_SENSE_SIZE];
+	} __packed resp;
+	/* Not seen by the device */
+	bool busy;
+	size_t offset;
+};
+
+struct virtio_scsi_host {
+	struct virtio_dev vdev;
+	struct virtq vq;
+	struct virtio_scsi_req *reqs;
+	unsigned int max_inflight;
+	u32 max_blocks;
+	bool failed;
+};
+
+struct virtio_scsi_disk {
+	storage_dev_t storage_dev;
+
+	struct virtio_scsi_host *host;
+	u16 target;
+	u64 blocks;
+};
+
+static struct virtio_scsi_req *virtio_scsi_get_req(struct virtio_scsi_host *host)
+{
+	unsigned int i;
+
+	for (i = 0; i < host->max_inflight; ++i) {
+		if (!host->reqs[i].busy)
+			return &host->reqs[i];
+	}
+	return NULL;
+}
+
+static void virtio_scsi_prepare(struct virtio_scsi_req *req, u16 target)
+{
+	memset(&req->cmd, 0, sizeof(req->cmd));
+	memset(&req->resp, 0, sizeof(req->resp));
+	/* Single level LUN structure, LUN 0 */
+	req->cmd.lun[0] = 1;
+	req->cmd.lun[1] = target;
+	req->resp.response = 0xff;
+}
+
+static bool virtio_scsi_ok(const struct virtio_scsi_req *req)
+{
+	return req->resp.response == VIRTIO_SCSI_S_OK &&
+	       req->resp.status == SCSI_STATUS_GOOD;
+}
+
+static int virtio_scsi_wait(struct virtio_scsi_host *host, u64 last_progress)
+{
+	if (timer_us(last_progress) <= VIRTIO_SCSI_TIMEOUT_US)
+		return 0;
+
+	printf("virtio-scsi: Timeout, disabling controller.\n");
+	/* Stop the device from writing into buffers we give back. */
+	virtio_reset(&host->vdev);
+	host->failed = true;
+	return -1;
+}
+
+/* Issue a single command to LUN 0 of `target` and wait for it. */
+static int virtio_scsi_cmd(struct virtio_scsi_host *host, u16 target,
+			   const u8 *cdb, size_t cdb_len, void *data, u32 data_len)
+{
+	struct virtio_scsi_req *const req = &host->reqs[0];
+	const struct virtio_buf bufs[] = {
+		{ &req->cmd, sizeof(req->cmd), false },
+		{ &req->resp, sizeof(req->resp), true },
+		{ data, data_len, true },
+	};
+	const u64 start = timer_us(0);
+
+	if (host->failed)
+		return -1;
+
+	virtio_scsi_prepare(req, target);
+	memcpy(req->cmd.cdb, cdb, cdb_len);
+	if (virtq_add(&host->vq, bufs, data_len ? 3 : 2, req))
+		return -1;
+	virtq_kick(&host->vdev, &host->vq);
+
+	while (!virtq_get_used(&host->vq, NULL)) {
+		if (virtio_scsi_wait(host, start))
+			return -1;
+	}
+
+	return virtio_scsi_ok(req) ? 0 : -1;
+}
+
+static void virtio_scsi_read_cdb(u8 *cdb, u64 lba, u32 blocks)
+{
+	if (lba + blocks > 0xffffffffULL) {
+		cdb[0] = SCSI_READ_16;
+		be32enc(&cdb[2], lba >> 32);
+		be32enc(&cdb[6], lba);
+		be32enc(&cdb[10], blocks);
+	} else {
+		cdb[0] = SCSI_READ_10;
+		be32enc(&cdb[2], lba);
+		be16enc(&cdb[7], blocks);
+	}
+}
+
+static storage_poll_t virtio_scsi_poll(struct storage_dev *dev)
+{
+	struct virtio_scsi_disk *disk = (struct virtio_scsi_disk *)dev;
+
+	return disk->host->failed ? POLL_ERROR : POLL_MEDIUM_PRESENT;
+}
+
+/*
+ * Same scheme as virtio-blk: up to max_inflight READ commands of at most
+ * max_blocks each are queued, with one notification per batch.
+ */
+static ssize_t virtio_scsi_read_blocks512(
+		struct storage_dev *const dev,
+		const lba_t start, const size_t count, unsigned char *const buf)
+{
+	struct virtio_scsi_disk *const disk = (struct virtio_scsi_disk *)dev;
+	struct virtio_scsi_host *const host = disk->host;
+	struct virtio_scsi_req *req;
+	size_t submitted = 0, good = count;
+	unsigned int inflight = 0;
+	u64 last_progress;
+
+	if (host->failed)
+		return -1;
+
+	last_progress = timer_us(0);
+	while (inflight || (submitted < count && good == count)) {
+		while (submitted < count && good == count &&
+		       (req = virtio_scsi_get_req(host))) {
+			const size_t blocks = MIN(count - submitted, host->max_blocks);
+			const struct virtio_buf bufs[] = {
+				{ &req->cmd, sizeof(req->cmd), false },
+				{ &req->resp, sizeof(req->resp), true },
+				{ buf + submitted * 512, blocks * 512, true },
+			};
+
+			virtio_scsi_prepare(req, disk->target);
+			virtio_scsi_read_cdb(req->cmd.cdb, start + submitted, blocks);
+			req->offset = submitted;
+			if (virtq_add(&host->vq, bufs, ARRAY_SIZE(bufs), req))
+				break;
+
+			req->busy = true;
+			submitted += blocks;
+			inflight++;
+		}
+		virtq_kick(&host->vdev, &host->vq);
+
+		while ((req = virtq_get_used(&host->vq, NULL))) {
+			if (!virtio_scsi_ok(req)) {
+				printf("virtio-scsi: Read of block %llu on target %u failed"
+				       " (response %u, status 0x%02x).\n",
+				       (unsigned long long)(start + req->offset),
+				       disk->target, req->resp.response, req->resp.status);
+				good = MIN(good, req->offset);
+			}
+			req->busy = false;
+			inflight--;
+			last_progress = timer_us(0);
+		}
+
+		if (inflight && virtio_scsi_wait(host, last_progress))
+			return -1;
+	}
+
+	return good;
+}
+
+static void virtio_scsi_probe_target(struct virtio_scsi_host *host, u16 target)
+{
+	u8 cdb[16];
+	u8 data[36];
+	struct virtio_scsi_disk *disk;
+	u64 blocks;
+	u32 block_size;
+	int tries;
+
+	memset(cdb, 0, sizeof(cdb));
+	cdb[0] = SCSI_INQUIRY;
+	cdb[4] = 36;
+	memset(data, 0, sizeof(data));
+	if (virtio_scsi_cmd(host, target, cdb, 6, data, 36))
+		return;
+	/* Only connected direct access devices. */
+	if (data[0] != SCSI_TYPE_DISK)
+		return;
+
+	/* The first commands may report a unit attention after reset. */
+	memset(cdb, 0, sizeof(cdb));
+	cdb[0] = SCSI_TEST_UNIT_READY;
+	for (tries = 0; tries < 3; ++tries) {
+		if (!virtio_scsi_cmd(host, target, cdb, 6, NULL, 0))
+			break;
+	}
+	if (tries == 3 || host->failed)
+		return;
+
+	memset(cdb, 0, sizeof(cdb));
+	cdb[0] = SCSI_READ_CAPACITY_10;
+	if (virtio_scsi_cmd(host, target, cdb, 10, data, 8))
+		return;
+	blocks = (u64)be32dec(&data[0]) + 1;
+	block_size = be32dec(&data[4]);
+
+	if (blocks == 0x100000000ULL) {
+		memset(cdb, 0, sizeof(cdb));
+		cdb[0] = SCSI_SERVICE_ACTION_IN_16;
+		cdb[1] = SCSI_SAI_READ_CAPACITY_16;
+		be32enc(&cdb[10], 32);
+		if (virtio_scsi_cmd(host, target, cdb, 16, data, 32))
+			return;
+		blocks = be64dec(&data[0]) + 1;
+		block_size = be32dec(&data[8]);
+	}
+
+	if (block_size != 512) {
+		printf("virtio-scsi: Target %u has %u byte blocks, skipping.\n",
+		       target, block_size);
+		return;
+	}
+
+	disk = malloc(sizeof(*disk));
+	if (!disk)
+		return;
+	memset(disk, 0, sizeof(*disk));
+	disk->host = host;
+	disk->target = target;
+	disk->blocks = blocks;
+	disk->storage_dev.port_type = PORT_TYPE_VIRTIO;
+	disk->storage_dev.poll = virtio_scsi_poll;
+	disk->storage_dev.read_blocks512 = virtio_scsi_read_blocks512;
+	disk->storage_dev.write_blocks512 = NULL;
+	/* The host stays around as long as any of its disks. */
+	disk->storage_dev.detach_device = NULL;
+
+	if (storage_attach_device(&disk->storage_dev)) {
+		free(disk);
+		return;
+	}
+	printf("virtio-scsi: Target %u, %llu blocks.\n",
+	       target, (unsigned long long)blocks);
+}
+
+void virtio_scsi_init(pcidev_t dev)
+{
+	struct virtio_scsi_host *host;
+	const int attached = storage_device_count();
+	u32 max_sectors;
+	u16 target, max_target;
+
+	printf("virtio-scsi init (Device %02x:%02x.%02x)\n",
+	       PCI_BUS(dev), PCI_SLOT(dev), PCI_FUNC(dev));
+
+	host = malloc(sizeof(*host));
+	if (!host) {
+		printf("virtio-scsi ERROR: Failed to allocate driver struct.\n");
+		return;
+	}
+	memset(host, 0, sizeof(*host));
+
+	if (virtio_pci_init(&host->vdev, dev))
+		goto _free_abort;
+
+	if (virtio_set_features(&host->vdev, 0)) {
+		printf("virtio-scsi ERROR: Feature negotiation failed.\n");
+		goto _reset_abort;
+	}
+
+	/* Each request takes three descriptors: command, response and data. */
+	if (virtio_vq_setup(&host->vdev, &host->vq, VIRTIO_SCSI_REQUEST_QUEUE,
+			    VIRTIO_SCSI_MAX_INFLIGHT * 3))
+		goto _reset_abort;
+	host->max_inflight = MIN(VIRTIO_SCSI_MAX_INFLIGHT, host->vq.num / 3);
+	if (!host->max_inflight) {
+		printf("virtio-scsi ERROR: Queue too small.\n");
+		goto _free_vq_abort;
+	}
+
+	host->reqs = dma_malloc(host->max_inflight * sizeof(*host->reqs));
+	if (!host->reqs) {
+		printf("virtio-scsi ERROR: Failed to allocate requests.\n");
+		goto _free_vq_abort;
+	}
+	memset(host->reqs, 0, host->max_inflight * sizeof(*host->reqs));
+
+	max_sectors = virtio_config_read32(&host->vdev, VIRTIO_SCSI_CFG_MAX_SECTORS);
+	host->max_blocks = VIRTIO_SCSI_MAX_BLOCKS;
+	if (max_sectors)
+		host->max_blocks = MIN(host->max_blocks, max_sectors);
+	max_target = virtio_config_read16(&host->vdev, VIRTIO_SCSI_CFG_MAX_TARGET);
+	max_target = MIN(max_target, VIRTIO_SCSI_MAX_TARGETS - 1);
+
+	virtio_add_status(&host->vdev, VIRTIO_STATUS_DRIVER_OK);
+
+	for (target = 0; target <= max_target && !host->failed; ++target)
+		virtio_scsi_probe_target(host, target);
+
+	if (storage_device_count() > attached)
+		return;
+
+	printf("virtio-scsi: No disks found.\n");
+	virtio_reset(&host->vdev);
+	free(host->reqs);
+_free_vq_abort:
+	virtio_vq_free(&host->vq);
+_reset_abort:
+	virtio_add_status(&host->vdev, VIRTIO_STATUS_FAILED);
+_free_abort:
+	free(host);
+}
@@ -46,8 +46,6 @@
 #define debug(x...) do {} while (0)
 #endif
 
-#define min(a, b) (((a) < (b)) ? (a) : (b))
-
 static struct qh *get_qh(struct chipidea_pdata *p, int endpoint, int in_dir)
 {
 	assert(in_dir <= 1);
@@ -79,10 +77,13 @@ static int chipidea_hw_init(struct usbdev_ctrl *this, void *_opreg,
 	p->qhlist = dma_memalign(4096, sizeof(struct qh) * CI_QHELEMENTS);
 	memcpy(&this->device_descriptor, dd, sizeof(*dd));
 
-	if (p->qhlist == NULL)
+	p->td_pool = dma_memalign(32, sizeof(struct td) * CI_TD_POOL_SIZE);
+	if (p->qhlist == NULL || p->td_pool == NULL)
 		die("failed to allocate memory for USB device mode");
 
 	memset(p->qhlist, 0, sizeof(struct qh) * CI_QHELEMENTS);
+	for (p->td_free_count = 0; p->td_free_count < CI_TD_POOL_SIZE; p->td_free_count++)
+		p->td_free[p->td_free_count] = p->td_free_count;
 
 	SLIST_INIT(&this->configs);
 
@@ -133,6 +134,46 @@ static int chipidea_hw_init(struct usbdev_ctrl *this, void *_opreg,
 	return 1;
 }
 
+static int td_in_pool(struct chipidea_pdata *p, struct td *td)
+{
+	return td >= p->td_pool && td < p->td_pool + CI_TD_POOL_SIZE;
+}
+
+static struct td *alloc_td(struct chipidea_pdata *p)
+{
+	if (p->td_free_count == 0)
+		return dma_memalign(32, sizeof(struct td));
+	return &p->td_pool[p->td_free[--p->td_free_count]];
+}
+
+static void free_tds(struct chipidea_pdata *p, struct job *job)
+{
+	struct td *td = job->first_td, *next;
+
+	while (td) {
+		next = (td == job->last_td) ? NULL : phys_to_virt(td->next);
+		if (td_in_pool(p, td))
+			p->td_free[p->td_free_count++] = td - p->td_pool;
+		else
+			free(td);
+		td = next;
+	}
+	job->first_td = NULL;
+	job->last_td = NULL;
+}
+
+/* Forget about everything handed to the controller, it has been flushed. */
+static void reset_ep_jobs(struct chipidea_pdata *p, int ep, int in_dir)
+{
+	struct job *job;
+
+	SIMPLEQ_FOREACH(job, &p->job_queue[ep][in_dir], queue)
+		free_tds(p, job);
+	p->last_td[ep][in_dir] = NULL;
+}
+
+static void advance_waiting_endpoints(struct chipidea_pdata *p);
+
 static void chipidea_halt_ep(struct usbdev_ctrl *this, int ep, int in_dir)
 {
 	struct chipidea_pdata *p = CI_PDATA(this);
@@ -141,13 +182,17 @@ static void chipidea_halt_ep(struct usbdev_ctrl *this, int ep, int in_dir)
 		;
 	clrbits32(&p->opreg->epctrl[ep], 1 << (7 + (in_dir ? 16 : 0)));
 
+	reset_ep_jobs(p, ep, in_dir);
 	while (!SIMPLEQ_EMPTY(&p->job_queue[ep][in_dir])) {
 		struct job *job = SIMPLEQ_FIRST(&p->job_queue[ep][in_dir]);
 		if (job->autofree)
 			free(job->data);
 
 		SIMPLEQ_REMOVE_HEAD(&p->job_queue[ep][in_dir], queue);
+		free(job);
 	}
+
+	advance_waiting_endpoints(p);
 }
 
 static void chipidea_start_ep(struct usbdev_ctrl *this,
@@ -162,125 +207,203 @@ static void chipidea_start_ep(struct usbdev_ctrl *this,
 	/* enable endpoint, reset data toggle */
 	setbits32(&p->opreg->epctrl[ep],
 		((1 << 7) | (1 << 6) | (ep_type << 2)) << (in_dir*16));
-	p->ep_busy[ep][in_dir] = 0;
+	reset_ep_jobs(p, ep, in_dir);
 	this->ep_mps[ep][in_dir] = mps;
 }
 
-static void advance_endpoint(struct chipidea_pdata *p, int endpoint, int in_dir)
+/*
+ * Bytes the dTD starting at `start` can take. dTDs other than the last one of a job
+ * must end on a packet boundary, so received packets are never split between them.
+ */
+static size_t td_length(uint32_t start, size_t remaining, unsigned int mps)
 {
-	if (p->ep_busy[endpoint][in_dir])
-		return;
-	if (SIMPLEQ_EMPTY(&p->job_queue[endpoint][in_dir]))
-		return;
+	size_t len = CI_TD_MAX_BYTES - (start & 0xfff);
 
-	struct job *job = SIMPLEQ_FIRST(&p->job_queue[endpoint][in_dir]);
-	struct qh *qh = get_qh(p, endpoint, in_dir);
+	if (remaining <= len)
+		return remaining;
+	return len - len % mps;
+}
+
+/* Build the dTD chain for a job. Returns 0 on success, -1 if out of memory. */
+static int build_tds(struct chipidea_pdata *p, struct job *job, unsigned int mps)
+{
+	uint32_t start = (uint32_t)virt_to_phys(job->data);
+	size_t remaining = job->length;
+	int zlp = job->zlp;
+	struct td *td, *prev = NULL;
 
-	uint32_t start = (uint32_t)(uintptr_t)job->data;
-	uint32_t offset = (start & 0xfff);
-	/* unlike with typical EHCI controllers,
-	 * a full TD transfers either 0x5000 bytes if
-	 * page aligned or 0x4000 bytes if not.
-	 */
-	int maxsize = 0x5000;
-	if (offset > 0)
-		maxsize = 0x4000;
-	uint32_t td_count = (job->length + maxsize - 1) / maxsize;
+	do {
+		size_t datacount = td_length(start, remaining, mps);
 
-	/* special case for zero length packets */
-	if (td_count == 0)
-		td_count = 1;
+		/* The extra zero length packet gets a dTD of its own */
+		if (remaining == 0 && prev)
+			zlp = 0;
 
-	if (job->zlp)
-		td_count++;
+		td = alloc_td(p);
+		if (!td) {
+			if (prev)
+				free_tds(p, job);
+			return -1;
+		}
 
-	struct td *tds = dma_memalign(32, sizeof(struct td) * td_count);
-	memset(tds, 0, sizeof(struct td) * td_count);
+		debug("td %p, %zu bytes\n", td, datacount);
+		memset(td, 0, sizeof(*td));
+		td->next = TD_TERMINATE;
+		td->info = TD_INFO_LEN(datacount) | TD_INFO_ACTIVE;
+		td->page0 = start;
+		td->page1 = (start & 0xfffff000) + 0x1000;
+		td->page2 = (start & 0xfffff000) + 0x2000;
+		td->page3 = (start & 0xfffff000) + 0x3000;
+		td->page4 = (start & 0xfffff000) + 0x4000;
+
+		if (prev) {
+			prev->next = (uint32_t)virt_to_phys(td);
+			dcache_clean_by_mva(prev, sizeof(*prev));
+		} else {
+			job->first_td = td;
+		}
+		job->last_td = td;
+		prev = td;
 
-	int i;
-	int remaining = job->length;
-	for (i = 0; i < td_count; i++) {
-		int datacount = min(maxsize, remaining);
-
-		debug("td %d, %d bytes\n", i, datacount);
-		tds[i].next = (uint32_t)virt_to_phys(&tds[i+1]);
-		tds[i].info = TD_INFO_LEN(datacount) | TD_INFO_ACTIVE;
-		tds[i].page0 = start;
-		tds[i].page1 = (start & 0xfffff000) + 0x1000;
-		tds[i].page2 = (start & 0xfffff000) + 0x2000;
-		tds[i].page3 = (start & 0xfffff000) + 0x3000;
-		tds[i].page4 = (start & 0xfffff000) + 0x4000;
 		remaining -= datacount;
-		start = start + datacount;
-	}
-	tds[td_count - 1].next = TD_TERMINATE;
-	tds[td_count - 1].info |= TD_INFO_IOC;
+		start += datacount;
+	} while (remaining || zlp);
 
-	qh->td.next = (uint32_t)virt_to_phys(tds);
-	qh->td.info = 0;
+	td->info |= TD_INFO_IOC;
+	dcache_clean_by_mva(td, sizeof(*td));
+
+	return 0;
+}
+
+/*
+ * Hand a job to the controller. If the endpoint is still working on earlier jobs, the
+ * new dTDs are appended to its list, using the ATDTW semaphore to find out whether
+ * the controller got to see them before it went idle.
+ */
+static void link_job(struct chipidea_pdata *p, int endpoint, int in_dir, struct job *job)
+{
+	const uint32_t bit = 1 << ep_to_bits(endpoint, in_dir);
+	struct td *tail = p->last_td[endpoint][in_dir];
+	struct qh *qh = get_qh(p, endpoint, in_dir);
 
-	job->tds = tds;
-	job->td_count = td_count;
-	dcache_clean_by_mva(tds, sizeof(struct td) * td_count);
-	dcache_clean_by_mva(qh, sizeof(*qh));
 	if (!dma_coherent(job->data))
 		dcache_clean_by_mva(job->data, job->length);
 
+	p->last_td[endpoint][in_dir] = job->last_td;
+
+	if (tail) {
+		uint32_t active;
+
+		tail->next = (uint32_t)virt_to_phys(job->first_td);
+		dcache_clean_by_mva(tail, sizeof(*tail));
+
+		if (readl(&p->opreg->epprime) & bit)
+			return;
+		do {
+			setbits32(&p->opreg->usbcmd, USBCMD_ATDTW);
+			active = readl(&p->opreg->epstat) & bit;
+		} while (!(readl(&p->opreg->usbcmd) & USBCMD_ATDTW));
+		clrbits32(&p->opreg->usbcmd, USBCMD_ATDTW);
+		if (active)
+			return;
+	}
+
+	qh->td.next = (uint32_t)virt_to_phys(job->first_td);
+	qh->td.info = 0;
+	dcache_clean_by_mva(qh, sizeof(*qh));
+
 	debug("priming EP %d-%d with %zx bytes starting at %x (%p)\n", endpoint,
-		in_dir, job->length, tds[0].page0, job->data);
-	writel(1 << ep_to_bits(endpoint, in_dir), &p->opreg->epprime);
-	while (readl(&p->opreg->epprime))
+		in_dir, job->length, job->first_td->page0, job->data);
+	writel(bit, &p->opreg->epprime);
+	while (readl(&p->opreg->epprime) & bit)
 		;
-	p->ep_busy[endpoint][in_dir] = 1;
+}
+
+static void advance_endpoint(struct chipidea_pdata *p, int endpoint, int in_dir)
+{
+	const unsigned int mps = QH_GET_MPS(get_qh(p, endpoint, in_dir)->config);
+	struct job *job;
+
+	p->td_waiting &= ~(1 << ep_to_bits(endpoint, in_dir));
+
+	SIMPLEQ_FOREACH(job, &p->job_queue[endpoint][in_dir], queue) {
+		if (job->first_td)
+			continue;
+		/* Control transfers go one job at a time */
+		if (endpoint == 0 && p->last_td[endpoint][in_dir])
+			return;
+		/* Out of memory, try again when jobs on any endpoint complete */
+		if (build_tds(p, job, mps) < 0) {
+			p->td_waiting |= 1 << ep_to_bits(endpoint, in_dir);
+			return;
+		}
+		link_job(p, endpoint, in_dir, job);
+	}
+}
+
+/* dTDs were returned, give every endpoint that ran out of them another try. */
+static void advance_waiting_endpoints(struct chipidea_pdata *p)
+{
+	const uint32_t waiting = p->td_waiting;
+	int bit;
+
+	for (bit = 0; bit < 32; bit++)
+		if (waiting & (1 << bit))
+			advance_endpoint(p, bit % 16, bit / 16);
 }
 
 static void handle_endpoint(struct usbdev_ctrl *this, int endpoint, int in_dir)
 {
 	struct chipidea_pdata *p = CI_PDATA(this);
-	struct job *job = SIMPLEQ_FIRST(&p->job_queue[endpoint][in_dir]);
-	SIMPLEQ_REMOVE_HEAD(&p->job_queue[endpoint][in_dir], queue);
+	struct job *job;
 
-	if (in_dir && !dma_coherent(job->data))
-		dcache_invalidate_by_mva(job->data, job->length);
+	while ((job = SIMPLEQ_FIRST(&p->job_queue[endpoint][in_dir])) &&
+	       job->first_td) {
+		struct td *td = job->last_td;
+		int length = job->length;
 
-	int length = job->length;
+		dcache_invalidate_by_mva(td, sizeof(*td));
+		if (td->info & TD_INFO_ACTIVE)
+			break;
 
-	int i = 0;
-	do {
-		int active;
-		do {
-			dcache_invalidate_by_mva(&job->tds[i],
-				sizeof(struct td));
-			active = job->tds[i].info & TD_INFO_ACTIVE;
+		for (td = job->first_td;; td = phys_to_virt(td->next)) {
+			dcache_invalidate_by_mva(td, sizeof(*td));
 			debug("%d-%d: info %08x, page0 %x, next %x\n",
-				endpoint, in_dir, job->tds[i].info,
-				job->tds[i].page0, job->tds[i].next);
-		} while (active);
-		/*
-		 * The controller writes back the length field in info
-		 * with the number of bytes it did _not_ process.
-		 * Hence, take the originally scheduled length and
-		 * subtract whatever lengths we still find - that gives
-		 * us the data that the controller did transfer.
-		 */
-		int remaining = job->tds[i].info >> 16;
-		length -= remaining;
-	} while (job->tds[i++].next != TD_TERMINATE);
-	debug("%d-%d: scheduled %zd, now %d bytes\n", endpoint, in_dir,
-		job->length, length);
-
-	if (this->current_config &&
-	    this->current_config->interfaces[0].handle_packet)
-		this->current_config->interfaces[0].handle_packet(this,
-			endpoint, in_dir, job->data, length);
-
-	free(job->tds);
-	if (job->autofree)
-		free(job->data);
-	free(job);
-	p->ep_busy[endpoint][in_dir] = 0;
+				endpoint, in_dir, td->info, td->page0, td->next);
+			/*
+			 * The controller writes back the length field in info
+			 * with the number of bytes it did _not_ process.
+			 * Hence, take the originally scheduled length and
+			 * subtract whatever lengths we still find - that gives
+			 * us the data that the controller did transfer.
+			 */
+			length -= td->info >> 16;
+			if (td == job->last_td)
+				break;
+		}
+		debug("%d-%d: scheduled %zd, now %d bytes\n", endpoint, in_dir,
+			job->length, length);
+
+		SIMPLEQ_REMOVE_HEAD(&p->job_queue[endpoint][in_dir], queue);
+		if (p->last_td[endpoint][in_dir] == job->last_td)
+			p->last_td[endpoint][in_dir] = NULL;
+		free_tds(p, job);
+
+		if (in_dir && !dma_coherent(job->data))
+			dcache_invalidate_by_mva(job->data, job->length);
+
+		if (this->current_config &&
+		    this->current_config->interfaces[0].handle_packet)
+			this->current_config->interfaces[0].handle_packet(this,
+				endpoint, in_dir, job->data, length);
+
+		if (job->autofree)
+			free(job->data);
+		free(job);
+	}
 
 	advance_endpoint(p, endpoint, in_dir);
+	advance_waiting_endpoints(p);
 }
 
 static void start_setup(struct usbdev_ctrl *this, int ep)
@@ -306,6 +429,8 @@ static void chipidea_enqueue_packet(struct usbdev_ctrl *this, int endpoint,
 	struct chipidea_pdata *p = CI_PDATA(this);
 	struct job *job = malloc(sizeof(*job));
 
+	job->first_td = NULL;
+	job->last_td = NULL;
 	job->data = data;
 	job->length = len;
 	job->zlp = zlp;
@@ -419,6 +544,7 @@ static void chipidea_force_shutdown(struct usbdev_ctrl *this)
 	writel(0, &p->opreg->usbmode);
 	writel(USBCMD_8MICRO, &p->opreg->usbcmd);
 	free(p->qhlist);
+	free(p->td_pool);
 	free(p);
 	free(this);
 }
@@ -98,9 +98,17 @@ struct chipidea_opreg {
 
 #define CI_PDATA(ctrl) ((struct chipidea_pdata *)((ctrl)->pdata))
 #define CI_QHELEMENTS 32
+/*
+ * dTDs shared by all endpoints, each one covers up to 20 KiB. More are taken from
+ * the DMA heap when the pool runs dry.
+ */
+#define CI_TD_POOL_SIZE 128
+/* A dTD points to five 4 KiB pages, the first one possibly partially used */
+#define CI_TD_MAX_BYTES 0x5000
 
 #define QH_NO_AUTO_ZLT (1 << 29) /* no automatic ZLT handling by chipset */
 #define QH_MPS(x) ((x) << 16)
+#define QH_GET_MPS(x) (((x) >> 16) & 0x7ff)
 #define QH_IOS (1 << 15) /* IRQ on setup */
 
 #define TD_INFO_LEN(x) ((x) << 16)
@@ -109,6 +117,7 @@ struct chipidea_opreg {
 #define TD_TERMINATE 1
 
 #define USBCMD_8MICRO (8 << 16)
+#define USBCMD_ATDTW (1 << 14) /* add dTD tripwire */
 #define USBCMD_RST 2
 #define USBCMD_RUN 1
 
@@ -147,8 +156,8 @@ struct qh {
 
 struct job {
 	SIMPLEQ_ENTRY(job) queue; // linkage
-	struct td *tds; // for later free()ing
-	int td_count;
+	struct td *first_td; // NULL until handed to the controller
+	struct td *last_td;
 	void *data;
 	size_t length;
 	int zlp; // append zero length packet?
@@ -161,7 +170,12 @@ struct chipidea_pdata {
 	struct chipidea_opreg *opreg;
 	struct qh *qhlist;
 	struct job_queue job_queue[16][2];
-	int ep_busy[16][2];
+	/* last dTD handed to the controller, NULL if the endpoint is idle */
+	struct td *last_td[16][2];
+	struct td *td_pool;
+	uint8_t td_free[CI_TD_POOL_SIZE]; // stack of free td_pool indices
+	int td_free_count;
+	uint32_t td_waiting; // endpoints (as in epprime) waiting for dTDs
 };
 
 #endif
@@ -50,20 +50,32 @@ static int get_mps(dwc2_ep_t *ep)
 	return mps;
 }
 
-static void dwc2_process_ep(dwc2_ep_t *ep, int len, void *buf)
+/*
+ * Largest transfer an endpoint can be programmed for at once. Let it run as long as the
+ * transfer size and packet counters allow, every transfer costs an interrupt.
+ */
+static int get_max_transfer_size(dwc2_pdata_t *p, dwc2_ep_t *ep)
+{
+	int mps;
+
+	if (ep->ep_num == 0)
+		return EP0_MAXLEN;
+
+	mps = get_mps(ep);
+	if (mps == 0)
+		return 0;
+	return MIN(ALIGN_DOWN(p->max_xfersize, mps), p->max_pktcnt * mps);
+}
+
+static void dwc2_process_ep(dwc2_pdata_t *p, dwc2_ep_t *ep, int len, void *buf)
 {
 	depctl_t depctl;
 	depsiz_t depsiz;
 	uint16_t pkt_cnt;
 	uint16_t mps;
-	int max_transfer_size;
 	dwc2_ep_reg_t *ep_reg = ep->ep_regs;
 
-	if (ep->ep_num == 0)
-		max_transfer_size = EP0_MAXLEN;
-	else
-		max_transfer_size = EP_MAXLEN;
-	assert(len <= max_transfer_size);
+	assert(len <= get_max_transfer_size(p, ep));
 
 	mps = get_mps(ep);
 
@@ -91,14 +103,14 @@ static void dwc2_process_ep(dwc2_ep_t *ep, int len, void *buf)
 
 }
 
-static void dwc2_write_ep(dwc2_ep_t *ep, int len, void *buf)
+static void dwc2_write_ep(dwc2_pdata_t *p, dwc2_ep_t *ep, int len, void *buf)
 {
-	dwc2_process_ep(ep, len, buf);
+	dwc2_process_ep(p, ep, len, buf);
 }
 
-static void dwc2_read_ep(dwc2_ep_t *ep, int len, void *buf)
+static void dwc2_read_ep(dwc2_pdata_t *p, dwc2_ep_t *ep, int len, void *buf)
 {
-	dwc2_process_ep(ep, len, buf);
+	dwc2_process_ep(p, ep, len, buf);
 }
 
 static void dwc2_connect(struct usbdev_ctrl *this, int connect)
@@ -397,7 +409,7 @@ static void dwc2_start_ep(struct usbdev_ctrl *this,
 static void continue_ep_transfer(dwc2_pdata_t *p,
 				 int endpoint, int in_dir)
 {
-	int max_transfer_size = (endpoint == 0) ? EP0_MAXLEN : EP_MAXLEN;
+	int max_transfer_size;
 	int mps;
 	uint32_t remind_length;
 	void *data_buf;
@@ -407,6 +419,7 @@ static void continue_ep_transfer(dwc2_pdata_t *p,
 
 	struct job *job = SIMPLEQ_FIRST(&p->eps[endpoint][in_dir].job_queue);
 
+	max_transfer_size = get_max_transfer_size(p, &p->eps[endpoint][in_dir]);
 	remind_length = job->length - job->xfered_length;
 
 	job->xfer_length = (remind_length > max_transfer_size) ?
@@ -417,19 +430,19 @@ static void continue_ep_transfer(dwc2_pdata_t *p,
 		usb_debug("Un-aligned buffer address\n");
 
 	if (in_dir) {
-		dwc2_write_ep(&p->eps[endpoint][in_dir],
+		dwc2_write_ep(p, &p->eps[endpoint][in_dir],
 			    job->xfer_length, data_buf);
 	} else {
 		mps = get_mps(&p->eps[endpoint][in_dir]);
 		job->xfer_length = ALIGN_UP(job->xfer_length, mps);
-		dwc2_read_ep(&p->eps[endpoint][0], job->xfer_length, data_buf);
+		dwc2_read_ep(p, &p->eps[endpoint][0], job->xfer_length, data_buf);
 	}
 }
 
 static void start_ep_transfer(dwc2_pdata_t *p,
 			      int endpoint, int in_dir)
 {
-	int max_transfer_size = (endpoint == 0) ? EP0_MAXLEN : EP_MAXLEN;
+	int max_transfer_size;
 	int mps;
 
 	if (p->eps[endpoint][in_dir].busy) {
@@ -444,18 +457,19 @@ static void start_ep_transfer(dwc2_pdata_t *p,
 
 	struct job *job = SIMPLEQ_FIRST(&p->eps[endpoint][in_dir].job_queue);
 
+	max_transfer_size = get_max_transfer_size(p, &p->eps[endpoint][in_dir]);
 	job->xfer_length = (job->length > max_transfer_size) ?
 			    max_transfer_size : job->length;
 
 	if (in_dir) {
-		dwc2_write_ep(&p->eps[endpoint][1], job->xfer_length, job->data);
+		dwc2_write_ep(p, &p->eps[endpoint][1], job->xfer_length, job->data);
 	} else {
 		mps = get_mps(&p->eps[endpoint][0]);
 		job->xfer_length = ALIGN_UP(job->xfer_length, mps);
 		/* BUG */
 		if ((endpoint == 0) && (job->length == 0))
 			job->data = p->setup_buf;
-		dwc2_read_ep(&p->eps[endpoint][0], job->xfer_length, job->data);
+		dwc2_read_ep(p, &p->eps[endpoint][0], job->xfer_length, job->data);
 	}
 
 	usb_debug("start EP %d-%d with %zx bytes starting at %p\n", endpoint,
@@ -781,6 +795,7 @@ static int dwc2_reinit_udc(struct usbdev_ctrl *this, void *_opreg,
 	dtxfsiz_t dtxfsiz2 = { .d32 = 0 };
 	depint_t depint_msk = { .d32 = 0 };
 	dcfg_t dcfg = { .d32 = 0 };
+	ghwcfg3_t hwcfg3 = { .d32 = 0 };
 	dwc2_reg_t *regs = (dwc2_reg_t *)_opreg;
 	dwc2_pdata_t *p = DWC2_PDATA(this);
 	const int timeout = 10000;
@@ -835,6 +850,10 @@ static int dwc2_reinit_udc(struct usbdev_ctrl *this, void *_opreg,
 	/* Restart the Phy Clock */
 	writel(0x0, &regs->pcgr.pcgcctl);
 
+	hwcfg3.d32 = readl(&regs->core.ghwcfg3);
+	p->max_xfersize = (1 << (hwcfg3.xfersizewidth + 11)) - 1;
+	p->max_pktcnt = (1 << (hwcfg3.pktsizewidth + 4)) - 1;
+
 	/* Set 16bit PHY if & Force host mode */
 	gusbcfg.d32 = readl(&regs->core.gusbcfg);
 	gusbcfg.phyif = 1;
@@ -16,7 +16,6 @@
 #define __DWC2_PRIV_H__
 #include <usb/dwc2_registers.h>
 
-#define EP_MAXLEN	(64 * 1024)
 #define EP0_MAXLEN	64
 
 #define RX_FIFO_SIZE			0x210
@@ -53,6 +52,9 @@ typedef struct dwc2_pdata {
 	dwc2_ep_t eps[MAX_EPS_CHANNELS][2];
 	uint32_t fifo_map;
 	void *setup_buf;
+	/* limits of the DxEPTSIZ counters, from GHWCFG3 */
+	uint32_t max_xfersize;
+	uint32_t max_pktcnt;
 } dwc2_pdata_t;
 
 #define DWC2_PDATA(ctrl) ((dwc2_pdata_t *)((ctrl)->pdata))
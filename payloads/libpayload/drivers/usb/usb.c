@@ -79,8 +79,46 @@ usb_exit(void)
 	return 0;
 }
 
+/* returns the lowest active device address above devno or -1 */
+static int
+usb_next_active_device(const hci_t *controller, int devno)
+{
+	for (++devno; devno < ARRAY_SIZE(controller->devices);
+			devno = ALIGN_DOWN(devno, 32) + 32) {
+		const u32 active = controller->active_devices[devno / 32]
+				   >> (devno % 32);
+		if (active)
+			return devno + __builtin_ctz(active);
+	}
+	return -1;
+}
+
+static unsigned int
+usb_poll_interval(const usbdev_t *dev)
+{
+	unsigned int interval_us = USB_POLL_MAX_INTERVAL_US;
+	int i;
+
+	/* root hubs only read port status registers, that is cheap */
+	if (dev == dev->controller->devices[0])
+		return USB_POLL_DEFAULT_INTERVAL_US;
+
+	for (i = 0; i < dev->num_endp; i++) {
+		const endpoint_t *const ep = &dev->endpoints[i];
+		if (ep->type != INTERRUPT)
+			continue;
+		/* ep->interval is log2 of the number of 125us microframes */
+		if (ep->interval < 16)
+			interval_us = MIN(interval_us, 125U << ep->interval);
+	}
+	return interval_us;
+}
+
 /**
  * Polls all hubs on all USB controllers, to find out about device changes
+ *
+ * Only devices that are present are visited, and each of them only when
+ * its poll interval has elapsed, unless the controller reports pending work.
  */
 void
 usb_poll(void)
@@ -91,13 +129,23 @@ usb_poll(void)
 	if (usb_poll_prepare)
 		usb_poll_prepare();
 
+	const u64 now = timer_us(0);
 	hci_t *controller = usb_hcs;
 	while (controller != NULL) {
+		const int pending = controller->work_pending &&
+				    controller->work_pending(controller);
 		int i;
-		for (i = 0; i < 128; i++) {
-			if (controller->devices[i] != 0) {
-				controller->devices[i]->poll(controller->devices[i]);
-			}
+		/* poll() may attach or detach devices, so look up the
+		   next address only after each call */
+		for (i = usb_next_active_device(controller, -1); i >= 0;
+				i = usb_next_active_device(controller, i)) {
+			usbdev_t *const dev = controller->devices[i];
+			if (!pending && now < dev->next_poll_us)
+				continue;
+			if (!dev->poll_interval_us)
+				dev->poll_interval_us = usb_poll_interval(dev);
+			dev->next_poll_us = now + dev->poll_interval_us;
+			dev->poll(dev);
 		}
 		controller = controller->next;
 	}
@@ -114,6 +162,7 @@ init_device_entry(hci_t *controller, int i)
 	if (controller->devices[i] != 0)
 		usb_debug("warning: device %d reassigned?\n", i);
 	controller->devices[i] = dev;
+	controller->active_devices[i / 32] |= 1U << (i % 32);
 	dev->controller = controller;
 	dev->address = -1;
 	dev->hub = -1;
@@ -661,6 +710,7 @@ usb_detach_device(hci_t *controller, int devno)
 		 * has had a chance to interrogate it. */
 		free(controller->devices[devno]);
 		controller->devices[devno] = NULL;
+		controller->active_devices[devno / 32] &= ~(1U << (devno % 32));
 	}
 }
 
@@ -677,7 +727,12 @@ usb_attach_device(hci_t *controller, int hubaddress, int port, usb_speed speed)
 	// determine responsible driver - current done in set_address
 	newdev_t->init(newdev_t);
 	/* init() may have called usb_detach_device() yet, so check */
-	return controller->devices[newdev] ? newdev : -1;
+	if (!controller->devices[newdev])
+		return -1;
+	/* endpoints are known now, recompute the interval on the next poll */
+	newdev_t->poll_interval_us = 0;
+	newdev_t->next_poll_us = 0;
+	return newdev;
 }
 
 static void
@@ -175,6 +175,7 @@ xhci_init(unsigned long physical_bar)
 	controller->create_intr_queue	= xhci_create_intr_queue;
 	controller->destroy_intr_queue	= xhci_destroy_intr_queue;
 	controller->poll_intr_queue	= xhci_poll_intr_queue;
+	controller->work_pending	= xhci_work_pending;
 	controller->pcidev		= 0;
 
 	controller->reg_base = (uintptr_t)physical_bar;
@@ -201,14 +201,39 @@ xhci_handle_events(xhci_t *const xhci)
 	xhci_update_event_dq(xhci);
 }
 
+/*
+ * Events are only consumed when an interrupt queue is polled, and port
+ * status change events are never waited for, so drain the ring here.
+ * Otherwise a single unhandled event would report pending work forever.
+ */
+int
+xhci_work_pending(hci_t *const controller)
+{
+	xhci_t *const xhci = XHCI_INST(controller);
+
+	if (!xhci_event_ready(&xhci->er))
+		return 0;
+	xhci_handle_events(xhci);
+	return 1;
+}
+
+/*
+ * Spins on the event ring instead of sleeping in udelay(1) steps, so that
+ * events are seen as soon as they are posted and the timeout is accounted
+ * in real time rather than in (overhead-inflated) loop iterations.
+ */
 static unsigned long
 xhci_wait_for_event(const event_ring_t *const er,
 		    unsigned long *const timeout_us)
 {
-	while (!xhci_event_ready(er) && *timeout_us) {
-		--*timeout_us;
-		udelay(1);
-	}
+	const unsigned long budget_us = *timeout_us;
+	const u64 start = timer_us(0);
+	u64 elapsed_us = 0;
+
+	while (!xhci_event_ready(er) && elapsed_us < budget_us)
+		elapsed_us = timer_us(start);
+
+	*timeout_us = elapsed_us < budget_us ? budget_us - elapsed_us : 0;
 	return *timeout_us;
 }
 
@@ -36,6 +36,23 @@ static inline enum cbfs_type cbfs_ro_get_type(const char *name);
 static inline bool cbfs_file_exists(const char *name);
 static inline bool cbfs_ro_file_exists(const char *name);
 
+/*
+ * With CONFIG_LP_CBFS_CACHE, decompressed file contents are kept around for later loads of
+ * the same file. Buffers returned by cbfs_map() are then shared with the cache and must be
+ * treated as read-only; they stay pinned until released with cbfs_unmap().
+ */
+struct cbfs_cache_stats {
+	size_t hits;
+	size_t misses;
+	size_t evictions;
+	size_t bytes_used;
+};
+
+void cbfs_cache_get_stats(struct cbfs_cache_stats *stats);
+
+/* Drop all cached contents, e.g. after the flash was written. */
+void cbfs_cache_flush(void);
+
 /**********************************************************************************************
  *                         INTERNAL HELPERS FOR INLINES, DO NOT USE.                          *
  **********************************************************************************************/
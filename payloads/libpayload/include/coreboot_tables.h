@@ -85,6 +85,7 @@ enum {
 	CB_TAG_TYPE_C_INFO		= 0x0042,
 	CB_TAG_ACPI_RSDP                = 0x0043,
 	CB_TAG_PCIE			= 0x0044,
+	CB_TAG_MMC_TUNING		= 0x0048,
 	CB_TAG_CMOS_OPTION_TABLE	= 0x00c8,
 	CB_TAG_OPTION			= 0x00c9,
 	CB_TAG_OPTION_ENUM		= 0x00ca,
@@ -377,6 +378,21 @@ struct cb_mmc_info {
 	int32_t early_cmd1_status;
 };
 
+/*
+ * eMMC HS200 bus tuning result saved by a previous boot.  The sampling
+ * point may be reapplied instead of tuning again when the controller, card
+ * CID and bus mode match.
+ */
+struct cb_mmc_tuning {
+	uint32_t tag;
+	uint32_t size;
+	uint32_t ctrlr_id;
+	uint32_t cid[4];
+	uint32_t timing;
+	uint32_t bus_width;
+	uint32_t tuning;
+};
+
 struct cb_board_config {
 	uint32_t tag;
 	uint32_t size;
@@ -43,6 +43,7 @@ typedef enum {
 	PORT_TYPE_SATA	= (1 << 1),
 	PORT_TYPE_USB	= (1 << 2),
 	PORT_TYPE_NVME	= (1 << 3),
+	PORT_TYPE_VIRTIO	= (1 << 4),
 } storage_port_t;
 
 typedef enum {
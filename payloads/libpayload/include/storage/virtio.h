@@ -0,0 +1,15 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/*
+ * Libpayload virtio-blk and virtio-scsi drivers
+ */
+
+#ifndef _STORAGE_VIRTIO_H
+#define _STORAGE_VIRTIO_H
+
+#include "storage.h"
+
+#define VIRTIO_PCI_VENDOR_ID	0x1af4
+
+void virtio_initialize(struct pci_dev *dev);
+
+#endif /* _STORAGE_VIRTIO_H */
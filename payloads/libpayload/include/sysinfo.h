@@ -154,6 +154,8 @@ struct sysinfo_t {
 	uint32_t mtc_size;
 	uintptr_t chromeos_vpd;
 	int mmc_early_wake_status;
+	/* Saved eMMC bus tuning, tag is CB_TAG_MMC_TUNING when present */
+	struct cb_mmc_tuning mmc_tuning;
 
 	/* Pointer to FMAP cache in CBMEM */
 	uintptr_t fmap_cache;
@@ -481,7 +481,9 @@ typedef union {
 	uint32_t d32;
 	/* register bits */
 	struct {
-		unsigned reserved:16;
+		unsigned xfersizewidth:4;	/* transfer size counter: 11 + n bits */
+		unsigned pktsizewidth:3;	/* packet counter: 4 + n bits */
+		unsigned reserved:9;
 		unsigned dfifodepth:16;
 	};
 } ghwcfg3_t;
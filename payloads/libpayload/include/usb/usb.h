@@ -88,6 +88,17 @@ typedef enum {
 
 #define USB_FULL_LOW_SPEED_FRAME_US 1000
 
+/*
+ * usb_poll() calls a device's poll() at most once per poll interval. Devices
+ * with interrupt endpoints use their shortest endpoint interval and root
+ * hubs are polled once per frame. All others (mass storage, ...) only have
+ * synchronous transfers, so nothing is in flight between two polls and they
+ * use the maximum interval. The interval is capped, so that hubs with very
+ * long intervals still notice port changes.
+ */
+#define USB_POLL_DEFAULT_INTERVAL_US USB_FULL_LOW_SPEED_FRAME_US
+#define USB_POLL_MAX_INTERVAL_US (64 * 1000)
+
 typedef struct {
 	unsigned char bDescLength;
 	unsigned char bDescriptorType;
@@ -227,6 +238,8 @@ struct usbdev {
 	void (*init) (usbdev_t *dev);
 	void (*destroy) (usbdev_t *dev);
 	void (*poll) (usbdev_t *dev);
+	u64 next_poll_us;	// timer_us() stamp when poll() is due next
+	unsigned int poll_interval_us;	// 0 until computed by usb_poll()
 };
 
 typedef enum { OHCI = 0, UHCI = 1, EHCI = 2, XHCI = 3, DWC2 = 4} hc_type;
@@ -238,6 +251,7 @@ struct usbdev_hc {
 	hc_type type;
 	int latest_address;
 	usbdev_t *devices[128];	// dev 0 is root hub, 127 is last addressable
+	u32 active_devices[128 / 32];	// bitmap of non-NULL devices[] entries
 
 	/* start():     Resume operation. */
 	void (*start) (hci_t *controller);
@@ -260,6 +274,11 @@ struct usbdev_hc {
 	void* (*create_intr_queue) (endpoint_t *ep, int reqsize, int reqcount, int reqtiming);
 	void (*destroy_intr_queue) (endpoint_t *ep, void *queue);
 	u8* (*poll_intr_queue) (void *queue);
+	/* work_pending():	Optional. Returns non-zero if the controller
+				has completed work (e.g. unhandled events)
+				that usb_poll() should pick up right away,
+				regardless of the devices' poll intervals. */
+	int (*work_pending) (hci_t *controller);
 	void *instance;
 
 	/* set_address():		Tell the USB device its address (xHCI
@@ -0,0 +1,44 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+
+#ifndef __ARCH_X86_MMU_H__
+#define __ARCH_X86_MMU_H__
+
+#include <libpayload-config.h>
+#include <stdint.h>
+
+/*
+ * Memory types that can be selected for a range of the identity map. The effective type
+ * also depends on the MTRRs, but WC overrides UC and WB MTRRs, which is what matters for
+ * framebuffers that did not get an MTRR of their own.
+ */
+enum mmu_memory_type {
+	MMU_MEMORY_WB,
+	MMU_MEMORY_WC,
+	MMU_MEMORY_WT,
+	MMU_MEMORY_UC,
+};
+
+#if CONFIG(LP_ARCH_X86_64)
+/*
+ * Program the PAT and map the framebuffer from the coreboot tables write-combining
+ * (if enabled in Kconfig). Called from start_main().
+ */
+void mmu_init(void);
+
+/*
+ * Change the memory type of the physical range [base, base + size), rounded out to 4 KiB
+ * pages. Large pages are only split where the range doesn't cover them completely.
+ * Returns 0 on success or -1 if the range is not mapped or page tables ran out.
+ */
+int mmu_set_memory_type(uint64_t base, uint64_t size, enum mmu_memory_type type);
+#else
+/* Without paging, memory types come from the MTRRs alone. */
+static inline void mmu_init(void) {}
+static inline int mmu_set_memory_type(uint64_t base, uint64_t size,
+				      enum mmu_memory_type type)
+{
+	return -1;
+}
+#endif
+
+#endif /* __ARCH_X86_MMU_H__ */
@@ -29,16 +29,18 @@
 #ifndef _ARCH_MSR_H
 #define _ARCH_MSR_H
 
+/* The "A" constraint doesn't mean EDX:EAX on x86_64, so spell out both halves. */
 static inline unsigned long long _rdmsr(unsigned int msr)
 {
-	unsigned long long val;
-	asm volatile("rdmsr" : "=A" (val) : "c" (msr));
-	return val;
+	unsigned int lo, hi;
+	asm volatile("rdmsr" : "=a" (lo), "=d" (hi) : "c" (msr));
+	return ((unsigned long long)hi << 32) | lo;
 }
 
 static inline void _wrmsr(unsigned int msr, unsigned long long val)
 {
-	asm volatile("wrmsr" : : "c" (msr), "A"(val));
+	asm volatile("wrmsr" : : "c" (msr), "a" ((unsigned int)val),
+		     "d" ((unsigned int)(val >> 32)));
 }
 
 #define rdmsr(_m, _l, _h) \
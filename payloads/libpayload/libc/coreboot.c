@@ -89,6 +89,17 @@ static void cb_parse_mmc_info(unsigned char *ptr, struct sysinfo_t *info)
 	info->mmc_early_wake_status = mmc_info->early_cmd1_status;
 }
 
+static void cb_parse_mmc_tuning(unsigned char *ptr, struct sysinfo_t *info)
+{
+	struct cb_mmc_tuning *tuning = (struct cb_mmc_tuning *)ptr;
+
+	/* Don't read past a shorter record */
+	if (tuning->size < sizeof(*tuning))
+		return;
+
+	info->mmc_tuning = *tuning;
+}
+
 static void cb_parse_gpios(unsigned char *ptr, struct sysinfo_t *info)
 {
 	int i;
@@ -424,6 +435,9 @@ int cb_parse_header(void *addr, int len, struct sysinfo_t *info)
 		case CB_TAG_MMC_INFO:
 			cb_parse_mmc_info(ptr, info);
 			break;
+		case CB_TAG_MMC_TUNING:
+			cb_parse_mmc_tuning(ptr, info);
+			break;
 		case CB_TAG_MTC:
 			cb_parse_mtc(ptr, info);
 			break;
@@ -74,11 +74,6 @@ ssize_t _cbfs_boot_lookup(const char *name, bool force_ro, union cbfs_mdata *mda
 	return cbd->dev.offset + data_offset;
 }
 
-void cbfs_unmap(void *mapping)
-{
-	free(mapping);
-}
-
 static bool cbfs_file_hash_mismatch(const void *buffer, size_t size,
 				    const union cbfs_mdata *mdata, bool skip_verification)
 {
@@ -197,6 +192,228 @@ static void *do_load(union cbfs_mdata *mdata, ssize_t offset, void *buf, size_t
 	return buf;
 }
 
+#if CONFIG(LP_CBFS_CACHE)
+#define CBFS_CACHE_SIZE CONFIG_LP_CBFS_CACHE_SIZE
+#else
+#define CBFS_CACHE_SIZE 0
+#endif
+
+#define CBFS_CACHE_ENTRIES 32
+
+/*
+ * Decompressed file contents, keyed by the absolute flash offset of the data, the
+ * file name and a hash over the whole metadata block (which includes the file hash
+ * attribute). Contents are only inserted after they passed verification, so a hit
+ * is as good as a fresh load. Pinned entries are handed out by cbfs_map() and may
+ * not be evicted before the matching cbfs_unmap().
+ */
+struct cbfs_cache_entry {
+	void *data;
+	size_t size;
+	size_t offset;
+	uint32_t mdata_hash;
+	char *name;
+	bool unverified;
+	bool stale;
+	unsigned int pins;
+	uint32_t last_use;
+};
+
+static struct cbfs_cache_entry cbfs_cache[CBFS_CACHE_ENTRIES];
+static struct cbfs_cache_stats cbfs_cache_stats;
+static uint32_t cbfs_cache_tick;
+
+static uint32_t cbfs_cache_hash_mdata(const union cbfs_mdata *mdata)
+{
+	const size_t len = MIN(be32toh(mdata->h.offset), sizeof(*mdata));
+	uint32_t hash = 2166136261;	/* FNV-1a */
+	size_t i;
+
+	for (i = 0; i < len; i++)
+		hash = (hash ^ mdata->raw[i]) * 16777619;
+	return hash;
+}
+
+static void cbfs_cache_drop(struct cbfs_cache_entry *entry)
+{
+	cbfs_cache_stats.bytes_used -= entry->size;
+	free(entry->data);
+	free(entry->name);
+	memset(entry, 0, sizeof(*entry));
+}
+
+static struct cbfs_cache_entry *cbfs_cache_find(const union cbfs_mdata *mdata, size_t offset,
+						bool skip_verification)
+{
+	const uint32_t hash = cbfs_cache_hash_mdata(mdata);
+	size_t i;
+
+	for (i = 0; i < ARRAY_SIZE(cbfs_cache); i++) {
+		struct cbfs_cache_entry *entry = &cbfs_cache[i];
+
+		if (!entry->data || entry->stale)
+			continue;
+		/* Unverified contents must never satisfy a verified load. */
+		if (entry->unverified && !skip_verification)
+			continue;
+		if (entry->offset == offset && entry->mdata_hash == hash &&
+		    !strcmp(entry->name, mdata->h.filename))
+			return entry;
+	}
+	return NULL;
+}
+
+/* Returns a free slot with room for `size` bytes, evicting least recently used entries. */
+static struct cbfs_cache_entry *cbfs_cache_make_room(size_t size)
+{
+	struct cbfs_cache_entry *slot, *lru;
+	size_t i;
+
+	if (size > CBFS_CACHE_SIZE)
+		return NULL;
+
+	for (;;) {
+		slot = NULL;
+		lru = NULL;
+		for (i = 0; i < ARRAY_SIZE(cbfs_cache); i++) {
+			struct cbfs_cache_entry *entry = &cbfs_cache[i];
+
+			if (!entry->data) {
+				slot = slot ? slot : entry;
+				continue;
+			}
+			if (entry->pins)
+				continue;
+			if (!lru || (int32_t)(entry->last_use - lru->last_use) < 0)
+				lru = entry;
+		}
+		if (slot && cbfs_cache_stats.bytes_used + size <= CBFS_CACHE_SIZE)
+			return slot;
+		if (!lru)
+			return NULL;
+		cbfs_cache_drop(lru);
+		cbfs_cache_stats.evictions++;
+	}
+}
+
+/* Takes ownership of `data`. Returns false if it didn't fit, caller keeps it then. */
+static bool cbfs_cache_insert(const union cbfs_mdata *mdata, size_t offset,
+			      bool skip_verification, void *data, size_t size, bool pin)
+{
+	struct cbfs_cache_entry *entry = cbfs_cache_make_room(size);
+	char *name;
+
+	if (!entry)
+		return false;
+	name = strdup(mdata->h.filename);
+	if (!name)
+		return false;
+
+	entry->data = data;
+	entry->size = size;
+	entry->offset = offset;
+	entry->mdata_hash = cbfs_cache_hash_mdata(mdata);
+	entry->name = name;
+	entry->unverified = skip_verification;
+	entry->pins = pin ? 1 : 0;
+	entry->last_use = ++cbfs_cache_tick;
+	cbfs_cache_stats.bytes_used += size;
+	return true;
+}
+
+static void *cached_load(union cbfs_mdata *mdata, ssize_t offset, void *buf,
+			 size_t *size_inout, bool skip_verification)
+{
+	struct cbfs_cache_entry *entry;
+	size_t size = 0;
+	void *copy;
+
+	if (!CBFS_CACHE_SIZE)
+		return do_load(mdata, offset, buf, size_inout, skip_verification);
+
+	entry = cbfs_cache_find(mdata, offset, skip_verification);
+	if (entry) {
+		cbfs_cache_stats.hits++;
+		entry->last_use = ++cbfs_cache_tick;
+		if (size_inout) {
+			size = *size_inout;
+			*size_inout = entry->size;
+		}
+		if (!buf) {
+			entry->pins++;
+			return entry->data;
+		}
+		if (!size_inout || size < entry->size) {
+			ERROR("'%s' buffer too small\n", mdata->h.filename);
+			return NULL;
+		}
+		memcpy(buf, entry->data, entry->size);
+		return buf;
+	}
+
+	cbfs_cache_stats.misses++;
+	if (!buf) {
+		buf = do_load(mdata, offset, NULL, &size, skip_verification);
+		if (size_inout)
+			*size_inout = size;
+		if (buf)
+			cbfs_cache_insert(mdata, offset, skip_verification, buf, size, true);
+		return buf;
+	}
+
+	if (!do_load(mdata, offset, buf, size_inout, skip_verification))
+		return NULL;
+	size = *size_inout;
+	copy = malloc(size);
+	if (copy) {
+		memcpy(copy, buf, size);
+		if (!cbfs_cache_insert(mdata, offset, skip_verification, copy, size, false))
+			free(copy);
+	}
+	return buf;
+}
+
+void cbfs_unmap(void *mapping)
+{
+	size_t i;
+
+	for (i = 0; CBFS_CACHE_SIZE && mapping && i < ARRAY_SIZE(cbfs_cache); i++) {
+		struct cbfs_cache_entry *entry = &cbfs_cache[i];
+
+		if (entry->data != mapping)
+			continue;
+		assert(entry->pins);
+		entry->pins--;
+		if (!entry->pins && entry->stale)
+			cbfs_cache_drop(entry);
+		return;
+	}
+
+	free(mapping);
+}
+
+void cbfs_cache_flush(void)
+{
+	size_t i;
+
+	for (i = 0; i < ARRAY_SIZE(cbfs_cache); i++) {
+		struct cbfs_cache_entry *entry = &cbfs_cache[i];
+
+		if (!entry->data)
+			continue;
+		/* Mappings still in use are released by cbfs_unmap(). */
+		if (entry->pins)
+			entry->stale = true;
+		else
+			cbfs_cache_drop(entry);
+	}
+}
+
+void cbfs_cache_get_stats(struct cbfs_cache_stats *stats)
+{
+	*stats = cbfs_cache_stats;
+}
+
 void *_cbfs_load(const char *name, void *buf, size_t *size_inout, bool force_ro)
 {
 	ssize_t offset;
@@ -209,7 +426,7 @@ void *_cbfs_load(const char *name, void *buf, size_t *size_inout, bool force_ro)
 	if (offset < 0)
 		return NULL;
 
-	return do_load(&mdata, offset, buf, size_inout, false);
+	return cached_load(&mdata, offset, buf, size_inout, false);
 }
 
 void *_cbfs_unverified_area_load(const char *area, const char *name, void *buf,
@@ -229,7 +446,7 @@ void *_cbfs_unverified_area_load(const char *area, const char *name, void *buf,
 		return NULL;
 	}
 
-	return do_load(&mdata, dev.offset + data_offset, buf, size_inout, true);
+	return cached_load(&mdata, dev.offset + data_offset, buf, size_inout, true);
 }
 
 /* This should be overridden by payloads that want to enforce more explicit
@@ -1,6 +1,6 @@
 # SPDX-License-Identifier: GPL-2.0-only
 
-tests-y += graphics-test speaker-test
+tests-y += graphics-test speaker-test chipidea-test
 
 graphics-test-srcs += tests/drivers/graphics-test.c
 graphics-test-srcs += libc/fpmath.c
@@ -8,3 +8,5 @@ graphics-test-srcs += libc/fpmath.c
 speaker-test-srcs += tests/drivers/speaker-test.c
 speaker-test-mocks += inb
 speaker-test-mocks += outb
+
+chipidea-test-srcs += tests/drivers/chipidea-test.c
@@ -0,0 +1,489 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+
+#include <libpayload.h>
+#include <sys/mman.h>
+
+/* Catch the driver returning dTDs taken from the DMA heap */
+static void mock_free(void *ptr);
+#define free mock_free
+
+/* Include source to gain access to private defines */
+#include "../drivers/udc/chipidea.c"
+
+#undef free
+
+#include <tests/test.h>
+
+/* chipidea_init() hardcodes where the controller lives */
+#define CI_MMIO_BASE	0x7d000000UL
+#define EP_BULK		1
+
+unsigned long virtual_offset = 0;
+
+/*
+ * A register-level model of the controller: a prime makes an endpoint walk its dTDs from
+ * the queue head, mock_run() retires them and raises completions for dTDs with IOC set.
+ */
+static struct chipidea_opreg regs;
+static struct usbdev_ctrl *ctrl;
+static struct td *hw_td[16][2];
+static size_t primes, tds_done, interrupts;
+static size_t packets_handled, bytes_handled;
+
+/* dTDs the driver takes from the DMA heap once the pool is used up */
+#define HEAP_TDS	1024
+static struct td *heap_td;
+static size_t heap_td_next, heap_tds;
+static bool dma_exhausted;
+
+static struct {
+	struct usbdev_configuration config;
+	struct usbdev_interface iface;
+} gadget;
+
+static void *alloc_low(size_t size)
+{
+	/* dTDs and queue heads only hold 32-bit addresses */
+	void *ptr = mmap(NULL, size, PROT_READ | PROT_WRITE,
+			 MAP_PRIVATE | MAP_ANONYMOUS | MAP_32BIT, -1, 0);
+
+	assert_true(ptr != MAP_FAILED);
+	return ptr;
+}
+
+void *dma_memalign(size_t align, size_t size)
+{
+	assert_true(align <= 4096);
+	if (size != sizeof(struct td))
+		return alloc_low(size);
+
+	if (dma_exhausted)
+		return NULL;
+	assert_true(heap_td_next < HEAP_TDS);
+	heap_tds++;
+	return &heap_td[heap_td_next++];
+}
+
+static void mock_free(void *ptr)
+{
+	struct td *td = ptr;
+
+	if (heap_td && td >= heap_td && td < heap_td + HEAP_TDS) {
+		assert_true(heap_tds > 0);
+		heap_tds--;
+		return;
+	}
+	free(ptr);
+}
+
+void *dma_malloc(size_t size)
+{
+	return alloc_low(size);
+}
+
+int dma_coherent(const void *ptr)
+{
+	return 1;
+}
+
+void dcache_clean_by_mva(void const *addr, size_t len) {}
+void dcache_invalidate_by_mva(void const *addr, size_t len) {}
+void ndelay(uint64_t ns) {}
+
+void udc_add_gadget(struct usbdev_ctrl *this, struct usbdev_configuration *config) {}
+void udc_add_strings(unsigned short id, unsigned char count, const char *strings[]) {}
+void udc_handle_setup(struct usbdev_ctrl *this, int ep, dev_req_t *dr) {}
+
+uint32_t read32(volatile const void *addr)
+{
+	return readl(addr);
+}
+
+void write32(volatile void *addr, uint32_t val)
+{
+	writel(val, addr);
+}
+
+static struct qh *ctrl_qh(int ep, int in_dir)
+{
+	return get_qh(CI_PDATA(ctrl), ep, in_dir);
+}
+
+static uint32_t *reg(volatile const void *addr)
+{
+	const uintptr_t offset = (uintptr_t)addr - CI_MMIO_BASE;
+
+	assert_true(offset < sizeof(regs));
+	return (uint32_t *)((uint8_t *)&regs + offset);
+}
+
+uint32_t readl(volatile const void *addr)
+{
+	return *reg(addr);
+}
+
+void writel(uint32_t val, volatile void *addr)
+{
+	uint32_t *r = reg(addr);
+	int bit;
+
+	if (r == &regs.usbsts || r == &regs.epcomplete || r == &regs.epsetupstat) {
+		*r &= ~val;
+	} else if (r == &regs.epprime) {
+		for (bit = 0; bit < 32; bit++) {
+			if (!(val & (1 << bit)))
+				continue;
+			primes++;
+			hw_td[bit % 16][bit / 16] =
+				phys_to_virt(ctrl_qh(bit % 16, bit / 16)->td.next);
+			regs.epstat |= 1 << bit;
+		}
+	} else if (r == &regs.epflush) {
+		regs.epstat &= ~val;
+	} else {
+		*r = val;
+	}
+}
+
+/* Let the controller retire up to `count` dTDs of an endpoint. Returns the number retired. */
+static size_t mock_run(int ep, int in_dir, size_t count)
+{
+	const uint32_t bit = 1 << ep_to_bits(ep, in_dir);
+	size_t done = 0;
+
+	while (done < count && (regs.epstat & bit)) {
+		struct td *td = hw_td[ep][in_dir];
+
+		assert_true(td->info & TD_INFO_ACTIVE);
+		/* The buffer pages must cover the dTD */
+		assert_true((td->page0 & 0xfff) + (td->info >> 16) <= CI_TD_MAX_BYTES);
+		td->info &= ~(TD_INFO_ACTIVE | TD_INFO_LEN(0xffff));
+		if (td->info & TD_INFO_IOC) {
+			regs.epcomplete |= bit;
+			regs.usbsts |= USBSTS_UI;
+		}
+		tds_done++;
+		done++;
+
+		if (td->next == TD_TERMINATE) {
+			regs.epstat &= ~bit;
+			hw_td[ep][in_dir] = NULL;
+		} else {
+			hw_td[ep][in_dir] = phys_to_virt(td->next);
+		}
+	}
+
+	return done;
+}
+
+static void mock_poll(void)
+{
+	if (regs.usbsts & USBSTS_UI)
+		interrupts++;
+	ctrl->poll(ctrl);
+}
+
+static void handle_packet(struct usbdev_ctrl *this, int ep, int in_dir, void *data, int len)
+{
+	packets_handled++;
+	bytes_handled += len;
+}
+
+static int setup_ctrl(void **state)
+{
+	device_descriptor_t dd = {};
+
+	memset(&regs, 0, sizeof(regs));
+	regs.susp_ctrl = 1 << 7;
+	memset(hw_td, 0, sizeof(hw_td));
+	primes = tds_done = interrupts = packets_handled = bytes_handled = 0;
+	if (!heap_td)
+		heap_td = alloc_low(HEAP_TDS * sizeof(struct td));
+	heap_td_next = heap_tds = 0;
+	dma_exhausted = false;
+
+	ctrl = chipidea_init(&dd);
+	assert_non_null(ctrl);
+	gadget.config.interfaces[0].handle_packet = handle_packet;
+	ctrl->current_config = &gadget.config;
+	ctrl->initialized = 1;
+	ctrl->start_ep(ctrl, EP_BULK, 0, 2, 512);
+	ctrl->start_ep(ctrl, EP_BULK, 1, 2, 512);
+	primes = 0;
+
+	return 0;
+}
+
+static size_t count_tds(struct job *job)
+{
+	size_t count = 1;
+
+	for (struct td *td = job->first_td; td != job->last_td; td = phys_to_virt(td->next))
+		count++;
+	return count;
+}
+
+static void test_td_sizes(void **state)
+{
+	struct chipidea_pdata *p = CI_PDATA(ctrl);
+	u8 *buf = alloc_low(MiB + 4096);
+	const size_t offsets[] = { 0, 0x100, 0xe00 };
+
+	for (size_t i = 0; i < ARRAY_SIZE(offsets); i++) {
+		struct job *job;
+		struct td *td;
+		size_t total = 0, count = 0;
+
+		ctrl->enqueue_packet(ctrl, EP_BULK, 1, buf + offsets[i], MiB, 0, 0);
+		job = SIMPLEQ_FIRST(&p->job_queue[EP_BULK][1]);
+		assert_non_null(job->first_td);
+
+		for (td = job->first_td;; td = phys_to_virt(td->next)) {
+			const size_t len = td->info >> 16;
+
+			/* Only the last dTD may end in a short packet, or raise an interrupt */
+			if (td != job->last_td) {
+				assert_int_equal(0, len % 512);
+				assert_false(td->info & TD_INFO_IOC);
+			}
+			assert_true((td->page0 & 0xfff) + len <= CI_TD_MAX_BYTES);
+			assert_true(len >= CI_TD_MAX_BYTES - 0x1000 || td == job->last_td);
+			total += len;
+			count++;
+			if (td == job->last_td)
+				break;
+		}
+		assert_true(td->info & TD_INFO_IOC);
+		assert_int_equal(MiB, total);
+		/* 20 KiB per dTD, at least 16 KiB when the buffer isn't page aligned */
+		if (offsets[i] == 0)
+			assert_int_equal(DIV_ROUND_UP(MiB, CI_TD_MAX_BYTES), count);
+		else
+			assert_true(count <= DIV_ROUND_UP(MiB, CI_TD_MAX_BYTES - 0x1000));
+
+		mock_run(EP_BULK, 1, SIZE_MAX);
+		mock_poll();
+		assert_int_equal(i + 1, packets_handled);
+	}
+	assert_int_equal(CI_TD_POOL_SIZE, p->td_free_count);
+}
+
+static void test_zlp(void **state)
+{
+	struct chipidea_pdata *p = CI_PDATA(ctrl);
+	u8 *buf = alloc_low(4096);
+	struct job *job;
+
+	ctrl->enqueue_packet(ctrl, EP_BULK, 1, buf, 512, 1, 0);
+	job = SIMPLEQ_FIRST(&p->job_queue[EP_BULK][1]);
+	assert_int_equal(2, count_tds(job));
+	assert_int_equal(512, job->first_td->info >> 16);
+	assert_int_equal(0, job->last_td->info >> 16);
+	assert_false(job->first_td->info & TD_INFO_IOC);
+	assert_true(job->last_td->info & TD_INFO_IOC);
+
+	mock_run(EP_BULK, 1, SIZE_MAX);
+	mock_poll();
+	assert_int_equal(1, packets_handled);
+	assert_int_equal(512, bytes_handled);
+}
+
+/* Jobs queued while the endpoint runs are chained to it without another prime. */
+static void test_pipelining(void **state)
+{
+	struct chipidea_pdata *p = CI_PDATA(ctrl);
+	const size_t job_size = 256 * 1024, num_jobs = 4;
+	u8 *buf = alloc_low(num_jobs * job_size);
+	struct job *job;
+
+	for (size_t i = 0; i < num_jobs; i++)
+		ctrl->enqueue_packet(ctrl, EP_BULK, 0, buf + i * job_size, job_size, 0, 0);
+
+	SIMPLEQ_FOREACH(job, &p->job_queue[EP_BULK][0], queue)
+		assert_non_null(job->first_td);
+	assert_int_equal(1, primes);
+
+	/* The controller runs through all of them back to back */
+	mock_run(EP_BULK, 0, SIZE_MAX);
+	mock_poll();
+	assert_int_equal(num_jobs, packets_handled);
+	assert_int_equal(num_jobs * job_size, bytes_handled);
+	assert_int_equal(1, interrupts);
+	assert_null(p->last_td[EP_BULK][0]);
+	assert_int_equal(CI_TD_POOL_SIZE, p->td_free_count);
+}
+
+/* The controller went idle before the new dTDs were appended, so they need a prime. */
+static void test_append_after_idle(void **state)
+{
+	u8 *buf = alloc_low(2 * 4096);
+
+	ctrl->enqueue_packet(ctrl, EP_BULK, 1, buf, 4096, 0, 0);
+	mock_run(EP_BULK, 1, SIZE_MAX);
+
+	ctrl->enqueue_packet(ctrl, EP_BULK, 1, buf + 4096, 4096, 0, 0);
+	assert_int_equal(2, primes);
+
+	mock_run(EP_BULK, 1, SIZE_MAX);
+	mock_poll();
+	assert_int_equal(2, packets_handled);
+}
+
+/* Without memory for more dTDs, jobs are linked as the pool refills. */
+static void test_pool_exhaustion(void **state)
+{
+	struct chipidea_pdata *p = CI_PDATA(ctrl);
+	const size_t num_jobs = 8;
+	u8 *buf = alloc_low(num_jobs * MiB);
+	size_t linked = 0;
+	struct job *job;
+
+	dma_exhausted = true;
+	for (size_t i = 0; i < num_jobs; i++)
+		ctrl->enqueue_packet(ctrl, EP_BULK, 0, buf + i * MiB, MiB, 0, 0);
+	SIMPLEQ_FOREACH(job, &p->job_queue[EP_BULK][0], queue)
+		linked += job->first_td != NULL;
+	assert_int_equal(CI_TD_POOL_SIZE / DIV_ROUND_UP(MiB, CI_TD_MAX_BYTES), linked);
+
+	while (packets_handled < num_jobs) {
+		assert_true(mock_run(EP_BULK, 0, 16) > 0);
+		mock_poll();
+	}
+	assert_int_equal(num_jobs * MiB, bytes_handled);
+	assert_int_equal(CI_TD_POOL_SIZE, p->td_free_count);
+}
+
+/* A job needing more dTDs than the pool holds takes the rest from the DMA heap. */
+static void test_job_larger_than_pool(void **state)
+{
+	struct chipidea_pdata *p = CI_PDATA(ctrl);
+	const size_t job_size = 8 * MiB;
+	const size_t tds = DIV_ROUND_UP(job_size, CI_TD_MAX_BYTES);
+	u8 *buf = alloc_low(job_size);
+	struct job *job;
+
+	assert_true(tds > CI_TD_POOL_SIZE);
+	ctrl->enqueue_packet(ctrl, EP_BULK, 0, buf, job_size, 0, 0);
+	job = SIMPLEQ_FIRST(&p->job_queue[EP_BULK][0]);
+	assert_non_null(job->first_td);
+	assert_int_equal(tds, count_tds(job));
+	assert_int_equal(tds - CI_TD_POOL_SIZE, heap_tds);
+
+	mock_run(EP_BULK, 0, SIZE_MAX);
+	mock_poll();
+	assert_int_equal(1, packets_handled);
+	assert_int_equal(job_size, bytes_handled);
+	assert_int_equal(0, heap_tds);
+	assert_int_equal(CI_TD_POOL_SIZE, p->td_free_count);
+}
+
+/* dTDs freed by one endpoint are handed to another one waiting for them. */
+static void test_endpoints_share_pool(void **state)
+{
+	struct chipidea_pdata *p = CI_PDATA(ctrl);
+	u8 *buf = alloc_low(3 * MiB);
+	struct job *in_job;
+
+	dma_exhausted = true;
+	ctrl->enqueue_packet(ctrl, EP_BULK, 0, buf, MiB, 0, 0);
+	ctrl->enqueue_packet(ctrl, EP_BULK, 0, buf + MiB, MiB, 0, 0);
+	ctrl->enqueue_packet(ctrl, EP_BULK, 1, buf + 2 * MiB, MiB, 0, 0);
+	in_job = SIMPLEQ_FIRST(&p->job_queue[EP_BULK][1]);
+	assert_null(in_job->first_td);
+
+	/* Nothing completes on the IN endpoint, the OUT endpoint returns the dTDs */
+	mock_run(EP_BULK, 0, SIZE_MAX);
+	mock_poll();
+	assert_int_equal(2, packets_handled);
+	assert_non_null(in_job->first_td);
+	assert_int_equal(0, p->td_waiting);
+
+	mock_run(EP_BULK, 1, SIZE_MAX);
+	mock_poll();
+	assert_int_equal(3, packets_handled);
+	assert_int_equal(3 * MiB, bytes_handled);
+	assert_int_equal(CI_TD_POOL_SIZE, p->td_free_count);
+}
+
+static void test_ep0_one_job_at_a_time(void **state)
+{
+	struct chipidea_pdata *p = CI_PDATA(ctrl);
+	u8 *buf = alloc_low(4096);
+	struct job *second;
+
+	ctrl->enqueue_packet(ctrl, 0, 1, buf, 64, 0, 0);
+	ctrl->enqueue_packet(ctrl, 0, 1, buf, 0, 0, 0);
+	second = SIMPLEQ_NEXT(SIMPLEQ_FIRST(&p->job_queue[0][1]), queue);
+	assert_null(second->first_td);
+
+	mock_run(0, 1, SIZE_MAX);
+	mock_poll();
+	assert_non_null(second->first_td);
+	assert_int_equal(2, primes);
+}
+
+static void test_halt_releases_tds(void **state)
+{
+	struct chipidea_pdata *p = CI_PDATA(ctrl);
+	u8 *buf = alloc_low(MiB);
+
+	ctrl->enqueue_packet(ctrl, EP_BULK, 0, buf, MiB, 0, 0);
+	assert_true(p->td_free_count < CI_TD_POOL_SIZE);
+	ctrl->halt_ep(ctrl, EP_BULK, 0);
+	assert_true(SIMPLEQ_EMPTY(&p->job_queue[EP_BULK][0]));
+	assert_null(p->last_td[EP_BULK][0]);
+	assert_int_equal(CI_TD_POOL_SIZE, p->td_free_count);
+}
+
+/*
+ * Stream 64 MiB as fastboot would (1 MiB jobs, the next one queued as soon as one
+ * completes) with the host taking a poll interval for every 16 dTDs.
+ */
+static void test_throughput_stats(void **state)
+{
+	const size_t total = 64 * MiB, job_size = MiB;
+	u8 *buf = alloc_low(2 * job_size);
+	size_t queued = 0;
+
+	for (; queued < 2 * job_size; queued += job_size)
+		ctrl->enqueue_packet(ctrl, EP_BULK, 0, buf + queued % (2 * job_size),
+				     job_size, 0, 0);
+
+	while (bytes_handled < total) {
+		const size_t before = packets_handled;
+
+		assert_true(mock_run(EP_BULK, 0, 16) > 0);
+		mock_poll();
+		for (size_t i = before; i < packets_handled && queued < total; i++) {
+			ctrl->enqueue_packet(ctrl, EP_BULK, 0, buf + queued % (2 * job_size),
+					     job_size, 0, 0);
+			queued += job_size;
+		}
+	}
+
+	print_message("dTDs per MiB: %zu, interrupts per MiB: %zu.%02zu, primes: %zu\n",
+		      tds_done / (total / MiB), interrupts / (total / MiB),
+		      interrupts * 100 / (total / MiB) % 100, primes);
+	assert_int_equal(DIV_ROUND_UP(MiB, CI_TD_MAX_BYTES), tds_done / (total / MiB));
+	assert_true(interrupts <= total / MiB);
+	/* The endpoint never ran dry, so it was only primed once. */
+	assert_int_equal(1, primes);
+}
+
+int main(void)
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test_setup(test_td_sizes, setup_ctrl),
+		cmocka_unit_test_setup(test_zlp, setup_ctrl),
+		cmocka_unit_test_setup(test_pipelining, setup_ctrl),
+		cmocka_unit_test_setup(test_append_after_idle, setup_ctrl),
+		cmocka_unit_test_setup(test_pool_exhaustion, setup_ctrl),
+		cmocka_unit_test_setup(test_job_larger_than_pool, setup_ctrl),
+		cmocka_unit_test_setup(test_endpoints_share_pool, setup_ctrl),
+		cmocka_unit_test_setup(test_ep0_one_job_at_a_time, setup_ctrl),
+		cmocka_unit_test_setup(test_halt_releases_tds, setup_ctrl),
+		cmocka_unit_test_setup(test_throughput_stats, setup_ctrl),
+	};
+
+	return lp_run_group_tests(tests, NULL, NULL);
+}
@@ -6,6 +6,7 @@ tests-y += cbfs-verification-no-sha512-test
 tests-y += cbfs-verification-has-sha512-test
 tests-y += cbfs-no-verification-no-sha512-test
 tests-y += cbfs-no-verification-has-sha512-test
+tests-y += cbfs-cache-test
 
 
 cbfs-lookup-no-fallback-test-srcs += tests/libcbfs/cbfs-lookup-test.c
@@ -31,3 +32,8 @@ cbfs-verification-has-sha512-test-config += CONFIG_LP_CBFS_VERIFICATION=0
 $(call copy-test,cbfs-verification-no-sha512-test,cbfs-no-verification-has-sha512-test)
 cbfs-verification-has-sha512-test-config += CONFIG_LP_CBFS_VERIFICATION=0
 cbfs-verification-has-sha512-test-config += VB2_SUPPORT_SHA512=1
+
+cbfs-cache-test-srcs += tests/libcbfs/cbfs-cache-test.c
+cbfs-cache-test-config += CONFIG_LP_CBFS_CACHE=1
+cbfs-cache-test-config += CONFIG_LP_CBFS_CACHE_SIZE=0x100
+cbfs-cache-test-config += CONFIG_LP_LZMA=1
@@ -0,0 +1,334 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+
+#include <libpayload-config.h>
+#include <cbfs.h>
+#include <cbfs_glue.h>
+#include <commonlib/bsd/cb_err.h>
+#include <commonlib/bsd/cbfs_mdata.h>
+#include <endian.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sysinfo.h>
+#include <tests/test.h>
+
+#include "../libcbfs/cbfs.c"
+
+/* Fake flash holding the file contents, metadata comes from the table below */
+static u8 flash[0x800];
+static size_t flash_reads;
+static size_t decompressions;
+static bool fail_next_read;
+
+struct test_file {
+	const char *name;
+	size_t data_offset;
+	size_t size;
+	bool compressed;
+	union cbfs_mdata mdata;
+};
+
+static struct test_file test_files[] = {
+	{ .name = "logo.bmp", .data_offset = 0x100, .size = 64, .compressed = true },
+	{ .name = "strings", .data_offset = 0x200, .size = 96 },
+	{ .name = "font", .data_offset = 0x300, .size = 128, .compressed = true },
+	/* Bigger than CONFIG_LP_CBFS_CACHE_SIZE */
+	{ .name = "big", .data_offset = 0x400, .size = 0x180 },
+};
+
+static struct cbfs_file_attr_compression lzma_attr;
+
+unsigned long virtual_offset = 0;
+struct sysinfo_t lib_sysinfo;
+
+unsigned long ulzman(const unsigned char *src, unsigned long srcn, unsigned char *dst,
+		     unsigned long dstn)
+{
+	decompressions++;
+	memcpy(dst, src, MIN(srcn, dstn));
+	return dstn;
+}
+
+size_t ulz4fn(const void *src, size_t srcn, void *dst, size_t dstn)
+{
+	fail_msg("Unexpected LZ4 decompression");
+	return 0;
+}
+
+enum cb_err fmap_locate_area(const char *name, size_t *offset, size_t *size)
+{
+	*offset = 0;
+	*size = sizeof(flash);
+	return CB_SUCCESS;
+}
+
+static struct test_file *find_test_file(const char *name)
+{
+	for (size_t i = 0; i < ARRAY_SIZE(test_files); i++) {
+		if (!strcmp(test_files[i].name, name))
+			return &test_files[i];
+	}
+	return NULL;
+}
+
+enum cb_err cbfs_mcache_lookup(const void *mcache, size_t mcache_size, const char *name,
+			       union cbfs_mdata *mdata_out, size_t *data_offset_out)
+{
+	return CB_CBFS_CACHE_FULL;
+}
+
+enum cb_err cbfs_lookup(cbfs_dev_t dev, const char *name, union cbfs_mdata *mdata_out,
+			size_t *data_offset_out, struct vb2_hash *metadata_hash)
+{
+	struct test_file *file = find_test_file(name);
+
+	if (!file)
+		return CB_CBFS_NOT_FOUND;
+
+	memcpy(mdata_out, &file->mdata, sizeof(*mdata_out));
+	*data_offset_out = file->data_offset;
+	return CB_SUCCESS;
+}
+
+const void *cbfs_find_attr(const union cbfs_mdata *mdata, uint32_t attr_tag, size_t size_check)
+{
+	struct test_file *file = find_test_file(mdata->h.filename);
+
+	assert_non_null(file);
+	if (attr_tag != CBFS_FILE_ATTR_TAG_COMPRESSION || !file->compressed)
+		return NULL;
+
+	lzma_attr.compression = htobe32(CBFS_COMPRESS_LZMA);
+	lzma_attr.decompressed_size = htobe32(file->size);
+	return &lzma_attr;
+}
+
+ssize_t boot_device_read(void *buf, size_t offset, size_t size)
+{
+	assert_true(offset + size <= sizeof(flash));
+	flash_reads++;
+	if (fail_next_read) {
+		fail_next_read = false;
+		return CB_ERR;
+	}
+	memcpy(buf, &flash[offset], size);
+	return size;
+}
+
+static int setup_cache(void **state)
+{
+	for (size_t i = 0; i < ARRAY_SIZE(test_files); i++) {
+		struct test_file *file = &test_files[i];
+		union cbfs_mdata *mdata = &file->mdata;
+
+		memset(mdata, 0, sizeof(*mdata));
+		memcpy(mdata->h.magic, CBFS_FILE_MAGIC, sizeof(mdata->h.magic));
+		mdata->h.len = htobe32(file->size);
+		mdata->h.type = htobe32(CBFS_TYPE_RAW);
+		mdata->h.offset = htobe32(sizeof(mdata->h) + 16);
+		strcpy(mdata->h.filename, file->name);
+	}
+	for (size_t i = 0; i < sizeof(flash); i++)
+		flash[i] = i * 7 + (i >> 8);
+
+	lib_sysinfo.cbfs_offset = 0;
+	lib_sysinfo.cbfs_size = sizeof(flash);
+
+	cbfs_cache_flush();
+	memset(&cbfs_cache_stats, 0, sizeof(cbfs_cache_stats));
+	flash_reads = 0;
+	decompressions = 0;
+	fail_next_read = false;
+	return 0;
+}
+
+static void assert_stats(size_t hits, size_t misses, size_t evictions, size_t bytes_used)
+{
+	struct cbfs_cache_stats stats;
+
+	cbfs_cache_get_stats(&stats);
+	assert_int_equal(hits, stats.hits);
+	assert_int_equal(misses, stats.misses);
+	assert_int_equal(evictions, stats.evictions);
+	assert_int_equal(bytes_used, stats.bytes_used);
+}
+
+/* Repeated lookups of a compressed file only hit the flash and the decompressor once. */
+static void test_cbfs_cache_repeated_map(void **state)
+{
+	const int rounds = 100;
+	void *first, *mapping;
+	size_t size;
+
+	first = cbfs_map("logo.bmp", &size);
+	assert_non_null(first);
+	assert_int_equal(64, size);
+	assert_memory_equal(&flash[0x100], first, size);
+
+	for (int i = 0; i < rounds; i++) {
+		size = 0;
+		mapping = cbfs_map("logo.bmp", &size);
+		assert_ptr_equal(first, mapping);
+		assert_int_equal(64, size);
+		cbfs_unmap(mapping);
+	}
+	cbfs_unmap(first);
+
+	assert_int_equal(1, flash_reads);
+	assert_int_equal(1, decompressions);
+	assert_stats(rounds, 1, 0, 64);
+}
+
+static void test_cbfs_cache_load(void **state)
+{
+	u8 buf[128];
+	void *mapping;
+
+	/* A load populates the cache with a private copy */
+	memset(buf, 0, sizeof(buf));
+	assert_int_equal(96, cbfs_load("strings", buf, sizeof(buf)));
+	assert_memory_equal(&flash[0x200], buf, 96);
+	memset(buf, 0, sizeof(buf));
+
+	assert_int_equal(96, cbfs_load("strings", buf, sizeof(buf)));
+	assert_memory_equal(&flash[0x200], buf, 96);
+	mapping = cbfs_map("strings", NULL);
+	assert_non_null(mapping);
+	assert_ptr_not_equal(buf, mapping);
+	assert_memory_equal(&flash[0x200], mapping, 96);
+	cbfs_unmap(mapping);
+
+	/* Cached contents still respect the buffer size */
+	assert_int_equal(0, cbfs_load("strings", buf, 95));
+
+	assert_int_equal(1, flash_reads);
+	assert_stats(3, 1, 0, 96);
+}
+
+static void test_cbfs_cache_evicts_lru_unpinned(void **state)
+{
+	void *logo, *strings, *font;
+
+	logo = cbfs_map("logo.bmp", NULL);
+	strings = cbfs_map("strings", NULL);
+	assert_non_null(logo);
+	assert_non_null(strings);
+	cbfs_unmap(logo);
+
+	/* Only the unpinned logo can make room */
+	font = cbfs_map("font", NULL);
+	assert_non_null(font);
+	assert_stats(0, 3, 1, 96 + 128);
+
+	/* Nothing left to evict, the logo gets handed out uncached */
+	logo = cbfs_map("logo.bmp", NULL);
+	assert_non_null(logo);
+	assert_memory_equal(&flash[0x100], logo, 64);
+	assert_stats(0, 4, 1, 96 + 128);
+	cbfs_unmap(logo);
+
+	cbfs_unmap(strings);
+	strings = cbfs_map("strings", NULL);
+	assert_non_null(strings);
+	assert_stats(1, 4, 1, 96 + 128);
+	cbfs_unmap(strings);
+	cbfs_unmap(font);
+}
+
+static void test_cbfs_cache_too_big(void **state)
+{
+	void *mapping;
+
+	for (int i = 0; i < 2; i++) {
+		mapping = cbfs_map("big", NULL);
+		assert_non_null(mapping);
+		cbfs_unmap(mapping);
+	}
+
+	assert_int_equal(2, flash_reads);
+	assert_stats(0, 2, 0, 0);
+}
+
+static void test_cbfs_cache_metadata_change(void **state)
+{
+	struct test_file *file = find_test_file("strings");
+
+	cbfs_unmap(cbfs_map("strings", NULL));
+
+	/* Same name and location, but different metadata (e.g. a new file hash) */
+	file->mdata.h.type = htobe32(CBFS_TYPE_STRUCT);
+	cbfs_unmap(cbfs_map("strings", NULL));
+
+	assert_int_equal(2, flash_reads);
+	assert_stats(0, 2, 0, 2 * 96);
+}
+
+static void test_cbfs_cache_failed_load(void **state)
+{
+	fail_next_read = true;
+	assert_null(cbfs_map("font", NULL));
+	assert_stats(0, 1, 0, 0);
+
+	cbfs_unmap(cbfs_map("font", NULL));
+	cbfs_unmap(cbfs_map("font", NULL));
+	assert_int_equal(1, decompressions);
+	assert_stats(1, 2, 0, 128);
+}
+
+static void test_cbfs_cache_unverified(void **state)
+{
+	void *mapping;
+
+	/* Contents loaded without verification don't satisfy a verified load... */
+	mapping = cbfs_unverified_area_map("RW_LEGACY", "strings", NULL);
+	assert_non_null(mapping);
+	cbfs_unmap(mapping);
+	mapping = cbfs_map("strings", NULL);
+	assert_non_null(mapping);
+	cbfs_unmap(mapping);
+	assert_stats(0, 2, 0, 2 * 96);
+
+	/* ...but verified contents are good for anybody */
+	cbfs_cache_flush();
+	cbfs_unmap(cbfs_map("font", NULL));
+	cbfs_unmap(cbfs_unverified_area_map("RW_LEGACY", "font", NULL));
+	assert_stats(1, 3, 0, 128);
+}
+
+static void test_cbfs_cache_flush(void **state)
+{
+	void *old, *new;
+
+	old = cbfs_map("logo.bmp", NULL);
+	assert_non_null(old);
+
+	/* Pinned contents stay valid, but are not handed out anymore */
+	cbfs_cache_flush();
+	assert_stats(0, 1, 0, 64);
+	assert_memory_equal(&flash[0x100], old, 64);
+
+	new = cbfs_map("logo.bmp", NULL);
+	assert_ptr_not_equal(old, new);
+	assert_stats(0, 2, 0, 2 * 64);
+
+	cbfs_unmap(old);
+	assert_stats(0, 2, 0, 64);
+	cbfs_unmap(new);
+	cbfs_cache_flush();
+	assert_stats(0, 2, 0, 0);
+}
+
+int main(void)
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test_setup(test_cbfs_cache_repeated_map, setup_cache),
+		cmocka_unit_test_setup(test_cbfs_cache_load, setup_cache),
+		cmocka_unit_test_setup(test_cbfs_cache_evicts_lru_unpinned, setup_cache),
+		cmocka_unit_test_setup(test_cbfs_cache_too_big, setup_cache),
+		cmocka_unit_test_setup(test_cbfs_cache_metadata_change, setup_cache),
+		cmocka_unit_test_setup(test_cbfs_cache_failed_load, setup_cache),
+		cmocka_unit_test_setup(test_cbfs_cache_unverified, setup_cache),
+		cmocka_unit_test_setup(test_cbfs_cache_flush, setup_cache),
+	};
+
+	return lp_run_group_tests(tests, NULL, NULL);
+}
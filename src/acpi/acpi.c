@@ -340,8 +340,10 @@ static void acpi_create_ssdt_generator(acpi_header_t *ssdt, void *unused)
 	{
 		struct device *dev;
 		for (dev = all_devices; dev; dev = dev->next)
-			if (dev->enabled && dev->ops && dev->ops->acpi_fill_ssdt)
+			if (dev->enabled && dev->ops && dev->ops->acpi_fill_ssdt) {
+				dev_ensure_initialized(dev);
 				dev->ops->acpi_fill_ssdt(dev);
+			}
 		current = (unsigned long)acpigen_get_current();
 	}
 
@@ -1660,6 +1662,7 @@ unsigned long write_acpi_tables(const unsigned long start)
 
 	for (dev = all_devices; dev; dev = dev->next) {
 		if (dev->ops && dev->ops->write_acpi_tables) {
+			dev_ensure_initialized(dev);
 			current = dev->ops->write_acpi_tables(dev, current,
 				rsdp);
 			current = acpi_align_current(current);
@@ -4,7 +4,6 @@
 #include <acpi/acpi.h>
 #include <arch/ioapic.h>
 #include <arch/smp/mpspec.h>
-#include <commonlib/sort.h>
 #include <cpu/cpu.h>
 #include <device/device.h>
 
@@ -61,23 +60,17 @@ unsigned long acpi_create_madt_one_lapic(unsigned long current, u32 index, u32 l
  */
 static unsigned long acpi_create_madt_lapics(unsigned long current)
 {
-	struct device *cpu;
-	int index, apic_ids[CONFIG_MAX_CPUS] = {0}, num_cpus = 0, sort_start = 0;
-	for (unsigned int thread_id = 0; thread_id <= MAX_THREAD_ID; thread_id++) {
-		for (cpu = all_devices; cpu; cpu = cpu->next) {
-			if (!is_enabled_cpu(cpu))
-				continue;
-			if (num_cpus >= ARRAY_SIZE(apic_ids))
-				break;
-			if (cpu->path.apic.thread_id != thread_id)
-				continue;
-			apic_ids[num_cpus++] = cpu->path.apic.apic_id;
-		}
-		bubblesort(&apic_ids[sort_start], num_cpus - sort_start, NUM_ASCENDING);
-		sort_start = num_cpus;
+	const struct cpu_topology *topology = cpu_topology_snapshot();
+	u32 index = 0;
+
+	/* The snapshot is already sorted by thread ID, then APIC ID. */
+	for (size_t i = 0; i < topology->num_cpus && index < CONFIG_MAX_CPUS; i++) {
+		const struct device *cpu = topology->cpus[i];
+
+		if (cpu->path.apic.thread_id > MAX_THREAD_ID)
+			break;
+		current = acpi_create_madt_one_lapic(current, index++, cpu->path.apic.apic_id);
 	}
-	for (index = 0; index < num_cpus; index++)
-		current = acpi_create_madt_one_lapic(current, index, apic_ids[index]);
 
 	return current;
 }
@@ -3,6 +3,8 @@
 #ifndef _RISCV_SMP_H
 #define _RISCV_SMP_H
 
+#include <types.h>
+
 unsigned int smp_get_hart_count(void);
 
 /*
@@ -19,4 +21,23 @@ void smp_pause(int working_hartid);
  */
 void smp_resume(void (*fn)(void *), void *arg);
 
+/*
+ * These functions let the working hart hand work to the harts halted by
+ * smp_pause, in the spirit of mp_run_on_aps() on x86. A hart runs one
+ * function at a time on its small machine stack and then goes back to
+ * sleep, so smp_resume can still release it afterwards. Only the working
+ * hart may call them, and the work must not use the console or any other
+ * state the working hart touches meanwhile.
+ *
+ * smp_run_on_hart queues fn(arg) on hartid and returns right away, so the
+ * working hart can carry on. It fails if the hart is not parked or still
+ * busy. smp_wait_for_hart waits for the work to complete. expire_us <= 0
+ * means an infinite timeout.
+ */
+enum cb_err smp_run_on_hart(int hartid, void (*fn)(void *), void *arg);
+enum cb_err smp_wait_for_hart(int hartid, long expire_us);
+
+/* Run fn(arg) on all parked harts in parallel and wait for them to finish */
+enum cb_err smp_run_on_all_harts(void (*fn)(void *), void *arg, long expire_us);
+
 #endif
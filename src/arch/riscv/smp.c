@@ -4,13 +4,23 @@
 #include <arch/encoding.h>
 #include <arch/smp/smp.h>
 #include <arch/smp/atomic.h>
+#include <commonlib/helpers.h>
 #include <console/console.h>
 #include <mcall.h>
+#include <timer.h>
+#include <types.h>
 
 // made up value to sync hart state
 #define HART_SLEEPING 0x1
 #define HART_AWAKE    0x2
 
+// made up value to sync work handed out by smp_run_on_hart
+#define HART_IDLE         0x0
+#define HART_WORK_PENDING 0x1
+
+// how long smp_resume waits for work handed out by smp_run_on_hart
+#define SMP_RESUME_WORK_TIMEOUT_US (1 * USECS_PER_SEC)
+
 void smp_pause(int working_hartid)
 {
 	int hartid = read_csr(mhartid);
@@ -20,19 +30,107 @@ void smp_pause(int working_hartid)
 		clear_csr(mstatus, MSTATUS_MIE); // disable all interrupts
 		set_msip(hartid, 0); // clear pending interrupts
 		write_csr(mie, MIP_MSIP); // enable only IPI (for smp_resume)
+		atomic_set(&HLS()->entry.sync_b, HART_IDLE);
 		barrier();
 		atomic_set(&HLS()->entry.sync_a, HART_SLEEPING); // mark the hart as sleeping.
 
-		// pause hart
-		do {
-			__asm__ volatile ("wfi"); // wait for interrupt
-		} while ((read_csr(mip) & MIP_MSIP) == 0);
+		for (;;) {
+			// pause hart
+			do {
+				__asm__ volatile ("wfi"); // wait for interrupt
+			} while ((read_csr(mip) & MIP_MSIP) == 0);
+			barrier();
+
+			if (atomic_read(&HLS()->entry.sync_b) != HART_WORK_PENDING)
+				break;
+
+			// run the work from smp_run_on_hart and go back to sleep
+			set_msip(hartid, 0);
+			HLS()->entry.fn(HLS()->entry.arg);
+			barrier();
+			atomic_set(&HLS()->entry.sync_b, HART_IDLE);
+		}
 
 		atomic_set(&HLS()->entry.sync_a, HART_AWAKE); // mark the hart as awake
 		HLS()->entry.fn(HLS()->entry.arg);
 	}
 }
 
+static int get_hart_count(void)
+{
+	if (CONFIG(RISCV_GET_HART_COUNT_AT_RUNTIME))
+		return smp_get_hart_count();
+	return CONFIG_MAX_CPUS;
+}
+
+// must only be called by the WORKING_HARTID
+enum cb_err smp_run_on_hart(int hartid, void (*fn)(void *), void *arg)
+{
+	if (fn == NULL || hartid == read_csr(mhartid) ||
+	    hartid < 0 || hartid >= CONFIG_MAX_CPUS)
+		return CB_ERR_ARG;
+
+	if (!OTHER_HLS(hartid)->enabled ||
+	    atomic_read(&OTHER_HLS(hartid)->entry.sync_a) != HART_SLEEPING ||
+	    atomic_read(&OTHER_HLS(hartid)->entry.sync_b) != HART_IDLE)
+		return CB_ERR;
+
+	OTHER_HLS(hartid)->entry.fn = fn;
+	OTHER_HLS(hartid)->entry.arg = arg;
+	atomic_set(&OTHER_HLS(hartid)->entry.sync_b, HART_WORK_PENDING);
+	barrier();
+	set_msip(hartid, 1); // wake up hart
+	return CB_SUCCESS;
+}
+
+// must only be called by the WORKING_HARTID
+enum cb_err smp_wait_for_hart(int hartid, long expire_us)
+{
+	atomic_t *sync = &OTHER_HLS(hartid)->entry.sync_b;
+
+	if (expire_us <= 0) {
+		while (atomic_read(sync) != HART_IDLE)
+			;
+	} else if (!wait_us(expire_us, atomic_read(sync) == HART_IDLE)) {
+		printk(BIOS_ERR, "hart %d did not finish its work in %ld us\n",
+		       hartid, expire_us);
+		return CB_ERR;
+	}
+	barrier();
+	return CB_SUCCESS;
+}
+
+// must only be called by the WORKING_HARTID
+enum cb_err smp_run_on_all_harts(void (*fn)(void *), void *arg, long expire_us)
+{
+	int working_hartid = read_csr(mhartid);
+	int hart_count = get_hart_count();
+	bool started[CONFIG_MAX_CPUS] = { 0 };
+	enum cb_err ret = CB_SUCCESS;
+	struct stopwatch sw;
+
+	if (fn == NULL)
+		return CB_ERR_ARG;
+
+	for (int i = 0; i < hart_count && i < CONFIG_MAX_CPUS; i++) {
+		if (i != working_hartid)
+			started[i] = smp_run_on_hart(i, fn, arg) == CB_SUCCESS;
+	}
+
+	// the timeout covers all harts, as they run in parallel
+	stopwatch_init_usecs_expire(&sw, expire_us);
+	for (int i = 0; i < hart_count && i < CONFIG_MAX_CPUS; i++) {
+		if (!started[i])
+			continue;
+		long remaining = 0;
+		if (expire_us > 0)
+			remaining = MAX(1, expire_us - stopwatch_duration_usecs(&sw));
+		if (smp_wait_for_hart(i, remaining) != CB_SUCCESS)
+			ret = CB_ERR;
+	}
+	return ret;
+}
+
 // must only be called by the WORKING_HARTID
 void smp_resume(void (*fn)(void *), void *arg)
 {
@@ -43,9 +141,7 @@ void smp_resume(void (*fn)(void *), void *arg)
 
 	int working_hartid = read_csr(mhartid);
 
-	int hart_count = CONFIG_MAX_CPUS;
-	if (CONFIG(RISCV_GET_HART_COUNT_AT_RUNTIME))
-		hart_count = smp_get_hart_count();
+	int hart_count = get_hart_count();
 
 	// check that all harts are present
 
@@ -66,6 +162,14 @@ void smp_resume(void (*fn)(void *), void *arg)
 		} else {
 			// hart is in wfi (wait for interrupt) state like it should be.
 
+			// let it finish work handed out by smp_run_on_hart first
+			if (smp_wait_for_hart(i, SMP_RESUME_WORK_TIMEOUT_US) != CB_SUCCESS) {
+				/* its work loop still uses entry.fn, leave the hart alone */
+				printk(BIOS_ERR, "hart %d is still busy, not resuming it\n", i);
+				OTHER_HLS(i)->enabled = 0; // disable hart
+				continue;
+			}
+
 			OTHER_HLS(i)->entry.fn = fn;
 			OTHER_HLS(i)->entry.arg = arg;
 			barrier();
@@ -53,6 +53,9 @@ static inline unsigned int cpuid_get_max_func(void)
 #define CPUID_FEATURE_PSE36 (1 << 17)
 #define CPUID_FEATURE_HTT (1 << 28)
 
+/* CPUID leaf 1 ECX */
+#define CPUID_FEATURE_MONITOR (1 << 3)
+
 /* Structured Extended Feature Flags */
 #define CPUID_STRUCT_EXTENDED_FEATURE_FLAGS 0x7
 
@@ -7,6 +7,7 @@
 #include <console/console.h>
 #include <cpu/x86/lapic.h>
 #include <inttypes.h>
+#include <s3_boot_script.h>
 #include <types.h>
 
 #define ALL		(0xff << 24)
@@ -30,10 +31,11 @@ static u32 io_apic_read(uintptr_t ioapic_base, u32 reg)
 	return read32p(ioapic_base + 0x10);
 }
 
+/* The IOAPIC loses its setup in S3, so the writes go into the S3 boot script. */
 static void io_apic_write(uintptr_t ioapic_base, u32 reg, u32 value)
 {
-	write32p(ioapic_base, reg);
-	write32p(ioapic_base + 0x10, value);
+	s3_script_write32(ioapic_base, reg);
+	s3_script_write32(ioapic_base + 0x10, value);
 }
 
 static void write_vector(uintptr_t ioapic_base, u8 vector, u32 high, u32 low)
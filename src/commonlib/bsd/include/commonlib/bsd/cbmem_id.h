@@ -46,6 +46,7 @@
 #define CBMEM_ID_NONE		0x00000000
 #define CBMEM_ID_PIRQ		0x49525154
 #define CBMEM_ID_POWER_STATE	0x50535454
+#define CBMEM_ID_POWER_TIMELINE	0x5057544c
 #define CBMEM_ID_RAM_OOPS	0x05430095
 #define CBMEM_ID_RAMSTAGE	0x9a357a9e
 #define CBMEM_ID_RAMSTAGE_CACHE	0x9a3ca54e
@@ -56,6 +57,7 @@
 #define CBMEM_ID_ROMSTAGE_INFO	0x47545352
 #define CBMEM_ID_ROMSTAGE_RAM_STACK 0x90357ac4
 #define CBMEM_ID_ROOT		0xff4007ff
+#define CBMEM_ID_S3_SCRIPT	0x53335343
 #define CBMEM_ID_SMBIOS		0x534d4254
 #define CBMEM_ID_SMM_SAVE_SPACE	0x07e9acee
 #define CBMEM_ID_STAGEx_META	0x57a9e000
@@ -133,6 +135,7 @@
 	{ CBMEM_ID_MTC,			"MTC        " }, \
 	{ CBMEM_ID_PIRQ,		"IRQ TABLE  " }, \
 	{ CBMEM_ID_POWER_STATE,		"POWER STATE" }, \
+	{ CBMEM_ID_POWER_TIMELINE,	"PWR TIMELN " }, \
 	{ CBMEM_ID_RAM_OOPS,		"RAMOOPS    " }, \
 	{ CBMEM_ID_RAMSTAGE_CACHE,	"RAMSTAGE $ " }, \
 	{ CBMEM_ID_RAMSTAGE,		"RAMSTAGE   " }, \
@@ -143,6 +146,7 @@
 	{ CBMEM_ID_ROMSTAGE_INFO,	"ROMSTAGE   " }, \
 	{ CBMEM_ID_ROMSTAGE_RAM_STACK,	"ROMSTG STCK" }, \
 	{ CBMEM_ID_ROOT,		"CBMEM ROOT " }, \
+	{ CBMEM_ID_S3_SCRIPT,		"S3 SCRIPT  " }, \
 	{ CBMEM_ID_SMBIOS,		"SMBIOS     " }, \
 	{ CBMEM_ID_SMM_SAVE_SPACE,	"SMM BACKUP " }, \
 	{ CBMEM_ID_STORAGE_DATA,	"SD/MMC/eMMC" }, \
@@ -90,6 +90,7 @@ enum {
 	LB_TAG_EFI_FW_INFO		= 0x0045,
 	LB_TAG_CAPSULE			= 0x0046,
 	LB_TAG_CFR_ROOT			= 0x0047,
+	LB_TAG_MMC_TUNING		= 0x0048,
 	/* The following options are CMOS-related */
 	LB_TAG_CMOS_OPTION_TABLE	= 0x00c8,
 	LB_TAG_OPTION			= 0x00c9,
@@ -426,6 +427,21 @@ struct lb_mmc_info {
 	int32_t early_cmd1_status;
 };
 
+/*
+ * eMMC HS200 bus tuning result saved by a previous boot, see
+ * SD_MMC_TUNING_CACHE.  The payload may reapply the sampling point instead
+ * of tuning again when the controller, card CID and bus mode match.
+ */
+struct lb_mmc_tuning {
+	uint32_t tag;
+	uint32_t size;
+	uint32_t ctrlr_id;
+	uint32_t cid[4];
+	uint32_t timing;
+	uint32_t bus_width;
+	uint32_t tuning;
+};
+
 /*
  * USB Type-C Port Information
  * This record contains board-specific type-c port information.
@@ -7,6 +7,14 @@
 
 #define RMODULE_MAGIC 0xf8fe
 #define RMODULE_VERSION_1 1
+/*
+ * Version 2 stores the relocations as a stream of ULEB128 encoded deltas
+ * between the sorted relocation addresses (the first one relative to 0)
+ * instead of one uintptr_t per relocation. The header is unchanged.
+ */
+#define RMODULE_VERSION_2 2
+
+#define RMODULE_RELOC_DELTA_MAX_BYTES 5
 
 /* All fields with '_offset' in the name are byte offsets into the flat blob.
  * The linker and the linker script takes are of assigning the values.  */
@@ -43,4 +51,45 @@ struct rmodule_header {
 	uint32_t padding[4];
 } __packed;
 
+/* Encode a relocation delta into buf, returns the number of bytes used. */
+static inline size_t rmodule_reloc_delta_encode(uint8_t *buf, uint32_t delta)
+{
+	size_t len = 0;
+
+	do {
+		buf[len] = delta & 0x7f;
+		delta >>= 7;
+		if (delta)
+			buf[len] |= 0x80;
+		len++;
+	} while (delta);
+
+	return len;
+}
+
+/* Decode a relocation delta from [buf, end). Returns the number of bytes
+ * consumed or 0 if the encoding is truncated or doesn't fit 32 bits. */
+static inline size_t rmodule_reloc_delta_decode(const uint8_t *buf,
+						const uint8_t *end,
+						uint32_t *delta)
+{
+	uint32_t value = 0;
+	size_t len;
+
+	for (len = 0; len < RMODULE_RELOC_DELTA_MAX_BYTES; len++) {
+		if (&buf[len] >= end)
+			return 0;
+		/* Only the low 4 bits of the 5th byte are left for a 32 bit value. */
+		if (len == RMODULE_RELOC_DELTA_MAX_BYTES - 1 && (buf[len] & 0x70))
+			return 0;
+		value |= (uint32_t)(buf[len] & 0x7f) << (7 * len);
+		if (!(buf[len] & 0x80)) {
+			*delta = value;
+			return len + 1;
+		}
+	}
+
+	return 0;
+}
+
 #endif /* RMODULE_DEFS_H */
@@ -124,8 +124,12 @@ struct sd_mmc_ctrlr {
 	void (*set_ios)(struct sd_mmc_ctrlr *ctrlr);
 	void (*tuning_start)(struct sd_mmc_ctrlr *ctrlr, int retune);
 	int (*is_tuning_complete)(struct sd_mmc_ctrlr *ctrlr, int *successful);
+	/* Optional: read out and reapply the sampling point found by tuning */
+	int (*get_tuning)(struct sd_mmc_ctrlr *ctrlr, uint32_t *tuning);
+	int (*set_tuning)(struct sd_mmc_ctrlr *ctrlr, uint32_t tuning);
 
 	int initialized;
+	uint32_t id;		/* Identifies the controller in tuning records */
 	unsigned int version;
 	uint32_t voltages;
 
@@ -214,6 +218,30 @@ struct sd_mmc_ctrlr {
  */
 void soc_sd_mmc_controller_quirks(struct sd_mmc_ctrlr *ctrlr);
 
+/* Bus tuning result saved across boots, see SD_MMC_TUNING_CACHE */
+struct mmc_tuning_record {
+	uint32_t signature;
+#define MMC_TUNING_RECORD_SIGNATURE	0x4e55544d	/* "MTUN" */
+	uint32_t ctrlr_id;
+	uint32_t cid[4];
+	uint32_t timing;
+	uint32_t bus_width;
+	uint32_t tuning;
+	uint32_t checksum;
+};
+
+/* Platform routines to keep the tuning record in CMOS or flash
+ *
+ * mmc_tuning_record_load returns 0 when a record was read.  The default
+ * implementations keep nothing, so every boot runs the full bus tuning.
+ * SD_MMC_TUNING_CACHE_FMAP provides an implementation using a flash region.
+ */
+int mmc_tuning_record_load(struct mmc_tuning_record *record);
+void mmc_tuning_record_save(const struct mmc_tuning_record *record);
+
+/* Returns non-zero when the signature and checksum of the record match */
+int mmc_tuning_record_valid(const struct mmc_tuning_record *record);
+
 /* Optional routines to support logging */
 void sdhc_log_command(struct mmc_command *cmd);
 void sdhc_log_command_issued(void);
@@ -52,6 +52,14 @@ struct sdhci_ctrlr {
 	 * This would include anything non-standard.
 	 */
 	int (*attach)(struct sdhci_ctrlr *ctrlr);
+
+	/*
+	 * Vendor register holding the sampling point selected by bus tuning.
+	 * Set by attach to allow reusing the tuning result across boots,
+	 * see SD_MMC_TUNING_CACHE.  A zero mask means not supported.
+	 */
+	uint32_t tuning_reg;
+	uint32_t tuning_mask;
 };
 
 int add_sdhci(struct sdhci_ctrlr *sdhci_ctrlr);
@@ -11,4 +11,11 @@ typedef enum {
 
 void bubblesort(int *v, size_t num_entries, sort_order_t order);
 
+/*
+ * Sort an array of num_entries elements of the given size in place, in ascending order as
+ * defined by compare() which follows the qsort() convention.
+ */
+void heap_sort(void *base, size_t num_entries, size_t size,
+	       int (*compare)(const void *, const void *));
+
 #endif /* _COMMONLIB_SORT_H_ */
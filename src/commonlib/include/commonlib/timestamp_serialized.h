@@ -60,6 +60,8 @@ enum timestamp_id {
 	TS_READ_UCODE_END = 113,
 	TS_ELOG_INIT_START = 114,
 	TS_ELOG_INIT_END = 115,
+	TS_S3_BOOT_SCRIPT_START = 116,
+	TS_S3_BOOT_SCRIPT_END = 117,
 
 	/* 500+ reserved for vendorcode extensions (500-600: google/chromeos) */
 	TS_COPYVER_START = 501,
@@ -247,6 +249,8 @@ static const struct timestamp_id_to_name {
 	TS_NAME_DEF(TS_READ_UCODE_END, 0, "finished reading uCode"),
 	TS_NAME_DEF(TS_ELOG_INIT_START, TS_ELOG_INIT_END, "started elog init"),
 	TS_NAME_DEF(TS_ELOG_INIT_END, 0, "finished elog init"),
+	TS_NAME_DEF(TS_S3_BOOT_SCRIPT_START, TS_S3_BOOT_SCRIPT_END, "started S3 boot script replay"),
+	TS_NAME_DEF(TS_S3_BOOT_SCRIPT_END, 0, "finished S3 boot script replay"),
 
 	/* Google related timestamps */
 	TS_NAME_DEF(TS_COPYVER_START, TS_COPYVER_START, "starting to load verstage"),
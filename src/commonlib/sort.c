@@ -38,3 +38,45 @@ void bubblesort(int *v, size_t num_entries, sort_order_t order)
 			break;
 	}
 }
+
+static void swap_elements(char *a, char *b, size_t size)
+{
+	while (size--)
+		SWAP(a[size], b[size]);
+}
+
+static void sift_down(char *base, size_t root, size_t num_entries, size_t size,
+		      int (*compare)(const void *, const void *))
+{
+	size_t child;
+
+	while ((child = 2 * root + 1) < num_entries) {
+		if (child + 1 < num_entries &&
+		    compare(base + child * size, base + (child + 1) * size) < 0)
+			child++;
+		if (compare(base + root * size, base + child * size) >= 0)
+			return;
+		swap_elements(base + root * size, base + child * size, size);
+		root = child;
+	}
+}
+
+/* Heapsort: O(n log n) comparisons in the worst case, no extra memory needed. The order
+   of entries comparing equal is not preserved. */
+void heap_sort(void *base, size_t num_entries, size_t size,
+	       int (*compare)(const void *, const void *))
+{
+	char *const v = base;
+	size_t i;
+
+	if (num_entries < 2 || !size)
+		return;
+
+	for (i = num_entries / 2; i-- > 0;)
+		sift_down(v, i, num_entries, size, compare);
+
+	for (i = num_entries - 1; i > 0; i--) {
+		swap_elements(v, v + i * size, size);
+		sift_down(v, 0, i, size, compare);
+	}
+}
@@ -64,6 +64,22 @@ postcar-y += mmc.c
 ramstage-y += mmc.c
 endif # CONFIG_COMMONLIB_STORAGE_MMC
 
+ifeq ($(CONFIG_SD_MMC_TUNING_CACHE),y)
+bootblock-y += mmc_tuning.c
+verstage-y += mmc_tuning.c
+romstage-y += mmc_tuning.c
+postcar-y += mmc_tuning.c
+ramstage-y += mmc_tuning.c
+endif # CONFIG_SD_MMC_TUNING_CACHE
+
+ifeq ($(CONFIG_SD_MMC_TUNING_CACHE_FMAP),y)
+bootblock-y += mmc_tuning_fmap.c
+verstage-y += mmc_tuning_fmap.c
+romstage-y += mmc_tuning_fmap.c
+postcar-y += mmc_tuning_fmap.c
+ramstage-y += mmc_tuning_fmap.c
+endif # CONFIG_SD_MMC_TUNING_CACHE_FMAP
+
 # Determine if Secure Digital cards are supported
 ifeq ($(CONFIG_COMMONLIB_STORAGE_SD),y)
 bootblock-y += sd.c
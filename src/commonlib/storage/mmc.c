@@ -182,7 +182,7 @@ static int mmc_select_hs(struct storage_media *media)
 	return ret;
 }
 
-static int mmc_send_tuning_seq(struct sd_mmc_ctrlr *ctrlr, char *buffer)
+int mmc_send_tuning_seq(struct sd_mmc_ctrlr *ctrlr, char *buffer)
 {
 	struct mmc_command cmd;
 	struct mmc_data data;
@@ -207,13 +207,20 @@ static int mmc_bus_tuning(struct storage_media *media)
 	int index;
 	int successful;
 
+	/* Reuse the result of an earlier boot when it still works */
+	if (CONFIG(SD_MMC_TUNING_CACHE) && !mmc_tuning_restore(media))
+		return 0;
+
 	/* Request the device send the tuning sequence up to 40 times */
 	ctrlr->tuning_start(ctrlr, 0);
 	for (index = 0; index < 40; index++) {
 		mmc_send_tuning_seq(ctrlr, buffer);
 		if (ctrlr->is_tuning_complete(ctrlr, &successful)) {
-			if (successful)
+			if (successful) {
+				if (CONFIG(SD_MMC_TUNING_CACHE))
+					mmc_tuning_save(media);
 				return 0;
+			}
 			break;
 		}
 	}
@@ -0,0 +1,92 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Reuse of the HS200 bus tuning result across boots
+ * This code is controller independent
+ */
+
+#include <commonlib/bsd/ipchksum.h>
+#include <commonlib/sd_mmc_ctrlr.h>
+#include <commonlib/storage.h>
+#include <stddef.h>
+#include <string.h>
+#include "sd_mmc.h"
+#include "storage.h"
+
+__weak int mmc_tuning_record_load(struct mmc_tuning_record *record)
+{
+	return -1;
+}
+
+__weak void mmc_tuning_record_save(const struct mmc_tuning_record *record)
+{
+}
+
+int mmc_tuning_record_valid(const struct mmc_tuning_record *record)
+{
+	return record->signature == MMC_TUNING_RECORD_SIGNATURE
+		&& record->checksum == ipchksum(record,
+			offsetof(struct mmc_tuning_record, checksum));
+}
+
+static void mmc_tuning_record_fill(struct storage_media *media,
+	struct mmc_tuning_record *record, uint32_t tuning)
+{
+	struct sd_mmc_ctrlr *ctrlr = media->ctrlr;
+
+	memset(record, 0, sizeof(*record));
+	record->signature = MMC_TUNING_RECORD_SIGNATURE;
+	record->ctrlr_id = ctrlr->id;
+	memcpy(record->cid, media->cid, sizeof(record->cid));
+	record->timing = ctrlr->timing;
+	record->bus_width = ctrlr->bus_width;
+	record->tuning = tuning;
+	record->checksum = ipchksum(record,
+		offsetof(struct mmc_tuning_record, checksum));
+}
+
+int mmc_tuning_restore(struct storage_media *media)
+{
+	ALLOC_CACHE_ALIGN_BUFFER(char, buffer, 128);
+	struct sd_mmc_ctrlr *ctrlr = media->ctrlr;
+	struct mmc_tuning_record expected;
+	struct mmc_tuning_record saved;
+
+	if (!ctrlr->set_tuning || mmc_tuning_record_load(&saved))
+		return -1;
+
+	/* Only use the record for the same card, controller and bus mode */
+	mmc_tuning_record_fill(media, &expected, saved.tuning);
+	if (memcmp(&saved, &expected, sizeof(saved))) {
+		sd_mmc_debug("Saved bus tuning is for a different device\n");
+		return -1;
+	}
+
+	if (ctrlr->set_tuning(ctrlr, saved.tuning))
+		return -1;
+
+	/* The controller reports CRC errors on the tuning block read */
+	if (mmc_send_tuning_seq(ctrlr, buffer)) {
+		sd_mmc_error("Saved bus tuning failed, tuning again\n");
+		return -1;
+	}
+	sd_mmc_debug("Restored bus tuning 0x%08x\n", saved.tuning);
+	return 0;
+}
+
+void mmc_tuning_save(struct storage_media *media)
+{
+	struct sd_mmc_ctrlr *ctrlr = media->ctrlr;
+	struct mmc_tuning_record record;
+	struct mmc_tuning_record saved;
+	uint32_t tuning;
+
+	if (!ctrlr->get_tuning || ctrlr->get_tuning(ctrlr, &tuning))
+		return;
+
+	/* Avoid rewriting the record when nothing changed */
+	mmc_tuning_record_fill(media, &record, tuning);
+	if (!mmc_tuning_record_load(&saved)
+		&& !memcmp(&saved, &record, sizeof(saved)))
+		return;
+	mmc_tuning_record_save(&record);
+}
@@ -0,0 +1,49 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Keep the HS200 bus tuning record in an FMAP region
+ */
+
+#include <commonlib/region.h>
+#include <commonlib/sd_mmc_ctrlr.h>
+#include <console/console.h>
+#include <fmap.h>
+
+static int mmc_tuning_region(struct region_device *rdev)
+{
+	if (fmap_locate_area_as_rdev_rw(CONFIG_SD_MMC_TUNING_CACHE_REGION,
+			rdev)) {
+		printk(BIOS_WARNING, "MMC: Unable to find %s in FMAP\n",
+			CONFIG_SD_MMC_TUNING_CACHE_REGION);
+		return -1;
+	}
+	if (region_device_sz(rdev) < sizeof(struct mmc_tuning_record))
+		return -1;
+	return 0;
+}
+
+int mmc_tuning_record_load(struct mmc_tuning_record *record)
+{
+	struct region_device rdev;
+
+	if (mmc_tuning_region(&rdev))
+		return -1;
+	if (rdev_readat(&rdev, record, 0, sizeof(*record)) != sizeof(*record))
+		return -1;
+
+	/* An erased region reads back as all ones */
+	if (!mmc_tuning_record_valid(record))
+		return -1;
+	return 0;
+}
+
+void mmc_tuning_record_save(const struct mmc_tuning_record *record)
+{
+	struct region_device rdev;
+
+	if (mmc_tuning_region(&rdev))
+		return;
+	if (rdev_eraseat(&rdev, 0, region_device_sz(&rdev)) < 0
+		|| rdev_writeat(&rdev, record, 0, sizeof(*record))
+			!= sizeof(*record))
+		printk(BIOS_ERR, "MMC: Failed to save the bus tuning\n");
+}
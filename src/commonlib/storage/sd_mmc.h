@@ -51,6 +51,9 @@ int mmc_set_partition(struct storage_media *media,
 int mmc_update_capacity(struct storage_media *media);
 void mmc_set_early_wake_status(int32_t status);
 int mmc_send_cmd1(struct storage_media *media);
+int mmc_send_tuning_seq(struct sd_mmc_ctrlr *ctrlr, char *buffer);
+int mmc_tuning_restore(struct storage_media *media);
+void mmc_tuning_save(struct storage_media *media);
 
 /* SD card support routines */
 int sd_change_freq(struct storage_media *media);
@@ -574,6 +574,39 @@ static int sdhci_is_tuning_complete(struct sd_mmc_ctrlr *ctrlr, int *successful)
 	return ((host_ctrl2 & SDHCI_CTRL_EXEC_TUNING) == 0);
 }
 
+static int sdhci_get_tuning(struct sd_mmc_ctrlr *ctrlr, uint32_t *tuning)
+{
+	struct sdhci_ctrlr *sdhci_ctrlr = (struct sdhci_ctrlr *)ctrlr;
+
+	/* The sampling point is only meaningful after a successful tuning */
+	if (!(sdhci_readw(sdhci_ctrlr, SDHCI_HOST_CONTROL2)
+		& SDHCI_CTRL_TUNED_CLK))
+		return -1;
+	*tuning = sdhci_readl(sdhci_ctrlr, sdhci_ctrlr->tuning_reg)
+		& sdhci_ctrlr->tuning_mask;
+	return 0;
+}
+
+static int sdhci_set_tuning(struct sd_mmc_ctrlr *ctrlr, uint32_t tuning)
+{
+	uint16_t host_ctrl2;
+	uint32_t value;
+	struct sdhci_ctrlr *sdhci_ctrlr = (struct sdhci_ctrlr *)ctrlr;
+
+	if (tuning & ~sdhci_ctrlr->tuning_mask)
+		return -1;
+
+	/* Apply the sampling point, then switch to the tuned clock */
+	value = sdhci_readl(sdhci_ctrlr, sdhci_ctrlr->tuning_reg);
+	value = (value & ~sdhci_ctrlr->tuning_mask) | tuning;
+	sdhci_writel(sdhci_ctrlr, value, sdhci_ctrlr->tuning_reg);
+
+	host_ctrl2 = sdhci_readw(sdhci_ctrlr, SDHCI_HOST_CONTROL2);
+	host_ctrl2 |= SDHCI_CTRL_TUNED_CLK;
+	sdhci_writew(sdhci_ctrlr, host_ctrl2, SDHCI_HOST_CONTROL2);
+	return 0;
+}
+
 /* Prepare SDHCI controller to be initialized */
 static int sdhci_pre_init(struct sdhci_ctrlr *sdhci_ctrlr)
 {
@@ -590,6 +623,12 @@ static int sdhci_pre_init(struct sdhci_ctrlr *sdhci_ctrlr)
 			return rv;
 	}
 
+	/* attach tells where the controller keeps the tuned sampling point */
+	if (sdhci_ctrlr->tuning_mask) {
+		ctrlr->get_tuning = &sdhci_get_tuning;
+		ctrlr->set_tuning = &sdhci_set_tuning;
+	}
+
 	/* Get controller version and capabilities */
 	ctrlr->version = sdhci_readw(sdhci_ctrlr, SDHCI_HOST_VERSION) & 0xff;
 	caps = sdhci_readl(sdhci_ctrlr, SDHCI_CAPABILITIES);
@@ -762,6 +801,9 @@ int add_sdhci(struct sdhci_ctrlr *sdhci_ctrlr)
 
 	sdhci_update_pointers(sdhci_ctrlr);
 
+	/* Tell the saved bus tuning of different controllers apart */
+	ctrlr->id = (uintptr_t)sdhci_ctrlr->ioaddr;
+
 	/* TODO(vbendeb): check if SDHCI spec allows to retrieve this value. */
 	ctrlr->b_max = 65535;
 
@@ -125,10 +125,40 @@ struct mp_flight_plan {
 static int global_num_aps;
 static struct mp_flight_plan mp_info;
 
+/*
+ * APs waiting for the BSP can sleep in MWAIT on the cache line they are
+ * polling instead of spinning. The BSP's store to that line wakes them up.
+ * Set by the BSP in mp_init() before any AP is started.
+ */
+static bool ap_use_mwait;
+
+static bool cpu_supports_mwait(void)
+{
+	return CONFIG(PARALLEL_MP_AP_MWAIT) && (cpuid_ecx(1) & CPUID_FEATURE_MONITOR);
+}
+
+static inline void cpu_monitor(const void *addr)
+{
+	asm volatile ("monitor" : : "a" (addr), "c" (0), "d" (0));
+}
+
+static inline void cpu_mwait(void)
+{
+	/* C1, no interrupt break events */
+	asm volatile ("mwait" : : "a" (0), "c" (0) : "memory");
+}
+
 static inline void barrier_wait(atomic_t *b)
 {
-	while (atomic_read(b) == 0)
-		asm ("pause");
+	while (atomic_read(b) == 0) {
+		if (ap_use_mwait) {
+			cpu_monitor(b);
+			if (atomic_read(b) == 0)
+				cpu_mwait();
+		} else {
+			asm ("pause");
+		}
+	}
 	mfence();
 }
 
@@ -632,6 +662,7 @@ static enum cb_err mp_init(struct bus *cpu_bus, struct mp_params *p)
 	/* Copy needed parameters so that APs have a reference to the plan. */
 	mp_info.num_records = p->num_records;
 	mp_info.records = p->flight_plan;
+	ap_use_mwait = cpu_supports_mwait();
 
 	/* Load the SIPI vector. */
 	ap_count = load_sipi_vector(p);
@@ -966,7 +997,14 @@ static void ap_wait_for_instruction(void)
 		struct mp_callback *cb = read_callback(per_cpu_slot);
 
 		if (cb == NULL) {
-			asm ("pause");
+			if (ap_use_mwait) {
+				/* Re-check after arming to not miss a store */
+				cpu_monitor(per_cpu_slot);
+				if (read_callback(per_cpu_slot) == NULL)
+					cpu_mwait();
+			} else {
+				asm ("pause");
+			}
 			continue;
 		}
 		/*
@@ -43,6 +43,7 @@ ifeq ($(CONFIG_PARALLEL_MP),y)
 smmstub-y += smm_stub.S
 
 smm-y += smm_module_handler.c
+smm-y += apmc_originator.c
 
 ramstage-srcs += $(obj)/cpu/x86/smm/smmstub.manual
 
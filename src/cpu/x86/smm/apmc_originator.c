@@ -0,0 +1,46 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+
+#include <cpu/x86/smm.h>
+#include <types.h>
+
+/* CPU which trapped on its APM_CNT write, so APMC handlers don't have to search for it */
+static volatile int apmc_originator = -1;
+
+void smm_apmc_check_originator(int cpu)
+{
+	if (smm_cpu_is_apmc_originator(cpu))
+		apmc_originator = cpu;
+}
+
+void smm_apmc_clear_originator(void)
+{
+	apmc_originator = -1;
+}
+
+int smm_apmc_originator(void)
+{
+	return apmc_originator;
+}
+
+void *smm_find_apmc_save_state(u8 cmd, bool (*is_apmc_cmd)(void *state, u8 cmd))
+{
+	int node = smm_apmc_originator();
+	void *state;
+
+	/* Usually the originator already told us on SMI entry */
+	if (node >= 0) {
+		state = smm_get_save_state(node);
+		if (state && is_apmc_cmd(state, cmd))
+			return state;
+	}
+
+	/* Check all nodes looking for the one that issued the IO */
+	for (node = 0; node < CONFIG_MAX_CPUS; node++) {
+		state = smm_get_save_state(node);
+		if (!state)
+			break;
+		if (is_apmc_cmd(state, cmd))
+			return state;
+	}
+	return NULL;
+}
@@ -150,6 +150,13 @@ asmlinkage void smm_handler_start(void *arg)
 		return;
 	}
 
+	/*
+	 * Every CPU only looks at its own save state here, in parallel. The
+	 * originator may still be on its way in when the handler runs, so
+	 * users have to fall back to searching all save states.
+	 */
+	smm_apmc_check_originator(cpu);
+
 	/* Are we ok to execute the handler? */
 	if (!smi_obtain_lock()) {
 		/* For security reasons we don't release the other CPUs
@@ -200,6 +207,8 @@ asmlinkage void smm_handler_start(void *arg)
 
 	smm_soc_exit();
 
+	smm_apmc_clear_originator();
+
 	smi_release_lock();
 
 	/* De-assert SMI# signal to allow another SMI */
@@ -230,3 +239,4 @@ void __weak mainboard_smi_finalize(void) {}
 
 void __weak smm_soc_early_init(void) {}
 void __weak smm_soc_exit(void) {}
+bool __weak smm_cpu_is_apmc_originator(int cpu) { return false; }
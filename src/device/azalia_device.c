@@ -217,12 +217,163 @@ static int azalia_write_verb(u8 *base, u32 verb)
 	return wait_for_valid(base);
 }
 
+/*
+ * Command Outbound and Response Inbound Ring Buffers (HDA spec 1.0a 4.4.1
+ * and 4.4.2). A whole verb table is queued in the CORB and handed to the
+ * controller with a single write pointer update. The controller then sends
+ * the verbs back to back, and we only have to count the responses in the
+ * RIRB, instead of doing a round trip per verb.
+ */
+#define HDA_RING_ENTRIES	256
+#define   HDA_RIRB_UNSOL	(1 << 4)
+
+struct rirb_entry {
+	u32 response;
+	u32 response_ex;
+};
+
+static volatile u32 corb[HDA_RING_ENTRIES] __aligned(128);
+static volatile struct rirb_entry rirb[HDA_RING_ENTRIES] __aligned(128);
+
+struct hda_rings {
+	u16 entries;
+	u16 corb_wp;
+	u16 rirb_rp;
+};
+
+static void azalia_rings_stop(u8 *base)
+{
+	write8(base + HDA_CORBCTL_REG, 0);
+	write8(base + HDA_RIRBCTL_REG, 0);
+	wait_us(1000, !(read8(base + HDA_CORBCTL_REG) & HDA_CORBCTL_RUN) &&
+		      !(read8(base + HDA_RIRBCTL_REG) & HDA_RIRBCTL_DMAEN));
+}
+
+static enum cb_err azalia_rings_start(u8 *base, struct hda_rings *rings)
+{
+	static const u16 ring_entries[] = {
+		[HDA_RING_SIZE_2] = 2,
+		[HDA_RING_SIZE_16] = 16,
+		[HDA_RING_SIZE_256] = 256,
+	};
+	const u8 corbsize = read8(base + HDA_CORBSIZE_REG);
+	const u8 rirbsize = read8(base + HDA_RIRBSIZE_REG);
+	int size;
+
+	/* Use the largest size that both rings support */
+	for (size = HDA_RING_SIZE_256; size >= HDA_RING_SIZE_2; size--) {
+		if (corbsize & rirbsize & HDA_RING_SIZE_CAP(size))
+			break;
+	}
+	if (size < HDA_RING_SIZE_2)
+		return CB_ERR;
+
+	azalia_rings_stop(base);
+
+	write8(base + HDA_CORBSIZE_REG, (corbsize & ~0x3) | size);
+	write8(base + HDA_RIRBSIZE_REG, (rirbsize & ~0x3) | size);
+	write32(base + HDA_CORBLBASE_REG, (uintptr_t)corb);
+	write32(base + HDA_CORBUBASE_REG, (uint64_t)(uintptr_t)corb >> 32);
+	write32(base + HDA_RIRBLBASE_REG, (uintptr_t)rirb);
+	write32(base + HDA_RIRBUBASE_REG, (uint64_t)(uintptr_t)rirb >> 32);
+
+	/* The CORB read pointer reset has to be acknowledged by the controller */
+	write16(base + HDA_CORBRP_REG, HDA_CORBRP_RST);
+	if (!wait_us(1000, read16(base + HDA_CORBRP_REG) & HDA_CORBRP_RST))
+		return CB_ERR;
+	write16(base + HDA_CORBRP_REG, 0);
+	if (!wait_us(1000, !(read16(base + HDA_CORBRP_REG) & HDA_CORBRP_RST)))
+		return CB_ERR;
+	write16(base + HDA_CORBWP_REG, 0);
+
+	write16(base + HDA_RIRBWP_REG, HDA_RIRBWP_RST);
+	write16(base + HDA_RINTCNT_REG, 1);
+	/* Clear RINTFL and RIRBOIS */
+	write8(base + HDA_RIRBSTS_REG, 0x5);
+
+	write8(base + HDA_CORBCTL_REG, HDA_CORBCTL_RUN);
+	write8(base + HDA_RIRBCTL_REG, HDA_RIRBCTL_DMAEN);
+
+	rings->entries = ring_entries[size];
+	rings->corb_wp = 0;
+	rings->rirb_rp = 0;
+	return CB_SUCCESS;
+}
+
+/*
+ * Queue up to (entries - 1) verbs and wait for their responses. Returns
+ * the number of verbs that were answered by the codec.
+ */
+static u32 azalia_rings_send(u8 *base, struct hda_rings *rings, const u32 *verbs, u32 count)
+{
+	const u16 mask = rings->entries - 1;
+	struct stopwatch sw;
+	u32 received = 0;
+
+	for (u32 i = 0; i < count; i++) {
+		rings->corb_wp = (rings->corb_wp + 1) & mask;
+		corb[rings->corb_wp] = verbs[i];
+	}
+	write16(base + HDA_CORBWP_REG, rings->corb_wp);
+
+	/* Same timeout per verb as for immediate commands */
+	stopwatch_init_msecs_expire(&sw, count);
+	do {
+		const u16 wp = read16(base + HDA_RIRBWP_REG) & mask;
+
+		while (rings->rirb_rp != wp) {
+			rings->rirb_rp = (rings->rirb_rp + 1) & mask;
+			if (!(rirb[rings->rirb_rp].response_ex & HDA_RIRB_UNSOL))
+				received++;
+		}
+		if (received >= count)
+			break;
+		udelay(1);
+	} while (!stopwatch_expired(&sw));
+
+	return MIN(received, count);
+}
+
+/* Returns the number of verbs from the table that were sent successfully. */
+static u32 azalia_rings_program_verb_table(u8 *base, const u32 *verbs, u32 verb_size)
+{
+	struct hda_rings rings;
+	u32 done = 0;
+
+	if (azalia_rings_start(base, &rings) != CB_SUCCESS) {
+		printk(BIOS_DEBUG, "azalia_audio: CORB/RIRB unavailable\n");
+		azalia_rings_stop(base);
+		return 0;
+	}
+
+	while (done < verb_size) {
+		const u32 count = MIN(verb_size - done, rings.entries - 1);
+		const u32 sent = azalia_rings_send(base, &rings, verbs + done, count);
+
+		done += sent;
+		if (sent != count) {
+			printk(BIOS_WARNING, "azalia_audio: no RIRB response for verb 0x%08x\n",
+			       verbs[done]);
+			break;
+		}
+	}
+
+	azalia_rings_stop(base);
+	return done;
+}
+
 int azalia_program_verb_table(u8 *base, const u32 *verbs, u32 verb_size)
 {
+	u32 i = 0;
+
 	if (!verbs)
 		return 0;
 
-	for (u32 i = 0; i < verb_size; i++) {
+	/* Whatever could not be sent through the rings goes the slow way */
+	if (CONFIG(AZALIA_CORB_RIRB))
+		i = azalia_rings_program_verb_table(base, verbs, verb_size);
+
+	for (; i < verb_size; i++) {
 		if (azalia_write_verb(base, verbs[i]) < 0)
 			return -1;
 	}
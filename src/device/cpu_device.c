@@ -1,8 +1,10 @@
 /* SPDX-License-Identifier: GPL-2.0-only */
 
+#include <commonlib/sort.h>
 #include <device/device.h>
 #include <console/console.h>
 #include <stddef.h>
+#include <stdlib.h>
 
 struct device *add_cpu_device(struct bus *cpu_bus, unsigned int apic_id,
 			      int enabled)
@@ -29,3 +31,51 @@ struct device *add_cpu_device(struct bus *cpu_bus, unsigned int apic_id,
 
 	return cpu;
 }
+
+static int cpu_topology_compare(const void *a, const void *b)
+{
+	const struct apic_path *x = &(*(struct device *const *)a)->path.apic;
+	const struct apic_path *y = &(*(struct device *const *)b)->path.apic;
+
+	if (x->thread_id != y->thread_id)
+		return x->thread_id < y->thread_id ? -1 : 1;
+	if (x->apic_id != y->apic_id)
+		return x->apic_id < y->apic_id ? -1 : 1;
+	return 0;
+}
+
+const struct cpu_topology *cpu_topology_snapshot(void)
+{
+	static struct cpu_topology topology;
+	static bool initialized;
+	struct device *cpu;
+	size_t num_cpus = 0;
+
+	if (initialized)
+		return &topology;
+
+	for (cpu = all_devices; cpu; cpu = cpu->next) {
+		if (is_enabled_cpu(cpu))
+			num_cpus++;
+	}
+
+	if (num_cpus) {
+		topology.cpus = malloc(num_cpus * sizeof(*topology.cpus));
+		if (!topology.cpus) {
+			printk(BIOS_ERR, "%s: Out of memory for %zu CPUs\n", __func__,
+			       num_cpus);
+			return &topology;
+		}
+	}
+
+	for (cpu = all_devices; cpu; cpu = cpu->next) {
+		if (is_enabled_cpu(cpu))
+			topology.cpus[topology.num_cpus++] = cpu;
+	}
+
+	heap_sort(topology.cpus, topology.num_cpus, sizeof(*topology.cpus),
+		  cpu_topology_compare);
+	initialized = true;
+
+	return &topology;
+}
@@ -4,6 +4,7 @@
  * Originally based on the Linux kernel (arch/i386/kernel/pci-pc.c).
  */
 
+#include <bootstate.h>
 #include <console/console.h>
 #include <device/device.h>
 #include <device/pci_def.h>
@@ -561,6 +562,47 @@ static void init_dev(struct device *dev)
 	}
 }
 
+#define PCI_USB4_CLASSCODE	0x0c0340 /* USB4 host interface */
+
+/*
+ * With DEFERRED_DEVICE_INIT, devices that are not needed to boot are left for
+ * the OS to initialize. Devices providing ACPI or SMBIOS tables are
+ * initialized on entry to BS_POST_DEVICE, see init_deferred_table_devs().
+ * HD Audio is not deferred, as its init programs the codec verb tables.
+ */
+static bool init_deferrable(const struct device *dev)
+{
+	if (!CONFIG(DEFERRED_DEVICE_INIT))
+		return false;
+
+	if (dev->mandatory || dev->path.type != DEVICE_PATH_PCI)
+		return false;
+
+	/* final() expects init() to have run */
+	if (dev->ops->final)
+		return false;
+
+	switch (dev->class >> 16) {
+	case PCI_BASE_CLASS_NETWORK:
+	case PCI_BASE_CLASS_WIRELESS:
+	case PCI_BASE_CLASS_SIGNAL_PROCESSING:
+		return true;
+	default:
+		return dev->class == PCI_USB4_CLASSCODE;
+	}
+}
+
+static void init_dev_on_boot_path(struct device *dev)
+{
+	if (dev->enabled && !dev->initialized && dev->ops && dev->ops->init &&
+	    init_deferrable(dev)) {
+		printk(BIOS_DEBUG, "%s init deferred\n", dev_path(dev));
+		return;
+	}
+
+	init_dev(dev);
+}
+
 static void init_link(struct bus *link)
 {
 	struct device *dev;
@@ -568,7 +610,7 @@ static void init_link(struct bus *link)
 	for (dev = link->children; dev; dev = dev->sibling) {
 		post_code(POSTCODE_BS_DEV_INIT);
 		post_log_path(dev);
-		init_dev(dev);
+		init_dev_on_boot_path(dev);
 	}
 
 	for (dev = link->children; dev; dev = dev->sibling)
@@ -598,6 +640,46 @@ void dev_initialize(void)
 	show_all_devs(BIOS_SPEW, "After init.");
 }
 
+static bool dev_provides_tables(const struct device *dev)
+{
+	return dev->ops && (dev->ops->write_acpi_tables || dev->ops->acpi_fill_ssdt ||
+			    dev->ops->get_smbios_data);
+}
+
+/*
+ * Deferred devices providing ACPI or SMBIOS tables can't wait for the table
+ * writers: by BS_WRITE_TABLES the chipset may already be locked down by the
+ * finalize hooks. Initialize them before any of those run.
+ */
+static void init_deferred_table_devs(void *unused)
+{
+	struct device *dev;
+
+	if (!CONFIG(DEFERRED_DEVICE_INIT))
+		return;
+
+	for (dev = all_devices; dev; dev = dev->next)
+		if (dev_provides_tables(dev))
+			init_dev(dev);
+}
+
+BOOT_STATE_INIT_ENTRY(BS_POST_DEVICE, BS_ON_ENTRY, init_deferred_table_devs, NULL);
+
+/**
+ * Initialize a device whose init was deferred by dev_initialize().
+ *
+ * Called by consumers of a device before they use it, e.g. the ACPI and SMBIOS
+ * table writers. Does nothing if the device has already been initialized,
+ * which is always the case for devices providing tables.
+ * Must not be called before dev_initialize().
+ *
+ * @param dev The device to be initialized.
+ */
+void dev_ensure_initialized(struct device *dev)
+{
+	init_dev(dev);
+}
+
 /**
  * Finalize a specific device.
  *
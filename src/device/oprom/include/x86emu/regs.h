@@ -301,6 +301,9 @@ abseg			- Base for the absegment
 mem_size		- Size of the real mode memory block for the emulator
 private			- private data pointer
 x86			- X86 registers
+code_base		- Host address backing the direct code fetch window
+code_start		- Emulator address of the direct code fetch window
+code_size		- Size of the direct code fetch window, 0 if unused
 ****************************************************************************/
 typedef struct {
 	unsigned long	mem_base;
@@ -308,6 +311,9 @@ typedef struct {
 	unsigned long	abseg;
 	void		*private;
 	X86EMU_regs		x86;
+	unsigned long	code_base;
+	u32		code_start;
+	u32		code_size;
 	} X86EMU_sysEnv;
 
 #pragma pack()
@@ -146,6 +146,7 @@ void 	X86EMU_setupIntrFuncs(X86EMU_intrFuncs funcs[]);
 void 	X86EMU_prepareForInt(int num);
 
 void X86EMU_setMemBase(void *base, size_t size);
+void X86EMU_setupCodeWindow(u32 start, u32 size, void *base);
 
 /* decode.c */
 
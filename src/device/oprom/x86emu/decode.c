@@ -119,7 +119,7 @@ DB(             if (M.x86.R_SP != 0) {
                 x86emu_intr_handle();
             }
         }
-        op1 = (*sys_rdb)(((u32)M.x86.R_CS << 4) + (M.x86.R_IP++));
+        op1 = fetch_code(((u32)M.x86.R_CS << 4) + (M.x86.R_IP++), 1);
         (*x86emu_optab[op1])(op1);
         //if (M.x86.debug & DEBUG_EXIT) {
         //    M.x86.debug &= ~DEBUG_EXIT;
@@ -158,7 +158,7 @@ void fetch_decode_modrm(
 
 DB( if (CHECK_IP_FETCH())
         x86emu_check_ip_access();)
-    fetched = (*sys_rdb)(((u32)M.x86.R_CS << 4) + (M.x86.R_IP++));
+    fetched = fetch_code(((u32)M.x86.R_CS << 4) + (M.x86.R_IP++), 1);
     INC_DECODED_INST_LEN(1);
     *mod  = (fetched >> 6) & 0x03;
     *regh = (fetched >> 3) & 0x07;
@@ -181,7 +181,7 @@ u8 fetch_byte_imm(void)
 
 DB( if (CHECK_IP_FETCH())
         x86emu_check_ip_access();)
-    fetched = (*sys_rdb)(((u32)M.x86.R_CS << 4) + (M.x86.R_IP++));
+    fetched = fetch_code(((u32)M.x86.R_CS << 4) + (M.x86.R_IP++), 1);
     INC_DECODED_INST_LEN(1);
     return fetched;
 }
@@ -202,7 +202,7 @@ u16 fetch_word_imm(void)
 
 DB( if (CHECK_IP_FETCH())
         x86emu_check_ip_access();)
-    fetched = (*sys_rdw)(((u32)M.x86.R_CS << 4) + (M.x86.R_IP));
+    fetched = fetch_code(((u32)M.x86.R_CS << 4) + (M.x86.R_IP), 2);
     M.x86.R_IP += 2;
     INC_DECODED_INST_LEN(2);
     return fetched;
@@ -224,7 +224,7 @@ u32 fetch_long_imm(void)
 
 DB( if (CHECK_IP_FETCH())
         x86emu_check_ip_access();)
-    fetched = (*sys_rdl)(((u32)M.x86.R_CS << 4) + (M.x86.R_IP));
+    fetched = fetch_code(((u32)M.x86.R_CS << 4) + (M.x86.R_IP), 4);
     M.x86.R_IP += 4;
     INC_DECODED_INST_LEN(4);
     return fetched;
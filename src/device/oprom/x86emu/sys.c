@@ -401,3 +401,22 @@ void X86EMU_setMemBase(void *base, size_t size)
 	M.mem_base = (unsigned long) base;
 	M.mem_size = size;
 }
+
+/****************************************************************************
+PARAMETERS:
+start	- Emulator address of the first byte of the window
+size	- Size of the window, 0 disables it
+base	- Host address the window is backed by
+
+REMARKS:
+Declares a range of emulator memory that behaves like plain RAM for reads,
+so that instructions can be fetched from it without going through the
+memory read callbacks. Only use this for memory that the read callbacks
+would access 1:1 and without side effects.
+****************************************************************************/
+void X86EMU_setupCodeWindow(u32 start, u32 size, void *base)
+{
+	M.code_start = start;
+	M.code_size = size;
+	M.code_base = (unsigned long) base;
+}
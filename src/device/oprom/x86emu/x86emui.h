@@ -93,6 +93,38 @@ extern void (X86APIP sys_outb)(X86EMU_pioAddr addr,u8 val);
 extern void (X86APIP sys_outw)(X86EMU_pioAddr addr,u16 val);
 extern void	(X86APIP sys_outl)(X86EMU_pioAddr addr,u32 val);
 
+/****************************************************************************
+REMARKS:
+Reads len bytes of code at the given address. Instruction bytes inside the
+window set up with X86EMU_setupCodeWindow are read straight from memory,
+everything else goes through the (possibly slow) memory read callbacks.
+Since the window is never copied, writes to code are seen immediately.
+****************************************************************************/
+static inline u32 fetch_code(u32 addr, int len)
+{
+    u32 offset = addr - M.code_start;
+
+    if (offset < M.code_size && M.code_size - offset >= len) {
+        const u8 *p = (const u8 *)(M.code_base + offset);
+        switch (len) {
+          case 1:
+            return p[0];
+          case 2:
+            return p[0] | (p[1] << 8);
+          default:
+            return p[0] | (p[1] << 8) | (p[2] << 16) | ((u32)p[3] << 24);
+        }
+    }
+    switch (len) {
+      case 1:
+        return (*sys_rdb)(addr);
+      case 2:
+        return (*sys_rdw)(addr);
+      default:
+        return (*sys_rdl)(addr);
+    }
+}
+
 #ifdef  __cplusplus
 }                       			/* End of "C" linkage for C++   	*/
 #endif
@@ -288,6 +288,13 @@ biosemu(u8 *biosmem, u32 biosmem_size, struct device * dev, unsigned long rom_ad
 	X86EMU_setupIntrFuncs(intrFuncs);
 	X86EMU_setupPioFuncs(&my_pio_funcs);
 	X86EMU_setupMemFuncs(&my_mem_funcs);
+	// The option ROM segment is mapped 1:1 (see biosemu_add_special_memory()
+	// above), so let x86emu fetch instructions from it directly instead of
+	// translating every byte through my_rdb(). Memory debugging wants to see
+	// all accesses, so keep the slow path there.
+	if (!CONFIG(X86EMU_DEBUG))
+		X86EMU_setupCodeWindow(OPTION_ROM_CODE_SEGMENT << 4, 0x10000,
+				       (void *)(OPTION_ROM_CODE_SEGMENT << 4));
 
 	//setup PMM struct in BIOS_DATA_SEGMENT, offset 0x0
 	u8 pmm_length = pmm_setup(BIOS_DATA_SEGMENT, 0x0);
@@ -1,26 +1,18 @@
 /* SPDX-License-Identifier: GPL-2.0-only */
 
+#include <bootstate.h>
 #include <stdint.h>
+#include <stdlib.h>
 #include <console/console.h>
 #include <device/pci.h>
 #include <device/pci_ops.h>
 
 u8 *const pci_mmconf = (void *)(uintptr_t)CONFIG_ECAM_MMCONF_BASE_ADDRESS;
 
-/**
- * Given a device, a capability type, and a last position, return the next
- * matching capability. Always start at the head of the list.
- *
- * @param dev Pointer to the device structure.
- * @param cap PCI_CAP_LIST_ID of the PCI capability we're looking for.
- * @param last Location of the PCI capability register to start from.
- * @return The next matching capability.
- */
-u16 pci_s_find_next_capability(pci_devfn_t dev, u16 cap, u16 last)
+/* Returns the register holding the capability list pointer, or 0 if there is no list. */
+static u16 pci_s_cap_list_reg(pci_devfn_t dev)
 {
-	u16 pos = 0;
 	u16 status;
-	int reps = 48;
 
 	status = pci_s_read_config16(dev, PCI_STATUS);
 	if (!(status & PCI_STATUS_CAP_LIST))
@@ -30,14 +22,31 @@ u16 pci_s_find_next_capability(pci_devfn_t dev, u16 cap, u16 last)
 	switch (hdr_type & 0x7f) {
 	case PCI_HEADER_TYPE_NORMAL:
 	case PCI_HEADER_TYPE_BRIDGE:
-		pos = PCI_CAPABILITY_LIST;
-		break;
+		return PCI_CAPABILITY_LIST;
 	case PCI_HEADER_TYPE_CARDBUS:
-		pos = PCI_CB_CAPABILITY_LIST;
-		break;
+		return PCI_CB_CAPABILITY_LIST;
 	default:
 		return 0;
 	}
+}
+
+/**
+ * Given a device, a capability type, and a last position, return the next
+ * matching capability. Always start at the head of the list.
+ *
+ * @param dev Pointer to the device structure.
+ * @param cap PCI_CAP_LIST_ID of the PCI capability we're looking for.
+ * @param last Location of the PCI capability register to start from.
+ * @return The next matching capability.
+ */
+u16 pci_s_find_next_capability(pci_devfn_t dev, u16 cap, u16 last)
+{
+	u16 pos;
+	int reps = 48;
+
+	pos = pci_s_cap_list_reg(dev);
+	if (!pos)
+		return 0;
 
 	pos = pci_s_read_config8(dev, pos);
 	while (reps-- && (pos >= 0x40)) { /* Loop through the linked list. */
@@ -72,6 +81,222 @@ u16 pci_s_find_capability(pci_devfn_t dev, u16 cap)
 	return pci_s_find_next_capability(dev, cap, 0);
 }
 
+#if CONFIG(PCI_CONFIG_SHADOW) && ENV_RAMSTAGE
+
+#define PCI_SHADOW_MAX_CAPS	16
+#define PCI_SHADOW_MAX_EXT_CAPS	32
+
+struct pci_config_shadow {
+	bool caps_valid;
+	bool ext_caps_valid;
+	u8 cap_list_reg;
+	u8 num_caps;
+	u8 num_ext_caps;
+	struct {
+		u8 id;
+		u8 pos;
+	} caps[PCI_SHADOW_MAX_CAPS];
+	struct {
+		u16 id;
+		u16 pos;
+	} ext_caps[PCI_SHADOW_MAX_EXT_CAPS];
+};
+
+static struct {
+	unsigned int hits;
+	unsigned int walks;
+	unsigned int uncached;
+	unsigned int invalidations;
+} pci_shadow_stats;
+
+static struct pci_config_shadow *pci_shadow_get(const struct device *dev)
+{
+	/* The shadow is a cache, not device state, so it's filled in through const pointers. */
+	struct device *const mutable_dev = (struct device *)dev;
+
+	if (!mutable_dev->pci_shadow)
+		mutable_dev->pci_shadow = calloc(1, sizeof(*mutable_dev->pci_shadow));
+	return mutable_dev->pci_shadow;
+}
+
+/* Same walk as pci_s_find_next_capability(), but record every entry. */
+static bool pci_shadow_walk_caps(pci_devfn_t bdf, struct pci_config_shadow *shadow)
+{
+	u16 pos;
+	int reps = 48;
+
+	/* Don't remember anything about functions that are not there (yet). */
+	if (pci_s_read_config16(bdf, PCI_VENDOR_ID) == 0xffff)
+		return false;
+
+	shadow->num_caps = 0;
+	shadow->cap_list_reg = pci_s_cap_list_reg(bdf);
+	if (!shadow->cap_list_reg)
+		return true;
+
+	pos = pci_s_read_config8(bdf, shadow->cap_list_reg);
+	while (reps-- && (pos >= 0x40)) {
+		u8 this_cap;
+
+		pos &= ~3;
+		this_cap = pci_s_read_config8(bdf, pos + PCI_CAP_LIST_ID);
+		if (this_cap == 0xff)
+			break;
+
+		if (shadow->num_caps == ARRAY_SIZE(shadow->caps))
+			return false;
+		shadow->caps[shadow->num_caps].id = this_cap;
+		shadow->caps[shadow->num_caps].pos = pos;
+		shadow->num_caps++;
+
+		pos = pci_s_read_config8(bdf, pos + PCI_CAP_LIST_NEXT);
+	}
+	return true;
+}
+
+/* Same walk as pciexp_find_extended_cap(), but record every entry. */
+static bool pci_shadow_walk_ext_caps(pci_devfn_t bdf, struct pci_config_shadow *shadow)
+{
+	unsigned int pos = PCIE_EXT_CAP_OFFSET;
+
+	if (pci_s_read_config16(bdf, PCI_VENDOR_ID) == 0xffff)
+		return false;
+
+	shadow->num_ext_caps = 0;
+	while (pos >= PCIE_EXT_CAP_OFFSET) {
+		const u32 this_cap = pci_s_read_config32(bdf, pos);
+
+		if (this_cap == 0xffffffff)
+			break;
+
+		if (shadow->num_ext_caps == ARRAY_SIZE(shadow->ext_caps))
+			return false;
+		shadow->ext_caps[shadow->num_ext_caps].id = this_cap & 0xffff;
+		shadow->ext_caps[shadow->num_ext_caps].pos = pos;
+		shadow->num_ext_caps++;
+
+		pos = this_cap >> 20 & 0xffc;
+	}
+	return true;
+}
+
+u16 pci_shadow_find_next_capability(const struct device *dev, u16 cap, u16 last)
+{
+	struct pci_config_shadow *const shadow = pci_shadow_get(dev);
+	unsigned int i;
+
+	if (shadow && shadow->caps_valid) {
+		pci_shadow_stats.hits++;
+	} else if (shadow && pci_shadow_walk_caps(PCI_BDF(dev), shadow)) {
+		shadow->caps_valid = true;
+		pci_shadow_stats.walks++;
+	} else {
+		pci_shadow_stats.uncached++;
+		return pci_s_find_next_capability(PCI_BDF(dev), cap, last);
+	}
+
+	for (i = 0; i < shadow->num_caps; i++) {
+		if (!last && shadow->caps[i].id == cap)
+			return shadow->caps[i].pos;
+		if (last == shadow->caps[i].pos)
+			last = 0;
+	}
+	return 0;
+}
+
+int pci_shadow_find_ext_cap(const struct device *dev, unsigned int cap, unsigned int offset)
+{
+	struct pci_config_shadow *const shadow = pci_shadow_get(dev);
+	unsigned int i = 0;
+
+	if (shadow && shadow->ext_caps_valid) {
+		pci_shadow_stats.hits++;
+	} else if (shadow && pci_shadow_walk_ext_caps(PCI_BDF(dev), shadow)) {
+		shadow->ext_caps_valid = true;
+		pci_shadow_stats.walks++;
+	} else {
+		pci_shadow_stats.uncached++;
+		return -1;
+	}
+
+	/* Continue after the capability at `offset`. */
+	if (offset) {
+		while (i < shadow->num_ext_caps && shadow->ext_caps[i].pos != offset)
+			i++;
+		if (i == shadow->num_ext_caps)
+			return -1;
+		i++;
+	}
+
+	for (; i < shadow->num_ext_caps; i++) {
+		if (shadow->ext_caps[i].id == cap)
+			return shadow->ext_caps[i].pos;
+	}
+	return 0;
+}
+
+static bool pci_shadow_overlaps(u16 reg, size_t size, u16 start, size_t len)
+{
+	return reg < start + len && start < reg + size;
+}
+
+/*
+ * Volatility rules: the capability lists only change if the list pointer
+ * or one of the capability headers (ID and next pointer) is written.
+ */
+static bool pci_shadow_write_hits(const struct pci_config_shadow *shadow, u16 reg, size_t size)
+{
+	unsigned int i;
+
+	if (shadow->caps_valid) {
+		if (shadow->cap_list_reg &&
+		    pci_shadow_overlaps(reg, size, shadow->cap_list_reg, 1))
+			return true;
+		for (i = 0; i < shadow->num_caps; i++) {
+			if (pci_shadow_overlaps(reg, size, shadow->caps[i].pos, 2))
+				return true;
+		}
+	}
+
+	if (shadow->ext_caps_valid && reg >= PCIE_EXT_CAP_OFFSET) {
+		for (i = 0; i < shadow->num_ext_caps; i++) {
+			if (pci_shadow_overlaps(reg, size, shadow->ext_caps[i].pos, 4))
+				return true;
+		}
+	}
+
+	return false;
+}
+
+void pci_shadow_write(const struct device *dev, u16 reg, size_t size)
+{
+	if (dev->pci_shadow && pci_shadow_write_hits(dev->pci_shadow, reg, size))
+		pci_shadow_invalidate(dev);
+}
+
+void pci_shadow_invalidate(const struct device *dev)
+{
+	if (!dev->pci_shadow)
+		return;
+
+	dev->pci_shadow->caps_valid = false;
+	dev->pci_shadow->ext_caps_valid = false;
+	pci_shadow_stats.invalidations++;
+}
+
+static void pci_shadow_report(void *unused)
+{
+	printk(BIOS_DEBUG, "PCI shadow: %u capability lookups from cache, %u list walks, "
+	       "%u uncached lookups, %u invalidations\n", pci_shadow_stats.hits,
+	       pci_shadow_stats.walks, pci_shadow_stats.uncached,
+	       pci_shadow_stats.invalidations);
+}
+
+BOOT_STATE_INIT_ENTRY(BS_PAYLOAD_BOOT, BS_ON_ENTRY, pci_shadow_report, NULL);
+BOOT_STATE_INIT_ENTRY(BS_OS_RESUME, BS_ON_ENTRY, pci_shadow_report, NULL);
+
+#endif
+
 void __noreturn pcidev_die(void)
 {
 	die("PCI: dev is NULL!\n");
@@ -54,6 +54,10 @@ unsigned int pciexp_find_extended_cap(const struct device *dev, unsigned int cap
 				      unsigned int offset)
 {
 	unsigned int next_cap_offset;
+	const int cached = pci_shadow_find_ext_cap(dev, cap, offset);
+
+	if (cached >= 0)
+		return cached;
 
 	if (offset)
 		next_cap_offset = ext_cap_next_offset(pci_read_config32(dev, offset));
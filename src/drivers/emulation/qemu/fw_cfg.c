@@ -74,7 +74,7 @@ void fw_cfg_get(uint16_t entry, void *dst, int dstlen)
 	fw_cfg_read(dst, dstlen);
 }
 
-static int fw_cfg_find_file(FWCfgFile *file, const char *name)
+static int fw_cfg_walk_dir(FWCfgFile *file, const char *name)
 {
 	uint32_t count = 0;
 
@@ -87,14 +87,97 @@ static int fw_cfg_find_file(FWCfgFile *file, const char *name)
 		if (strcmp(file->name, name) == 0) {
 			file->size = be32_to_cpu(file->size);
 			file->select = be16_to_cpu(file->select);
-			printk(BIOS_INFO, "QEMU: firmware config: Found '%s'\n", name);
 			return 0;
 		}
 	}
-	printk(BIOS_INFO, "QEMU: firmware config: Couldn't find '%s'\n", name);
 	return -1;
 }
 
+/*
+ * ramstage looks up files many times (e820, ACPI table loader, SMBIOS, ...).
+ * Instead of walking the directory entry by entry on each lookup, read it
+ * once in a single transfer and keep it sorted by name.
+ */
+static FWCfgFile *fw_cfg_dir;
+static uint32_t fw_cfg_dir_count;
+
+static void fw_cfg_load_dir(void)
+{
+	static bool loaded;
+	uint32_t count = 0;
+	FWCfgFile *dir;
+
+	if (loaded)
+		return;
+	loaded = true;
+
+	fw_cfg_select(FW_CFG_FILE_DIR);
+	fw_cfg_read(&count, sizeof(count));
+	count = be32_to_cpu(count);
+	if (!count)
+		return;
+
+	dir = malloc(count * sizeof(*dir));
+	if (!dir)
+		return;
+	fw_cfg_read(dir, count * sizeof(*dir));
+
+	/* QEMU usually hands out a sorted directory, so this is linear. */
+	for (uint32_t i = 0; i < count; i++) {
+		FWCfgFile f = dir[i];
+		uint32_t j;
+
+		f.size = be32_to_cpu(f.size);
+		f.select = be16_to_cpu(f.select);
+		f.name[FW_CFG_MAX_FILE_PATH - 1] = '\0';
+		for (j = i; j > 0 && strcmp(dir[j - 1].name, f.name) > 0; j--)
+			dir[j] = dir[j - 1];
+		dir[j] = f;
+	}
+
+	fw_cfg_dir = dir;
+	fw_cfg_dir_count = count;
+}
+
+static int fw_cfg_lookup_dir(FWCfgFile *file, const char *name)
+{
+	uint32_t lo = 0, hi = fw_cfg_dir_count;
+
+	while (lo < hi) {
+		const uint32_t mid = lo + (hi - lo) / 2;
+		const int cmp = strcmp(fw_cfg_dir[mid].name, name);
+
+		if (cmp == 0) {
+			*file = fw_cfg_dir[mid];
+			return 0;
+		}
+		if (cmp < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return -1;
+}
+
+static int fw_cfg_find_file(FWCfgFile *file, const char *name)
+{
+	int ret;
+
+	if (ENV_RAMSTAGE)
+		fw_cfg_load_dir();
+
+	if (fw_cfg_dir)
+		ret = fw_cfg_lookup_dir(file, name);
+	else
+		ret = fw_cfg_walk_dir(file, name);
+
+	if (ret == 0)
+		printk(BIOS_INFO, "QEMU: firmware config: Found '%s'\n", name);
+	else
+		printk(BIOS_INFO, "QEMU: firmware config: Couldn't find '%s'\n", name);
+	return ret;
+}
+
 int fw_cfg_check_file(FWCfgFile *file, const char *name)
 {
 	if (!fw_cfg_present())
@@ -102,6 +185,16 @@ int fw_cfg_check_file(FWCfgFile *file, const char *name)
 	return fw_cfg_find_file(file, name);
 }
 
+int fw_cfg_read_file(const char *name, void *dst, size_t dstlen)
+{
+	FWCfgFile f;
+
+	if (fw_cfg_check_file(&f, name))
+		return -1;
+	fw_cfg_get(f.select, dst, MIN(f.size, dstlen));
+	return f.size;
+}
+
 static int fw_cfg_e820_select(uint32_t *size)
 {
 	FWCfgFile file;
@@ -2,6 +2,8 @@
 
 ramstage-$(CONFIG_IPMI_KCS) += ipmi_if.c
 ramstage-$(CONFIG_IPMI_KCS) += ipmi_kcs.c
+ramstage-$(CONFIG_IPMI_KCS) += ipmi_bt.c
+ramstage-$(CONFIG_IPMI_KCS) += ipmi_ssif.c
 ramstage-$(CONFIG_IPMI_KCS) += ipmi_kcs_ops.c
 ramstage-$(CONFIG_IPMI_KCS) += ipmi_ops.c
 ramstage-$(CONFIG_IPMI_KCS) += ipmi_fru.c
@@ -10,4 +12,5 @@ romstage-$(CONFIG_IPMI_KCS_ROMSTAGE) += ipmi_if.c
 romstage-$(CONFIG_IPMI_KCS_ROMSTAGE) += ipmi_ops_premem.c
 romstage-$(CONFIG_IPMI_KCS_ROMSTAGE) += ipmi_kcs.c
 romstage-$(CONFIG_IPMI_KCS_ROMSTAGE) += ipmi_ops.c
+smm-$(CONFIG_SOC_RAS_BMC_SEL) += ipmi_if.c
 smm-$(CONFIG_SOC_RAS_BMC_SEL) += ipmi_kcs.c
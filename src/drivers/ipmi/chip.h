@@ -7,8 +7,18 @@
 
 #include <stdint.h>
 
+enum ipmi_if_type {
+	IPMI_IF_KCS = 0,
+	IPMI_IF_BT,
+	IPMI_IF_SSIF,
+	/* Try KCS, then BT. Devices on an SMBus always use SSIF. */
+	IPMI_IF_AUTO,
+};
+
 struct drivers_ipmi_config {
 #if CONFIG(IPMI_KCS)
+	/* System interface, SSIF devices sit on an SMBus instead of a PNP port */
+	enum ipmi_if_type interface;
 	u8 bmc_i2c_address;
 	u8 have_nv_storage;
 	u8 nv_storage_device_address;
@@ -0,0 +1,149 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+
+/*
+ * IPMI Block Transfer (BT) interface, IPMI spec v2.0 rev 1.1 Sec. 11.
+ * Unlike KCS, whole messages go through a buffer with a single handshake.
+ */
+
+#include <arch/io.h>
+#include <commonlib/helpers.h>
+#include <console/console.h>
+#include <timer.h>
+#include "ipmi_if.h"
+
+#define BT_CTRL(_x)	((_x))
+#define BT_BUF(_x)	((_x) + CONFIG_IPMI_KCS_REGISTER_SPACING)
+
+#define BT_CTRL_CLR_WR_PTR	(1 << 0)
+#define BT_CTRL_CLR_RD_PTR	(1 << 1)
+#define BT_CTRL_H2B_ATN		(1 << 2)
+#define BT_CTRL_B2H_ATN		(1 << 3)
+#define BT_CTRL_H_BUSY		(1 << 6)
+#define BT_CTRL_B_BUSY		(1 << 7)
+
+/* Length, netfn/lun, seq and cmd bytes in front of the request data */
+#define BT_REQ_HEADER		4
+/* The length byte covers netfn/lun, seq and cmd as well */
+#define BT_MAX_PAYLOAD		(0xff - 3)
+/* The spec requires buffers of at least 64 bytes */
+#define BT_MIN_BUFFER		64
+
+static uint8_t bt_seq;
+/* Largest request payload the BMC accepts, 0 until queried */
+static int bt_max_payload;
+
+static int bt_wait(int port, uint8_t mask, uint8_t value)
+{
+	if (!wait_ms(CONFIG_IPMI_KCS_TIMEOUT_MS, (inb(BT_CTRL(port)) & mask) == value)) {
+		printk(BIOS_ERR, "IPMI BT: timeout waiting for ctrl 0x%02x to be 0x%02x\n",
+		       mask, value);
+		return -1;
+	}
+	return 0;
+}
+
+static int ipmi_bt_send_message(int port, int netfn, int lun, int cmd,
+				const unsigned char *msg, int len)
+{
+	int i;
+
+	/* H_BUSY toggles on writes, clear it if a previous transfer left it set. */
+	if (inb(BT_CTRL(port)) & BT_CTRL_H_BUSY)
+		outb(BT_CTRL_H_BUSY, BT_CTRL(port));
+
+	/* Wait for the BMC to be done with the previous request */
+	if (bt_wait(port, BT_CTRL_B_BUSY | BT_CTRL_H2B_ATN, 0))
+		return -1;
+
+	outb(BT_CTRL_CLR_WR_PTR, BT_CTRL(port));
+	outb(len + 3, BT_BUF(port));
+	outb((netfn << 2) | (lun & 3), BT_BUF(port));
+	outb(bt_seq, BT_BUF(port));
+	outb(cmd, BT_BUF(port));
+	for (i = 0; i < len; i++)
+		outb(msg[i], BT_BUF(port));
+	outb(BT_CTRL_H2B_ATN, BT_CTRL(port));
+
+	return 0;
+}
+
+static int ipmi_bt_read_message(int port, unsigned char *msg, int len)
+{
+	uint8_t rsp_len, rsp_seq = 0, byte;
+	int i, ret = 0;
+
+	if (bt_wait(port, BT_CTRL_B2H_ATN, BT_CTRL_B2H_ATN))
+		return -1;
+
+	outb(BT_CTRL_H_BUSY, BT_CTRL(port));
+	outb(BT_CTRL_B2H_ATN, BT_CTRL(port));
+	outb(BT_CTRL_CLR_RD_PTR, BT_CTRL(port));
+
+	/* netfn/lun, seq, cmd, completion code and data */
+	rsp_len = inb(BT_BUF(port));
+	for (i = 0; i < rsp_len; i++) {
+		byte = inb(BT_BUF(port));
+		if (i == 1)
+			rsp_seq = byte;
+		else if (msg && ret < len)
+			msg[ret++] = byte;
+	}
+
+	outb(BT_CTRL_H_BUSY, BT_CTRL(port));
+
+	if (rsp_len < 4 || rsp_seq != bt_seq) {
+		printk(BIOS_ERR, "IPMI BT: bad response (len %u, seq 0x%02x, expected 0x%02x)\n",
+		       rsp_len, rsp_seq, bt_seq);
+		ret = -1;
+	}
+	bt_seq++;
+
+	return ret;
+}
+
+static int ipmi_bt_transfer(int port, int netfn, int lun, int cmd,
+			    const unsigned char *inmsg, int inlen,
+			    unsigned char *outmsg, int outlen)
+{
+	if (ipmi_bt_send_message(port, netfn, lun, cmd, inmsg, inlen)) {
+		printk(BIOS_ERR, "ipmi_bt_send_message failed\n");
+		return -1;
+	}
+
+	return ipmi_bt_read_message(port, outmsg, outlen);
+}
+
+/* Ask the BMC how large its request buffer is, the spec minimum if it can't tell */
+static int ipmi_bt_get_max_payload(int port)
+{
+	struct ipmi_bt_caps_rsp rsp;
+	int size = BT_MIN_BUFFER;
+	int ret;
+
+	ret = ipmi_bt_transfer(port, IPMI_NETFN_APPLICATION, 0,
+			       IPMI_BMC_GET_BT_INTERFACE_CAPABILITIES, NULL, 0,
+			       (unsigned char *)&rsp, sizeof(rsp));
+	if (ret == sizeof(rsp) && !rsp.resp.completion_code &&
+	    rsp.input_buffer_size >= BT_MIN_BUFFER)
+		size = rsp.input_buffer_size;
+	else
+		printk(BIOS_WARNING, "IPMI BT: Get BT Interface Capabilities failed\n");
+
+	printk(BIOS_DEBUG, "IPMI BT: %d byte request buffer\n", size);
+	return MIN(size - BT_REQ_HEADER, BT_MAX_PAYLOAD);
+}
+
+int ipmi_bt_message(int port, int netfn, int lun, int cmd,
+		    const unsigned char *inmsg, int inlen,
+		    unsigned char *outmsg, int outlen)
+{
+	if (!bt_max_payload)
+		bt_max_payload = ipmi_bt_get_max_payload(port);
+
+	if (inlen < 0 || inlen > bt_max_payload) {
+		printk(BIOS_ERR, "IPMI BT: request too long (%d bytes)\n", inlen);
+		return -1;
+	}
+
+	return ipmi_bt_transfer(port, netfn, lun, cmd, inmsg, inlen, outmsg, outlen);
+}
@@ -7,11 +7,65 @@
 
 #include "chip.h"
 
+/* Interface registered by the IPMI device in ramstage */
+static struct {
+	struct device *dev;
+	enum ipmi_if_type type;
+} ipmi_interface;
+
+void ipmi_set_interface(struct device *dev, enum ipmi_if_type type)
+{
+	ipmi_interface.dev = dev;
+	ipmi_interface.type = type;
+}
+
+enum ipmi_if_type ipmi_get_interface(const struct device *dev)
+{
+	if (dev && dev == ipmi_interface.dev)
+		return ipmi_interface.type;
+
+	return IPMI_IF_KCS;
+}
+
+int ipmi_dev_port(const struct device *dev)
+{
+	if (dev->path.type == DEVICE_PATH_PNP)
+		return dev->path.pnp.port;
+
+	return 0;
+}
+
+int ipmi_message(int port, int netfn, int lun, int cmd,
+		 const unsigned char *inmsg, int inlen,
+		 unsigned char *outmsg, int outlen)
+{
+	/* Don't interleave with, or run ahead of, the background BMC init */
+	if (ENV_RAMSTAGE)
+		ipmi_wait_for_bmc();
+
+	if (ENV_RAMSTAGE && ipmi_interface.dev) {
+		switch (ipmi_interface.type) {
+		case IPMI_IF_BT:
+			if (port == ipmi_dev_port(ipmi_interface.dev))
+				return ipmi_bt_message(port, netfn, lun, cmd, inmsg, inlen,
+						       outmsg, outlen);
+			break;
+		case IPMI_IF_SSIF:
+			return ipmi_ssif_message(ipmi_interface.dev, netfn, lun, cmd, inmsg,
+						 inlen, outmsg, outlen);
+		default:
+			break;
+		}
+	}
+
+	return ipmi_kcs_message(port, netfn, lun, cmd, inmsg, inlen, outmsg, outlen);
+}
+
 int ipmi_get_device_id(const struct device *dev, struct ipmi_devid_rsp *rsp)
 {
 	int ret;
 
-	ret = ipmi_message(dev->path.pnp.port, IPMI_NETFN_APPLICATION, 0,
+	ret = ipmi_message(ipmi_dev_port(dev), IPMI_NETFN_APPLICATION, 0,
 			   IPMI_BMC_GET_DEVICE_ID, NULL, 0, (u8 *)rsp,
 			   sizeof(*rsp));
 	if (ret < sizeof(struct ipmi_rsp) || rsp->resp.completion_code) {
@@ -31,7 +85,7 @@ static int ipmi_get_bmc_self_test_result(const struct device *dev,
 {
 	int ret;
 
-	ret = ipmi_message(dev->path.pnp.port, IPMI_NETFN_APPLICATION, 0,
+	ret = ipmi_message(ipmi_dev_port(dev), IPMI_NETFN_APPLICATION, 0,
 			   IPMI_BMC_GET_SELFTEST_RESULTS, NULL, 0, (u8 *)rsp,
 			   sizeof(*rsp));
 
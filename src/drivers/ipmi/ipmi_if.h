@@ -7,6 +7,8 @@
 
 #include <stdint.h>
 
+#include "chip.h"
+
 #define IPMI_NETFN_CHASSIS 0x00
 #define IPMI_NETFN_BRIDGE 0x02
 #define IPMI_NETFN_SENSOREVENT 0x04
@@ -20,6 +22,7 @@
 #define   IPMI_APP_SELFTEST_NOT_IMPLEMENTED      0x56
 #define   IPMI_APP_SELFTEST_ERROR                0x57
 #define   IPMI_APP_SELFTEST_FATAL_HW_ERROR       0x58
+#define  IPMI_BMC_GET_BT_INTERFACE_CAPABILITIES 0x36
 
 #define IPMI_NETFN_FIRMWARE 0x08
 #define IPMI_NETFN_STORAGE 0x0a
@@ -55,17 +58,50 @@ struct ipmi_selftest_rsp {
 	uint8_t param;
 } __packed;
 
+/* Get BT Interface Capabilities */
+struct ipmi_bt_caps_rsp {
+	struct ipmi_rsp resp;
+	uint8_t outstanding_requests;
+	uint8_t input_buffer_size;	/* Including the length byte */
+	uint8_t output_buffer_size;	/* Including the length byte */
+	uint8_t response_time_secs;
+	uint8_t retries;
+} __packed;
+
 struct device;
 
 /*
  * Sends a command and reads its response. Input buffer is for payload, but
  * output includes `struct ipmi_rsp` as a header. Returns number of bytes copied
  * into the buffer or -1.
+ *
+ * Messages go through KCS unless the IPMI device registered another interface
+ * in ramstage: a BT interface is used for its own port, an SSIF interface for
+ * all messages, as it has no port.
  */
 int ipmi_message(int port, int netfn, int lun, int cmd,
 		 const unsigned char *inmsg, int inlen,
 		 unsigned char *outmsg, int outlen);
 
+/* Transports behind ipmi_message(), same arguments and return value */
+int ipmi_kcs_message(int port, int netfn, int lun, int cmd,
+		     const unsigned char *inmsg, int inlen,
+		     unsigned char *outmsg, int outlen);
+int ipmi_bt_message(int port, int netfn, int lun, int cmd,
+		    const unsigned char *inmsg, int inlen,
+		    unsigned char *outmsg, int outlen);
+int ipmi_ssif_message(struct device *dev, int netfn, int lun, int cmd,
+		      const unsigned char *inmsg, int inlen,
+		      unsigned char *outmsg, int outlen);
+
+/* Route ipmi_message() through the given interface of the IPMI device `dev`. */
+void ipmi_set_interface(struct device *dev, enum ipmi_if_type type);
+/* Interface in use for `dev`, KCS if none was set. */
+enum ipmi_if_type ipmi_get_interface(const struct device *dev);
+
+/* The port to pass to ipmi_message() for the IPMI device `dev` */
+int ipmi_dev_port(const struct device *dev);
+
 /* Run basic IPMI init functions in romstage from the provided PnP device,
  * returns CB_SUCCESS on success and CB_ERR if an error occurred. */
 enum cb_err ipmi_premem_init(const uint16_t port, const uint16_t device);
@@ -76,4 +112,11 @@ int ipmi_process_self_test_result(const struct device *dev);
 
 void ipmi_bmc_version(uint8_t *ipmi_bmc_major_revision, uint8_t *ipmi_bmc_minor_revision);
 
+/*
+ * With COOP_MULTITASKING the IPMI KCS device waits for the BMC in the background.
+ * Wait for that to finish. ipmi_message() calls this, so only code using the
+ * results of the BMC init without sending a message needs to call it.
+ */
+void ipmi_wait_for_bmc(void);
+
 #endif /* __IPMI_IF_H */
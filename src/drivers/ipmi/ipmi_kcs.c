@@ -219,9 +219,9 @@ static int ipmi_kcs_read_message(int port, unsigned char *msg, int len)
 	return ret;
 }
 
-int ipmi_message(int port, int netfn, int lun, int cmd,
-		 const unsigned char *inmsg, int inlen,
-		 unsigned char *outmsg, int outlen)
+int ipmi_kcs_message(int port, int netfn, int lun, int cmd,
+		     const unsigned char *inmsg, int inlen,
+		     unsigned char *outmsg, int outlen)
 {
 	if (ipmi_kcs_send_message(port, netfn, lun, cmd, inmsg, inlen)) {
 		printk(BIOS_ERR, "ipmi_kcs_send_message failed\n");
@@ -6,6 +6,20 @@
  * chip drivers/ipmi
  *   device pnp ca2.0 on end         # IPMI KCS
  * end
+ *
+ * For BT, or to probe for KCS and BT, set the interface:
+ *
+ * chip drivers/ipmi
+ *   register "interface" = "IPMI_IF_BT"
+ *   device pnp e4.0 on end          # IPMI BT
+ * end
+ *
+ * SSIF BMCs are placed below the SMBus controller:
+ *
+ * chip drivers/ipmi
+ *   register "interface" = "IPMI_IF_SSIF"
+ *   device i2c 10 on end            # IPMI SSIF
+ * end
  */
 
 #include <arch/io.h>
@@ -23,12 +37,14 @@
 #endif
 #include <version.h>
 #include <delay.h>
+#include <thread.h>
 #include <timer.h>
 #include "ipmi_if.h"
 #include "ipmi_supermicro_oem.h"
 #include "chip.h"
 
 #define IPMI_GET_DID_RETRY_MS 10000
+#define IPMI_GET_DID_INTERVAL_MS 10
 
 /* 4 bit encoding */
 static u8 ipmi_revision_major = 0x1;
@@ -39,6 +55,22 @@ static u8 bmc_revision_minor = 0x0;
 
 static struct boot_state_callback bscb_post_complete;
 
+static struct thread_handle bmc_init_handle;
+
+static const char *const ipmi_if_names[] = {
+	[IPMI_IF_KCS] = "KCS",
+	[IPMI_IF_BT] = "BT",
+	[IPMI_IF_SSIF] = "SSIF",
+};
+
+void ipmi_wait_for_bmc(void)
+{
+	/* The BMC init thread itself talks to the BMC through ipmi_message() */
+	if (CONFIG(COOP_MULTITASKING) && bmc_init_handle.state != THREAD_UNINITIALIZED &&
+	    !thread_is_current(&bmc_init_handle))
+		thread_join(&bmc_init_handle);
+}
+
 static void bmc_set_post_complete_gpio_callback(void *arg)
 {
 	struct drivers_ipmi_config *conf = arg;
@@ -47,6 +79,8 @@ static void bmc_set_post_complete_gpio_callback(void *arg)
 	if (!conf || !conf->post_complete_gpio)
 		return;
 
+	ipmi_wait_for_bmc();
+
 	gpio_ops = dev_get_gpio_ops(conf->gpio_dev);
 	if (!gpio_ops) {
 		printk(BIOS_WARNING, "IPMI: specified gpio device is missing gpio ops!\n");
@@ -59,50 +93,48 @@ static void bmc_set_post_complete_gpio_callback(void *arg)
 	printk(BIOS_DEBUG, "BMC: POST complete gpio set\n");
 }
 
-static void ipmi_kcs_init(struct device *dev)
+/*
+ * Find the interface answering Get Device ID. KCS goes first, as the register
+ * accesses of a BT transfer would confuse a KCS BMC, but not the other way round.
+ */
+static void ipmi_probe_interface(struct device *dev)
 {
+	static const enum ipmi_if_type order[] = { IPMI_IF_KCS, IPMI_IF_BT };
 	struct ipmi_devid_rsp rsp;
-	uint32_t man_id = 0, prod_id = 0;
-	struct drivers_ipmi_config *conf = dev->chip_info;
-	const struct gpio_operations *gpio_ops;
+	size_t i;
 
-	if (!conf) {
-		printk(BIOS_WARNING, "IPMI: chip_info is missing! Skip init.\n");
-		return;
-	}
-
-	if (conf->bmc_jumper_gpio) {
-		gpio_ops = dev_get_gpio_ops(conf->gpio_dev);
-		if (!gpio_ops) {
-			printk(BIOS_WARNING, "IPMI: gpio device is missing gpio ops!\n");
-		} else {
-			/* Get jumper value and set device state accordingly */
-			dev->enabled = gpio_ops->get(conf->bmc_jumper_gpio);
-			if (!dev->enabled)
-				printk(BIOS_INFO, "IPMI: Disabled by jumper\n");
+	for (i = 0; i < ARRAY_SIZE(order); i++) {
+		ipmi_set_interface(dev, order[i]);
+		if (!ipmi_get_device_id(dev, &rsp)) {
+			printk(BIOS_INFO, "IPMI: Found %s interface\n", ipmi_if_names[order[i]]);
+			return;
 		}
 	}
 
-	if (!dev->enabled)
-		return;
-
-	printk(BIOS_DEBUG, "IPMI: PNP KCS 0x%x\n", dev->path.pnp.port);
+	printk(BIOS_WARNING, "IPMI: No interface responded, falling back to KCS\n");
+	ipmi_set_interface(dev, IPMI_IF_KCS);
+}
 
-	/* Set up boot state callback for POST_COMPLETE# */
-	if (conf->post_complete_gpio) {
-		bscb_post_complete.callback = bmc_set_post_complete_gpio_callback;
-		bscb_post_complete.arg = conf;
-		boot_state_sched_on_entry(&bscb_post_complete, BS_PAYLOAD_BOOT);
-	}
+/*
+ * Waiting for the BMC to come up can take tens of seconds after a power loss, so
+ * with COOP_MULTITASKING this runs in its own thread. KCS transfers don't yield,
+ * so only the waits in between let the rest of ramstage carry on.
+ */
+static enum cb_err ipmi_kcs_bmc_init(void *arg)
+{
+	struct device *dev = arg;
+	struct drivers_ipmi_config *conf = dev->chip_info;
+	struct ipmi_devid_rsp rsp;
+	uint32_t man_id = 0, prod_id = 0;
+	struct stopwatch sw;
 
 	/* Get IPMI version for ACPI and SMBIOS */
-	if (conf->wait_for_bmc && conf->bmc_boot_timeout) {
-		struct stopwatch sw;
+	if (conf->wait_for_bmc && conf->bmc_boot_timeout && dev->path.type == DEVICE_PATH_PNP) {
 		stopwatch_init_msecs_expire(&sw, conf->bmc_boot_timeout * 1000);
 		printk(BIOS_INFO, "IPMI: Waiting for BMC...\n");
 
 		while (!stopwatch_expired(&sw)) {
-			if (inb(dev->path.pnp.port) != 0xff)
+			if (inb(ipmi_dev_port(dev)) != 0xff)
 				break;
 			mdelay(100);
 		}
@@ -110,21 +142,28 @@ static void ipmi_kcs_init(struct device *dev)
 			printk(BIOS_INFO, "IPMI: Waiting for BMC timed out\n");
 			/* Don't write tables if communication failed */
 			dev->enabled = 0;
-			return;
+			return CB_ERR;
 		}
 	}
 
+	if (conf->interface == IPMI_IF_AUTO && dev->path.type == DEVICE_PATH_PNP)
+		ipmi_probe_interface(dev);
+
 	if (ipmi_process_self_test_result(dev)) {
 		/* Don't write tables if communication failed */
 		dev->enabled = 0;
-		return;
+		return CB_ERR;
 	}
 
-	if (!wait_ms(IPMI_GET_DID_RETRY_MS, !ipmi_get_device_id(dev, &rsp))) {
-		printk(BIOS_ERR, "IPMI: BMC does not respond to get device id even "
-			"after %d ms.\n", IPMI_GET_DID_RETRY_MS);
-		dev->enabled = 0;
-		return;
+	stopwatch_init_msecs_expire(&sw, IPMI_GET_DID_RETRY_MS);
+	while (ipmi_get_device_id(dev, &rsp)) {
+		if (stopwatch_expired(&sw)) {
+			printk(BIOS_ERR, "IPMI: BMC does not respond to get device id even "
+				"after %d ms.\n", IPMI_GET_DID_RETRY_MS);
+			dev->enabled = 0;
+			return CB_ERR;
+		}
+		mdelay(IPMI_GET_DID_INTERVAL_MS);
 	}
 
 	/* Queried the IPMI revision from BMC */
@@ -144,7 +183,59 @@ static void ipmi_kcs_init(struct device *dev)
 	       ipmi_revision_minor);
 
 	if (CONFIG(DRIVERS_IPMI_SUPERMICRO_OEM))
-		supermicro_ipmi_oem(dev->path.pnp.port);
+		supermicro_ipmi_oem(ipmi_dev_port(dev));
+
+	return CB_SUCCESS;
+}
+
+static void ipmi_kcs_init(struct device *dev)
+{
+	struct drivers_ipmi_config *conf = dev->chip_info;
+	const struct gpio_operations *gpio_ops;
+
+	if (!conf) {
+		printk(BIOS_WARNING, "IPMI: chip_info is missing! Skip init.\n");
+		return;
+	}
+
+	if (conf->bmc_jumper_gpio) {
+		gpio_ops = dev_get_gpio_ops(conf->gpio_dev);
+		if (!gpio_ops) {
+			printk(BIOS_WARNING, "IPMI: gpio device is missing gpio ops!\n");
+		} else {
+			/* Get jumper value and set device state accordingly */
+			dev->enabled = gpio_ops->get(conf->bmc_jumper_gpio);
+			if (!dev->enabled)
+				printk(BIOS_INFO, "IPMI: Disabled by jumper\n");
+		}
+	}
+
+	if (!dev->enabled)
+		return;
+
+	printk(BIOS_DEBUG, "IPMI: %s\n", dev_path(dev));
+
+	if (dev->path.type == DEVICE_PATH_I2C)
+		ipmi_set_interface(dev, IPMI_IF_SSIF);
+	else if (conf->interface != IPMI_IF_AUTO)
+		ipmi_set_interface(dev, conf->interface);
+
+	/* Set up boot state callback for POST_COMPLETE# */
+	if (conf->post_complete_gpio) {
+		bscb_post_complete.callback = bmc_set_post_complete_gpio_callback;
+		bscb_post_complete.arg = conf;
+		boot_state_sched_on_entry(&bscb_post_complete, BS_PAYLOAD_BOOT);
+	}
+
+	/*
+	 * The tables are the last user, ipmi_message() waits for the thread
+	 * in case something talks to the BMC earlier.
+	 */
+	if (CONFIG(COOP_MULTITASKING) && !thread_run_until(&bmc_init_handle, ipmi_kcs_bmc_init,
+							    dev, BS_WRITE_TABLES, BS_ON_ENTRY))
+		return;
+
+	ipmi_kcs_bmc_init(dev);
 }
 
 #if CONFIG(HAVE_ACPI_TABLES)
@@ -155,13 +246,14 @@ ipmi_write_acpi_tables(const struct device *dev, unsigned long current,
 		       struct acpi_rsdp *rsdp)
 {
 	struct drivers_ipmi_config *conf = dev->chip_info;
+	const enum ipmi_if_type type = ipmi_get_interface(dev);
 	struct acpi_spmi *spmi;
 	s8 gpe_interrupt = -1;
 	u32 apic_interrupt = 0;
 	acpi_addr_t addr = {
 		.space_id = ACPI_ADDRESS_SPACE_IO,
 		.access_size = ACPI_ACCESS_SIZE_BYTE_ACCESS,
-		.addrl = dev->path.pnp.port,
+		.addrl = ipmi_dev_port(dev),
 		.bit_width = 8,
 	};
 
@@ -180,6 +272,14 @@ ipmi_write_acpi_tables(const struct device *dev, unsigned long current,
 		break;
 	}
 
+	if (type == IPMI_IF_SSIF) {
+		addr.space_id = ACPI_ADDRESS_SPACE_SMBUS;
+		addr.access_size = ACPI_ACCESS_SIZE_UNDEFINED;
+		addr.addrl = dev->path.i2c.device;
+		addr.bit_width = 0;
+		addr.bit_offset = 0;
+	}
+
 	current = ALIGN_UP(current, 8);
 	printk(BIOS_DEBUG, "ACPI:    * SPMI at %lx\n", current);
 	spmi = (struct acpi_spmi *)current;
@@ -193,7 +293,9 @@ ipmi_write_acpi_tables(const struct device *dev, unsigned long current,
 		/* Use command to get UID from ipmi_ssdt */
 		acpi_create_ipmi(dev, spmi, (ipmi_revision_major << 8) |
 				 (ipmi_revision_minor << 4), &addr,
-				 IPMI_INTERFACE_KCS, gpe_interrupt, apic_interrupt,
+				 type == IPMI_IF_SSIF ? IPMI_INTERFACE_SSIF :
+				 type == IPMI_IF_BT ? IPMI_INTERFACE_BT : IPMI_INTERFACE_KCS,
+				 gpe_interrupt, apic_interrupt,
 				 conf->uid);
 
 		acpi_add_table(rsdp, spmi);
@@ -210,6 +312,13 @@ static void ipmi_ssdt(const struct device *dev)
 {
 	const char *scope = acpi_device_scope(dev);
 	struct drivers_ipmi_config *conf = dev->chip_info;
+	const enum ipmi_if_type type = ipmi_get_interface(dev);
+	const int port = ipmi_dev_port(dev);
+	int i;
+
+	/* SSIF BMCs are described by SPMI and SMBIOS only */
+	if (type == IPMI_IF_SSIF)
+		return;
 
 	if (!scope) {
 		printk(BIOS_ERR, "IPMI: Missing ACPI scope for %s\n",
@@ -229,14 +338,15 @@ static void ipmi_ssdt(const struct device *dev)
 	acpigen_write_scope(scope);
 	acpigen_write_device("SPMI");
 	acpigen_write_name_string("_HID", "IPI0001");
-	acpigen_write_name_unicode("_STR", "IPMI_KCS");
+	acpigen_write_name_unicode("_STR", type == IPMI_IF_BT ? "IPMI_BT" : "IPMI_KCS");
 	acpigen_write_name_byte("_UID", conf->uid);
 	acpigen_write_STA(0xf);
 	acpigen_write_name("_CRS");
 	acpigen_write_resourcetemplate_header();
-	acpigen_write_io16(dev->path.pnp.port, dev->path.pnp.port, 1, 1, 1);
-	acpigen_write_io16(dev->path.pnp.port + CONFIG_IPMI_KCS_REGISTER_SPACING,
-			   dev->path.pnp.port + CONFIG_IPMI_KCS_REGISTER_SPACING, 1, 1, 1);
+	/* KCS has data and status/command registers, BT control, buffer and interrupt mask */
+	for (i = 0; i < (type == IPMI_IF_BT ? 3 : 2); i++)
+		acpigen_write_io16(port + i * CONFIG_IPMI_KCS_REGISTER_SPACING,
+				   port + i * CONFIG_IPMI_KCS_REGISTER_SPACING, 1, 1, 1);
 
 	// FIXME: is that correct?
 	if (conf->have_apic)
@@ -245,7 +355,7 @@ static void ipmi_ssdt(const struct device *dev)
 	acpigen_write_resourcetemplate_footer();
 
 	acpigen_write_method("_IFT", 0);
-	acpigen_write_return_byte(1);	// KCS
+	acpigen_write_return_byte(type == IPMI_IF_BT ? IPMI_INTERFACE_BT : IPMI_INTERFACE_KCS);
 	acpigen_pop_len();
 
 	acpigen_write_method("_SRV", 0);
@@ -260,6 +370,7 @@ static void ipmi_ssdt(const struct device *dev)
 
 void ipmi_bmc_version(uint8_t *ipmi_bmc_major_revision, uint8_t *ipmi_bmc_minor_revision)
 {
+	ipmi_wait_for_bmc();
 	*ipmi_bmc_major_revision = bmc_revision_major;
 	*ipmi_bmc_minor_revision = bmc_revision_minor;
 }
@@ -269,9 +380,12 @@ static int ipmi_smbios_data(struct device *dev, int *handle,
 			    unsigned long *current)
 {
 	struct drivers_ipmi_config *conf = dev->chip_info;
+	const enum ipmi_if_type type = ipmi_get_interface(dev);
 	u8 nv_storage = 0xff;
 	u8 i2c_address = 0;
 	u8 register_spacing;
+	u8 interface = SMBIOS_BMC_INTERFACE_KCS;
+	u64 base_address = ipmi_dev_port(dev) | 1; // IO interface
 
 	int len = 0;
 
@@ -296,14 +410,23 @@ static int ipmi_smbios_data(struct device *dev, int *handle,
 		break;
 	}
 
+	if (type == IPMI_IF_BT) {
+		interface = SMBIOS_BMC_INTERFACE_BLOCK;
+	} else if (type == IPMI_IF_SSIF) {
+		interface = SMBIOS_BMC_INTERFACE_SMBUS;
+		/* SMBus slave address, shifted as on the wire */
+		base_address = dev->path.i2c.device << 1;
+		register_spacing = 0;
+	}
+
 	// add IPMI Device Information
 	len += smbios_write_type38(
 		current, handle,
-		SMBIOS_BMC_INTERFACE_KCS,
+		interface,
 		ipmi_revision_minor | (ipmi_revision_major << 4),
 		i2c_address, // I2C address
 		nv_storage, // NV storage
-		dev->path.pnp.port | 1, // IO interface
+		base_address,
 		register_spacing,
 		0); // no IRQ
 
@@ -328,9 +451,13 @@ static void ipmi_set_resources(struct device *dev)
 
 static void ipmi_read_resources(struct device *dev)
 {
+	struct drivers_ipmi_config *conf = dev->chip_info;
 	struct resource *res = new_resource(dev, 0);
+	/* KCS has data and status/command registers, BT control, buffer and interrupt mask */
+	const int registers = (conf && conf->interface != IPMI_IF_KCS) ? 3 : 2;
+
 	res->base = dev->path.pnp.port;
-	res->size = 2;
+	res->size = (registers - 1) * CONFIG_IPMI_KCS_REGISTER_SPACING + 1;
 	res->flags = IORESOURCE_IO | IORESOURCE_ASSIGNED | IORESOURCE_FIXED;
 }
 
@@ -347,11 +474,33 @@ static struct device_operations ops = {
 #endif
 };
 
+static struct device_operations ssif_ops = {
+	.read_resources   = noop_read_resources,
+	.set_resources    = noop_set_resources,
+	.init             = ipmi_kcs_init,
+#if CONFIG(HAVE_ACPI_TABLES)
+	.write_acpi_tables = ipmi_write_acpi_tables,
+#endif
+#if CONFIG(GENERATE_SMBIOS_TABLES)
+	.get_smbios_data = ipmi_smbios_data,
+#endif
+};
+
 static void enable_dev(struct device *dev)
 {
+	struct drivers_ipmi_config *conf = dev->chip_info;
+
+	if (dev->path.type == DEVICE_PATH_I2C) {
+		dev->ops = &ssif_ops;
+		return;
+	}
+
 	if (dev->path.type != DEVICE_PATH_PNP)
 		printk(BIOS_ERR, "%s: Unsupported device type\n",
 		       dev_path(dev));
+	else if (conf && conf->interface == IPMI_IF_SSIF)
+		printk(BIOS_ERR, "%s: SSIF needs an I2C device\n",
+		       dev_path(dev));
 	else if (dev->path.pnp.port & 1)
 		printk(BIOS_ERR, "%s: Base address needs to be aligned to 2\n",
 		       dev_path(dev));
@@ -0,0 +1,155 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+
+/*
+ * IPMI SMBus System Interface (SSIF), IPMI spec v2.0 rev 1.1 Sec. 12.
+ * Requests and responses longer than one SMBus block are split up.
+ */
+
+#include <console/console.h>
+#include <delay.h>
+#include <device/smbus.h>
+#include <string.h>
+#include <thread.h>
+#include <timer.h>
+#include "ipmi_if.h"
+
+#define SSIF_WRITE_SINGLE		0x02
+#define SSIF_READ_SINGLE		0x03
+#define SSIF_WRITE_MULTI_START		0x06
+#define SSIF_WRITE_MULTI_MIDDLE		0x07
+#define SSIF_WRITE_MULTI_END		0x08
+#define SSIF_READ_MULTI_MIDDLE		0x09
+
+#define SSIF_BLOCK_LEN			32
+#define SSIF_MULTI_READ_START_0		0x00
+#define SSIF_MULTI_READ_START_1		0x01
+#define SSIF_MULTI_READ_END		0xff
+
+/* The BMC NAKs its address while it is busy */
+#define SSIF_RETRY_MS			1
+
+#define SSIF_MAX_REQUEST		(2 + 0xff)
+
+/* Retrying may yield, keep other threads from slipping in between request and response. */
+static struct thread_mutex ssif_mutex;
+
+static int ssif_write(struct device *dev, uint8_t cmd, const uint8_t *buf, size_t len)
+{
+	struct stopwatch sw;
+
+	stopwatch_init_msecs_expire(&sw, CONFIG_IPMI_KCS_TIMEOUT_MS);
+	while (smbus_block_write(dev, cmd, len, buf) < 0) {
+		if (stopwatch_expired(&sw)) {
+			printk(BIOS_ERR, "IPMI SSIF: write 0x%02x timed out\n", cmd);
+			return -1;
+		}
+		mdelay(SSIF_RETRY_MS);
+	}
+	return 0;
+}
+
+static int ssif_read(struct device *dev, uint8_t cmd, uint8_t *buf)
+{
+	struct stopwatch sw;
+	int ret;
+
+	stopwatch_init_msecs_expire(&sw, CONFIG_IPMI_KCS_TIMEOUT_MS);
+	while ((ret = smbus_block_read(dev, cmd, SSIF_BLOCK_LEN, buf)) < 0) {
+		if (stopwatch_expired(&sw)) {
+			printk(BIOS_ERR, "IPMI SSIF: read 0x%02x timed out\n", cmd);
+			return -1;
+		}
+		mdelay(SSIF_RETRY_MS);
+	}
+	return ret;
+}
+
+static int ipmi_ssif_send_message(struct device *dev, int netfn, int lun, int cmd,
+				  const unsigned char *msg, int len)
+{
+	uint8_t req[SSIF_MAX_REQUEST];
+	size_t total = len + 2, pos, chunk;
+	uint8_t ssif_cmd;
+
+	req[0] = (netfn << 2) | (lun & 3);
+	req[1] = cmd;
+	if (len)
+		memcpy(&req[2], msg, len);
+
+	if (total <= SSIF_BLOCK_LEN)
+		return ssif_write(dev, SSIF_WRITE_SINGLE, req, total);
+
+	for (pos = 0; pos < total; pos += chunk) {
+		chunk = MIN(total - pos, SSIF_BLOCK_LEN);
+		if (pos == 0)
+			ssif_cmd = SSIF_WRITE_MULTI_START;
+		else if (pos + chunk < total)
+			ssif_cmd = SSIF_WRITE_MULTI_MIDDLE;
+		else
+			ssif_cmd = SSIF_WRITE_MULTI_END;
+
+		if (ssif_write(dev, ssif_cmd, &req[pos], chunk))
+			return -1;
+	}
+
+	return 0;
+}
+
+static void ssif_copy(unsigned char *msg, int len, int *ret, const uint8_t *buf, int count)
+{
+	while (count-- > 0) {
+		if (msg && *ret < len)
+			msg[(*ret)++] = *buf;
+		buf++;
+	}
+}
+
+static int ipmi_ssif_read_message(struct device *dev, unsigned char *msg, int len)
+{
+	uint8_t buf[SSIF_BLOCK_LEN];
+	int count, ret = 0;
+
+	count = ssif_read(dev, SSIF_READ_SINGLE, buf);
+	if (count < 0)
+		return -1;
+
+	if (count < 2 || buf[0] != SSIF_MULTI_READ_START_0 ||
+	    buf[1] != SSIF_MULTI_READ_START_1) {
+		ssif_copy(msg, len, &ret, buf, count);
+		return ret;
+	}
+
+	ssif_copy(msg, len, &ret, &buf[2], count - 2);
+	do {
+		count = ssif_read(dev, SSIF_READ_MULTI_MIDDLE, buf);
+		if (count < 1)
+			return -1;
+		/* First byte is the block number, the last block is numbered 0xff. */
+		ssif_copy(msg, len, &ret, &buf[1], count - 1);
+	} while (buf[0] != SSIF_MULTI_READ_END);
+
+	return ret;
+}
+
+int ipmi_ssif_message(struct device *dev, int netfn, int lun, int cmd,
+		      const unsigned char *inmsg, int inlen,
+		      unsigned char *outmsg, int outlen)
+{
+	int ret = -1;
+
+	if (inlen < 0 || inlen + 2 > SSIF_MAX_REQUEST) {
+		printk(BIOS_ERR, "IPMI SSIF: request too long (%d bytes)\n", inlen);
+		return -1;
+	}
+
+	thread_mutex_lock(&ssif_mutex);
+
+	if (ipmi_ssif_send_message(dev, netfn, lun, cmd, inmsg, inlen))
+		printk(BIOS_ERR, "ipmi_ssif_send_message failed\n");
+	else
+		ret = ipmi_ssif_read_message(dev, outmsg, outlen);
+
+	thread_mutex_unlock(&ssif_mutex);
+
+	return ret;
+}
@@ -4,6 +4,7 @@
 #include <device/i2c_simple.h>
 #include <edid.h>
 #include <console/console.h>
+#include <power_timeline.h>
 #include <timer.h>
 #include <dp_aux.h>
 #include "ps8640.h"
@@ -47,7 +48,8 @@ int ps8640_init(uint8_t bus, uint8_t chip)
 	u8 set_vdo_done;
 	struct stopwatch sw;
 
-	mdelay(200);
+	/* Give the bridge 200ms after reset to come up */
+	power_timeline_wait_msecs(POWER_TIMELINE_BRIDGE_RESET, 200);
 	stopwatch_init_msecs_expire(&sw, 200);
 
 	while (true) {
@@ -14,6 +14,93 @@
 /* Don't warn for checking >= LB_CKS_RANGE_START even though it may be 0. */
 #pragma GCC diagnostic ignored "-Wtype-limits"
 
+#define LB_CKS_RANGE_SIZE (LB_CKS_RANGE_END - LB_CKS_RANGE_START + 1)
+
+/*
+ * Per-stage copy of the checksummed CMOS range. Every CMOS byte is a slow
+ * port I/O access, so the range is read and validated once and options are
+ * then served from memory. Writes through the option API go to both CMOS
+ * and the copy, which also makes updating the checksum free. Any other
+ * cmos_write() to the range or the checksum drops the copy.
+ *
+ * SMM keeps its data across SMIs while the OS may change CMOS behind our
+ * back, so there the snapshot is not used.
+ */
+static struct {
+	bool loaded;
+	bool cks_valid;
+	u16 sum;
+	u8 data[LB_CKS_RANGE_SIZE];
+} cmos_snapshot;
+
+static bool cmos_snapshot_load(void)
+{
+	unsigned int i;
+	u16 old_sum;
+
+	if (ENV_SMM)
+		return false;
+
+	if (cmos_snapshot.loaded)
+		return true;
+
+	cmos_snapshot.sum = 0;
+	for (i = 0; i < LB_CKS_RANGE_SIZE; i++) {
+		cmos_snapshot.data[i] = cmos_read(LB_CKS_RANGE_START + i);
+		cmos_snapshot.sum += cmos_snapshot.data[i];
+	}
+	old_sum = (cmos_read(LB_CKS_LOC) << 8) | cmos_read(LB_CKS_LOC + 1);
+	cmos_snapshot.cks_valid = CONFIG(STATIC_OPTION_TABLE) || cmos_snapshot.sum == old_sum;
+	cmos_snapshot.loaded = true;
+	return true;
+}
+
+static bool cmos_in_cks_range(unsigned long byte)
+{
+	return byte >= LB_CKS_RANGE_START && byte <= LB_CKS_RANGE_END;
+}
+
+void cmos_options_invalidate(unsigned char addr)
+{
+	if (cmos_in_cks_range(addr) || addr == LB_CKS_LOC || addr == LB_CKS_LOC + 1)
+		cmos_snapshot.loaded = false;
+}
+
+static unsigned char cmos_option_read(unsigned long byte)
+{
+	if (cmos_snapshot.loaded && cmos_in_cks_range(byte))
+		return cmos_snapshot.data[byte - LB_CKS_RANGE_START];
+	return cmos_read(byte);
+}
+
+static void cmos_option_write(unsigned char val, unsigned long byte)
+{
+	__cmos_write(val, byte);
+	if (cmos_snapshot.loaded && cmos_in_cks_range(byte)) {
+		u8 *const cached = &cmos_snapshot.data[byte - LB_CKS_RANGE_START];
+		cmos_snapshot.sum += val - *cached;
+		*cached = val;
+	}
+}
+
+static bool cmos_options_cks_valid(void)
+{
+	if (cmos_snapshot_load())
+		return cmos_snapshot.cks_valid;
+	return cmos_checksum_valid(LB_CKS_RANGE_START, LB_CKS_RANGE_END, LB_CKS_LOC);
+}
+
+static void cmos_options_set_checksum(void)
+{
+	if (!cmos_snapshot.loaded) {
+		cmos_set_checksum(LB_CKS_RANGE_START, LB_CKS_RANGE_END, LB_CKS_LOC);
+		return;
+	}
+	__cmos_write((cmos_snapshot.sum >> 8) & 0xff, LB_CKS_LOC);
+	__cmos_write((cmos_snapshot.sum >> 0) & 0xff, LB_CKS_LOC + 1);
+	cmos_snapshot.cks_valid = true;
+}
+
 /*
  * This routine returns the value of the requested bits.
  * input bit = bit count from the beginning of the CMOS image
@@ -37,14 +124,14 @@ static enum cb_err get_cmos_value(unsigned long bit, unsigned long length,
 	byte = bit / 8;	/* find the byte where the data starts */
 	byte_bit = bit % 8; /* find the bit in the byte where the data starts */
 	if (length < 9) {	/* one byte or less */
-		uchar = cmos_read(byte); /* load the byte */
+		uchar = cmos_option_read(byte); /* load the byte */
 		uchar >>= byte_bit;	/* shift the bits to byte align */
 		/* clear unspecified bits */
 		ret[0] = uchar & ((1 << length) - 1);
 	} else {	/* more than one byte so transfer the whole bytes */
 		for (i = 0; length; i++, length -= 8, byte++) {
 			/* load the byte */
-			ret[i] = cmos_read(byte);
+			ret[i] = cmos_option_read(byte);
 		}
 	}
 	return CB_SUCCESS;
@@ -105,7 +192,7 @@ static enum cb_err cmos_get_uint_option(unsigned int *dest, const char *name)
 		return CB_ERR_ARG;
 	}
 
-	if (!cmos_checksum_valid(LB_CKS_RANGE_START, LB_CKS_RANGE_END, LB_CKS_LOC))
+	if (!cmos_options_cks_valid())
 		return CB_CMOS_CHECKSUM_INVALID;
 
 	if (get_cmos_value(ce->bit, ce->length, dest) != CB_SUCCESS)
@@ -136,28 +223,25 @@ static enum cb_err set_cmos_value(unsigned long bit, unsigned long length,
 		mask = (1 << length) - 1;
 		mask <<= byte_bit;
 
-		uchar = cmos_read(byte);
+		uchar = cmos_option_read(byte);
 		uchar &= ~mask;
 		uchar |= (ret[0] << byte_bit);
-		cmos_write(uchar, byte);
-		if (byte >= LB_CKS_RANGE_START && byte <= LB_CKS_RANGE_END)
+		cmos_option_write(uchar, byte);
+		if (cmos_in_cks_range(byte))
 			chksum_update_needed = 1;
 	} else { /* more that one byte so transfer the whole bytes */
 		if (byte_bit || length % 8)
 			return CB_ERR_ARG;
 
 		for (i = 0; length; i++, length -= 8, byte++) {
-			cmos_write(ret[i], byte);
-			if (byte >= LB_CKS_RANGE_START &&
-			    byte <= LB_CKS_RANGE_END)
+			cmos_option_write(ret[i], byte);
+			if (cmos_in_cks_range(byte))
 				chksum_update_needed = 1;
 		}
 	}
 
-	if (chksum_update_needed) {
-		cmos_set_checksum(LB_CKS_RANGE_START, LB_CKS_RANGE_END,
-				  LB_CKS_LOC);
-	}
+	if (chksum_update_needed)
+		cmos_options_set_checksum();
 	return CB_SUCCESS;
 }
 
@@ -181,6 +265,8 @@ static enum cb_err cmos_set_uint_option(const char *name, unsigned int *value)
 		return CB_ERR_ARG;
 	}
 
+	cmos_snapshot_load();
+
 	if (set_cmos_value(ce->bit, ce->length, value) != CB_SUCCESS)
 		return CB_CMOS_ACCESS_ERROR;
 
@@ -194,7 +280,7 @@ enum cb_err set_uint_option(const char *name, unsigned int value)
 
 int cmos_lb_cks_valid(void)
 {
-	return cmos_checksum_valid(LB_CKS_RANGE_START, LB_CKS_RANGE_END, LB_CKS_LOC);
+	return cmos_options_cks_valid();
 }
 
 void sanitize_cmos(void)
@@ -220,5 +306,8 @@ void sanitize_cmos(void)
 		cmos_write_inner(cmos_default[LB_CKS_LOC], LB_CKS_LOC);
 		cmos_write_inner(cmos_default[LB_CKS_LOC + 1], LB_CKS_LOC + 1);
 		cmos_restore_rtc(control_state);
+
+		/* Re-read the new contents on next access. */
+		cmos_snapshot.loaded = false;
 	}
 }
@@ -10,6 +10,7 @@
  * Infineon slb9635), so this driver provides access to locality 0 only.
  */
 
+#include <commonlib/endian.h>
 #include <commonlib/helpers.h>
 #include <string.h>
 #include <delay.h>
@@ -77,6 +78,9 @@
 #define TIS_ACCESS_REQUEST_USE         (1 << 1) /* 0x02 */
 #define TIS_ACCESS_TPM_ESTABLISHMENT   (1 << 0) /* 0x01 */
 
+#define TIS_INTF_CAP_TRANSFER_SIZE(cap)	(((cap) >> 9) & 0x3)
+#define TIS_INTF_CAP_TRANSFER_LEGACY	0 /* byte accesses only */
+
  /* 1 second is plenty for anything TPM does.*/
 #define MAX_DELAY_US	USECS_PER_SEC
 
@@ -141,6 +145,12 @@ static const struct vendor_name vendor_names[] = {
  */
 static u32 vendor_dev_id;
 
+/*
+ * TIS 1.3 and PTP FIFO interfaces which report a data transfer size other
+ * than legacy accept 32-bit accesses to the data FIFO.
+ */
+static bool fifo_dword_access;
+
 static inline u8 tpm_read_status(int locality)
 {
 	u8 value = read8(TIS_REG(locality, TIS_REG_STS));
@@ -167,11 +177,33 @@ static inline void tpm_write_data(u8 data, int locality)
 	write8(TIS_REG(locality, TIS_REG_DATA_FIFO), data);
 }
 
+static inline u32 tpm_read_data32(int locality)
+{
+	u32 value = read32(TIS_REG(locality, TIS_REG_DATA_FIFO));
+	TPM_DEBUG_IO_READ(TIS_REG_DATA_FIFO, value);
+	return value;
+}
+
+static inline void tpm_write_data32(u32 data, int locality)
+{
+	TPM_DEBUG_IO_WRITE(TIS_REG_DATA_FIFO, data);
+	write32(TIS_REG(locality, TIS_REG_DATA_FIFO), data);
+}
+
+/*
+ * The burst count occupies bytes 1 and 2 of the status register. Every access
+ * is a full bus cycle on LPC/eSPI, so fetch it in one go: a 16-bit read of the
+ * field itself, or an aligned read of the whole register where the interface
+ * takes dword accesses. Legacy LPC TPMs split wider accesses into byte cycles.
+ */
 static inline u16 tpm_read_burst_count(int locality)
 {
 	u16 count;
-	count = read8(TIS_REG(locality, TIS_REG_BURST_COUNT));
-	count |= read8(TIS_REG(locality, TIS_REG_BURST_COUNT + 1)) << 8;
+
+	if (fifo_dword_access)
+		count = read32(TIS_REG(locality, TIS_REG_STS)) >> 8;
+	else
+		count = read16(TIS_REG(locality, TIS_REG_BURST_COUNT));
 	TPM_DEBUG_IO_READ(TIS_REG_BURST_COUNT, count);
 	return count;
 }
@@ -240,6 +272,31 @@ static inline u32 tpm_read_int_polarity(int locality)
 	return value;
 }
 
+/*
+ * Move count bytes through the data FIFO, using 32-bit accesses when the
+ * interface supports them. The FIFO is byte ordered, so the lowest address
+ * of a wide access carries the first byte.
+ */
+static void tis_write_fifo(const u8 *data, size_t count, int locality)
+{
+	if (fifo_dword_access) {
+		for (; count >= sizeof(u32); count -= sizeof(u32), data += sizeof(u32))
+			tpm_write_data32(read_le32(data), locality);
+	}
+	while (count--)
+		tpm_write_data(*data++, locality);
+}
+
+static void tis_read_fifo(u8 *buffer, size_t count, int locality)
+{
+	if (fifo_dword_access) {
+		for (; count >= sizeof(u32); count -= sizeof(u32), buffer += sizeof(u32))
+			write_le32(buffer, tpm_read_data32(locality));
+	}
+	while (count--)
+		*buffer++ = tpm_read_data(locality);
+}
+
 /*
  * tis_wait_sts()
  *
@@ -434,6 +491,9 @@ static tpm_result_t pc80_tpm_probe(enum tpm_family *family)
 		return TPM_CB_PROBE_FAILURE;
 	}
 
+	fifo_dword_access = TIS_INTF_CAP_TRANSFER_SIZE(tpm_read_intf_cap(locality)) !=
+			    TIS_INTF_CAP_TRANSFER_LEGACY;
+
 	vendor_dev_id = didvid;
 
 	vid = didvid & 0xffff;
@@ -525,8 +585,8 @@ static tpm_result_t tis_senddata(const u8 *const data, u32 len)
 		 * FIFO.
 		 */
 		count = MIN(burst, len - offset - 1);
-		while (count--)
-			tpm_write_data(data[offset++], locality);
+		tis_write_fifo(data + offset, count, locality);
+		offset += count;
 
 		rc = tis_wait_valid(locality);
 		if (rc || !tis_expect_data(locality)) {
@@ -579,6 +639,7 @@ static tpm_result_t tis_senddata(const u8 *const data, u32 len)
  */
 static tpm_result_t tis_readresponse(u8 *buffer, size_t *len)
 {
+	const u32 header_size = 6;
 	u16 burst_count;
 	u32 offset = 0;
 	u8 locality = 0;
@@ -606,9 +667,20 @@ static tpm_result_t tis_readresponse(u8 *buffer, size_t *len)
 
 		max_cycles = 0;
 
-		while (burst_count-- && (offset < expected_count)) {
-			buffer[offset++] = tpm_read_data(locality);
-			if (offset == 6) {
+		while (burst_count && (offset < expected_count)) {
+			/*
+			 * Don't read past the header before the total size of
+			 * the reply is known.
+			 */
+			u32 limit = offset < header_size ?
+				    MIN(header_size, expected_count) : expected_count;
+			u32 count = MIN(burst_count, limit - offset);
+
+			tis_read_fifo(buffer + offset, count, locality);
+			offset += count;
+			burst_count -= count;
+
+			if (offset == header_size) {
 				/*
 				 * We got the first six bytes of the reply,
 				 * let's figure out how many bytes to expect
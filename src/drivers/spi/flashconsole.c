@@ -7,32 +7,77 @@
 #include <console/flash.h>
 #include <types.h>
 
-#define LINE_BUFFER_SIZE 128
 #define READ_BUFFER_SIZE 0x100
 
+/*
+ * Output is collected up to the end of the current flash page, so every
+ * write is a single page program. FMAP areas are at least page aligned.
+ */
+#define FLASH_PAGE_SIZE 0x100
+
 static const struct region_device *rdev_ptr;
 static struct region_device rdev;
-static uint8_t line_buffer[LINE_BUFFER_SIZE];
+static uint8_t line_buffer[FLASH_PAGE_SIZE];
 static size_t offset;
 static size_t line_offset;
 
-void flashconsole_init(void)
+/*
+ * Return the offset of the first erased byte, which is where the previous
+ * stages stopped writing. Log text never contains 0xff, so the region is
+ * the log followed by erased flash, and a binary search over the first
+ * byte of each chunk finds the chunk the log ends in.
+ */
+static ssize_t flashconsole_find_end(const struct region_device *rd)
 {
 	uint8_t buffer[READ_BUFFER_SIZE];
-	size_t size;
-	size_t initial_offset = 0;
-	size_t len = READ_BUFFER_SIZE;
-	size_t i;
+	size_t size = region_device_sz(rd);
+	size_t low = 0;
+	size_t high = DIV_ROUND_UP(size, READ_BUFFER_SIZE);
+	size_t start, len, i;
+	uint8_t c;
+
+	/* Find the first chunk starting with an erased byte */
+	while (low < high) {
+		size_t mid = low + (high - low) / 2;
+
+		if (rdev_readat(rd, &c, mid * READ_BUFFER_SIZE, 1) != 1)
+			return -1;
+		if (c == 0xff)
+			high = mid;
+		else
+			low = mid + 1;
+	}
+
+	if (low == 0)
+		return 0;
+
+	/* The log ends somewhere in the chunk before */
+	start = (low - 1) * READ_BUFFER_SIZE;
+	len = MIN(READ_BUFFER_SIZE, size - start);
+	if (rdev_readat(rd, buffer, start, len) != len)
+		return -1;
+	for (i = 0; i < len; i++) {
+		if (buffer[i] == 0xff)
+			break;
+	}
+	return start + i;
+}
+
+void flashconsole_init(void)
+{
+	ssize_t initial_offset;
+
+	rdev_ptr = NULL;
+	line_offset = 0;
 
 	if (fmap_locate_area_as_rdev_rw("CONSOLE", &rdev)) {
 		printk(BIOS_INFO, "Can't find 'CONSOLE' area in FMAP\n");
 		return;
 	}
-	size = region_device_sz(&rdev);
 
 	/*
-	 * We need to check the region until we find a 0xff indicating
-	 * the end of a previous log write.
+	 * We need to find the 0xff indicating the end of a previous
+	 * log write.
 	 * We can't erase the region because one stage would erase the
 	 * data from the previous stage. Also, it looks like doing an
 	 * erase could completely freeze the SPI controller and then
@@ -40,25 +85,12 @@ void flashconsole_init(void)
 	 * the sector is already erased, so we would need to read
 	 * anyways to check if it's all 0xff).
 	 */
-	for (i = 0; i < len && initial_offset < size;) {
-		// Fill the buffer on first iteration
-		if (i == 0) {
-			len = MIN(READ_BUFFER_SIZE, size - offset);
-			if (rdev_readat(&rdev, buffer, initial_offset, len) != len)
-				return;
-		}
-		if (buffer[i] == 0xff) {
-			initial_offset += i;
-			break;
-		}
-		// If we're done, repeat the process for the next sector
-		if (++i == READ_BUFFER_SIZE) {
-			initial_offset += len;
-			i = 0;
-		}
-	}
+	initial_offset = flashconsole_find_end(&rdev);
+	if (initial_offset < 0)
+		return;
+
 	// Make sure there is still space left on the console
-	if (initial_offset >= size) {
+	if ((size_t)initial_offset >= region_device_sz(&rdev)) {
 		printk(BIOS_INFO, "No space left on 'console' region in SPI flash\n");
 		return;
 	}
@@ -74,11 +106,12 @@ void flashconsole_tx_byte(unsigned char c)
 
 	size_t region_size = region_device_sz(rdev_ptr);
 
-	if (line_offset < LINE_BUFFER_SIZE)
+	if (line_offset < FLASH_PAGE_SIZE)
 		line_buffer[line_offset++] = c;
 
-	if (line_offset >= LINE_BUFFER_SIZE ||
-	    offset + line_offset >= region_size || c == '\n') {
+	/* Lines are flushed by console_tx_flush() at the end of each printk */
+	if (!((offset + line_offset) % FLASH_PAGE_SIZE) ||
+	    offset + line_offset >= region_size) {
 		flashconsole_tx_flush();
 	}
 }
@@ -95,7 +128,7 @@ void flashconsole_tx_flush(void)
 	if (busy)
 		return;
 
-	if (!rdev_ptr)
+	if (!rdev_ptr || !len)
 		return;
 
 	busy = 1;
@@ -106,12 +139,12 @@ void flashconsole_tx_flush(void)
 	if (rdev_writeat(&rdev, line_buffer, offset, len) != len)
 		return;
 
-	// If the region is full, stop future write attempts
-	if (offset + len >= region_size)
-		return;
-
 	offset += len;
 	line_offset = 0;
 
+	// If the region is full, stop future write attempts
+	if (offset >= region_size)
+		rdev_ptr = NULL;
+
 	busy = 0;
 }
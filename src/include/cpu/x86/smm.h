@@ -71,6 +71,24 @@ int  mainboard_set_smm_log_level(void);
 void smm_soc_early_init(void);
 void smm_soc_exit(void);
 
+/*
+ * Called by every CPU on SMI entry, before the handler lock is taken.
+ * Returns true if an I/O write to APM_CNT by this CPU caused the SMI.
+ */
+bool smm_cpu_is_apmc_originator(int cpu);
+/* Record `cpu` as APMC originator of this SMI if it is one. */
+void smm_apmc_check_originator(int cpu);
+/* Forget the originator, the handler is done with this SMI. */
+void smm_apmc_clear_originator(void);
+/* CPU that reported itself as APMC originator for this SMI, or -1. */
+int smm_apmc_originator(void);
+/*
+ * Returns the save state of the CPU that wrote `cmd` to APM_CNT, or NULL.
+ * The recorded originator is tried first. All save states are searched if
+ * it didn't report in (yet) or wrote another command.
+ */
+void *smm_find_apmc_save_state(u8 cmd, bool (*is_apmc_cmd)(void *state, u8 cmd));
+
 /* SMM handler binary symbols (linked in by the build). */
 extern unsigned char _binary_smm_start[];
 extern unsigned char _binary_smm_end[];
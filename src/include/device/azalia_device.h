@@ -12,6 +12,27 @@
 #define HDA_GCTL_REG		0x08
 #define   HDA_GCTL_CRST		(1 << 0)
 #define HDA_STATESTS_REG	0x0e
+#define HDA_CORBLBASE_REG	0x40
+#define HDA_CORBUBASE_REG	0x44
+#define HDA_CORBWP_REG		0x48
+#define HDA_CORBRP_REG		0x4a
+#define   HDA_CORBRP_RST	(1 << 15)
+#define HDA_CORBCTL_REG		0x4c
+#define   HDA_CORBCTL_RUN	(1 << 1)
+#define HDA_CORBSIZE_REG	0x4e
+#define HDA_RIRBLBASE_REG	0x50
+#define HDA_RIRBUBASE_REG	0x54
+#define HDA_RIRBWP_REG		0x58
+#define   HDA_RIRBWP_RST	(1 << 15)
+#define HDA_RINTCNT_REG		0x5a
+#define HDA_RIRBCTL_REG		0x5c
+#define   HDA_RIRBCTL_DMAEN	(1 << 1)
+#define HDA_RIRBSTS_REG		0x5d
+#define HDA_RIRBSIZE_REG	0x5e
+#define   HDA_RING_SIZE_2	0
+#define   HDA_RING_SIZE_16	1
+#define   HDA_RING_SIZE_256	2
+#define   HDA_RING_SIZE_CAP(size)	(1 << ((size) + 4))
 #define HDA_IC_REG		0x60
 #define HDA_IR_REG		0x64
 #define HDA_ICII_REG		0x68
@@ -22,6 +22,7 @@ struct spi_bus_operations;
 struct usb_bus_operations;
 struct gpio_operations;
 struct mdio_bus_operations;
+struct pci_config_shadow;
 
 /* Chip operations */
 struct chip_operations {
@@ -139,6 +140,10 @@ struct device {
 	 * device ID.
 	 */
 	struct rom_header *pci_vga_option_rom;
+#if CONFIG(PCI_CONFIG_SHADOW)
+	/* Cached capability lists, allocated on first lookup (pci_ops.c) */
+	struct pci_config_shadow *pci_shadow;
+#endif
 #if CONFIG(GENERATE_SMBIOS_TABLES)
 	u8 smbios_slot_type;
 	u8 smbios_slot_data_width;
@@ -182,6 +187,7 @@ void dev_enumerate(void);
 void dev_configure(void);
 void dev_enable(void);
 void dev_initialize(void);
+void dev_ensure_initialized(struct device *dev);
 void dev_finalize(void);
 void dev_finalize_chips(void);
 /* Function used to override device state */
@@ -235,6 +241,18 @@ struct device *dev_find_lapic(unsigned int apic_id);
 int dev_count_cpu(void);
 struct device *add_cpu_device(struct bus *cpu_bus, unsigned int apic_id,
 				int enabled);
+
+/* Enabled CPUs sorted by thread ID first and APIC ID second, the order ACPI lists them in. */
+struct cpu_topology {
+	size_t num_cpus;
+	struct device **cpus;
+};
+
+/*
+ * Returns the CPU topology, built with a single walk over the devicetree the first time it
+ * is called. Must only be called once the set of CPUs is final, i.e. after MP init.
+ */
+const struct cpu_topology *cpu_topology_snapshot(void);
 void mp_init_cpus(DEVTREE_CONST struct bus *cpu_bus);
 static inline void mp_cpu_bus_init(struct device *dev)
 {
@@ -2,9 +2,15 @@
 #ifndef FW_CFG_H
 #define FW_CFG_H
 #include "fw_cfg_if.h"
+#include <stddef.h>
 
 void fw_cfg_get(uint16_t entry, void *dst, int dstlen);
 int fw_cfg_check_file(FWCfgFile *file, const char *name);
+/*
+ * Read up to dstlen bytes of the named file into dst. Returns the size of
+ * the file, which may be larger than dstlen, or -1 if it doesn't exist.
+ */
+int fw_cfg_read_file(const char *name, void *dst, size_t dstlen);
 int fw_cfg_max_cpus(void);
 unsigned long fw_cfg_smbios_tables(int *handle, unsigned long *current);
 uintptr_t fw_cfg_tolud(void);
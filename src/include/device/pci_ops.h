@@ -23,6 +23,36 @@ static __always_inline pci_devfn_t pcidev_assert(const struct device *dev)
 	return pcidev_bdf(dev);
 }
 
+/*
+ * With PCI_CONFIG_SHADOW, ramstage keeps the capability lists of each device
+ * in memory. Writes through the accessors below that hit the capability
+ * pointer or a cached capability header drop the lists of that device. Other
+ * ways of changing them have to call pci_shadow_invalidate().
+ */
+u16 pci_s_find_next_capability(pci_devfn_t dev, u16 cap, u16 last);
+u16 pci_s_find_capability(pci_devfn_t dev, u16 cap);
+
+#if CONFIG(PCI_CONFIG_SHADOW) && ENV_RAMSTAGE
+u16 pci_shadow_find_next_capability(const struct device *dev, u16 cap, u16 last);
+void pci_shadow_write(const struct device *dev, u16 reg, size_t size);
+void pci_shadow_invalidate(const struct device *dev);
+/* Returns -1 if the lookup has to be answered by the device. */
+int pci_shadow_find_ext_cap(const struct device *dev, unsigned int cap, unsigned int offset);
+#else
+static inline u16 pci_shadow_find_next_capability(const struct device *dev, u16 cap,
+						  u16 last)
+{
+	return pci_s_find_next_capability(PCI_BDF(dev), cap, last);
+}
+static inline void pci_shadow_write(const struct device *dev, u16 reg, size_t size) {}
+static inline void pci_shadow_invalidate(const struct device *dev) {}
+static inline int pci_shadow_find_ext_cap(const struct device *dev, unsigned int cap,
+					  unsigned int offset)
+{
+	return -1;
+}
+#endif
+
 #if defined(__SIMPLE_DEVICE__)
 #define ENV_PCI_SIMPLE_DEVICE 1
 #else
@@ -65,18 +95,21 @@ static __always_inline
 void pci_write_config8(const struct device *dev, u16 reg, u8 val)
 {
 	pci_s_write_config8(PCI_BDF(dev), reg, val);
+	pci_shadow_write(dev, reg, sizeof(val));
 }
 
 static __always_inline
 void pci_write_config16(const struct device *dev, u16 reg, u16 val)
 {
 	pci_s_write_config16(PCI_BDF(dev), reg, val);
+	pci_shadow_write(dev, reg, sizeof(val));
 }
 
 static __always_inline
 void pci_write_config32(const struct device *dev, u16 reg, u32 val)
 {
 	pci_s_write_config32(PCI_BDF(dev), reg, val);
+	pci_shadow_write(dev, reg, sizeof(val));
 }
 
 #endif
@@ -195,19 +228,18 @@ void pci_or_config32(const struct device *dev, u16 reg, u32 ormask)
 	pci_update_config32(dev, reg, 0xffffffff, ormask);
 }
 
-u16 pci_s_find_next_capability(pci_devfn_t dev, u16 cap, u16 last);
-u16 pci_s_find_capability(pci_devfn_t dev, u16 cap);
-
 static __always_inline
 u16 pci_find_next_capability(const struct device *dev, u16 cap, u16 last)
 {
+	if (CONFIG(PCI_CONFIG_SHADOW) && ENV_RAMSTAGE)
+		return pci_shadow_find_next_capability(dev, cap, last);
 	return pci_s_find_next_capability(PCI_BDF(dev), cap, last);
 }
 
 static __always_inline
 u16 pci_find_capability(const struct device *dev, u16 cap)
 {
-	return pci_s_find_capability(PCI_BDF(dev), cap);
+	return pci_find_next_capability(dev, cap, 0);
 }
 
 /*
@@ -144,7 +144,13 @@ static inline void cmos_restore_rtc(u8 control_state)
 		cmos_write_inner(control_state, RTC_CONTROL);
 }
 
-static inline void cmos_write(unsigned char val, unsigned char addr)
+#if CONFIG(USE_OPTION_TABLE)
+void cmos_options_invalidate(unsigned char addr);
+#else
+static inline void cmos_options_invalidate(unsigned char addr) {}
+#endif
+
+static inline void __cmos_write(unsigned char val, unsigned char addr)
 {
 	u8 control_state;
 
@@ -160,6 +166,13 @@ static inline void cmos_write(unsigned char val, unsigned char addr)
 		cmos_restore_rtc(control_state);
 }
 
+static inline void cmos_write(unsigned char val, unsigned char addr)
+{
+	__cmos_write(val, addr);
+	/* The option code caches the checksummed range */
+	cmos_options_invalidate(addr);
+}
+
 static inline u32 cmos_read32(u8 offset)
 {
 	u32 value = 0;
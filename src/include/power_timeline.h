@@ -0,0 +1,55 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+
+#ifndef __POWER_TIMELINE_H__
+#define __POWER_TIMELINE_H__
+
+#include <delay.h>
+#include <stdint.h>
+#include <timer.h>
+
+/*
+ * The power timeline remembers when a supply or control line last changed, so
+ * that drivers only wait for the part of a datasheet delay that hasn't already
+ * passed. Events recorded in romstage are carried over to ramstage in CBMEM,
+ * which requires the monotonic timer to keep counting across stages. Events
+ * recorded before CBMEM comes up in romstage are kept as well, events from
+ * earlier stages are not.
+ */
+enum power_timeline_event {
+	POWER_TIMELINE_BRIDGE_RESET,	/* Display bridge reset deasserted */
+	POWER_TIMELINE_NUM_EVENTS,
+};
+
+#if CONFIG(POWER_TIMELINE)
+/* Record that `event` happened just now. */
+void power_timeline_record(enum power_timeline_event event);
+
+/*
+ * Return the time in microseconds since `event` was last recorded, or -1 if it
+ * hasn't been recorded (or the record can't be trusted).
+ */
+int64_t power_timeline_elapsed_usecs(enum power_timeline_event event);
+
+/*
+ * Wait until at least `usecs` have passed since `event`. Waits for the full time
+ * if the event has not been recorded or the record is stale.
+ */
+void power_timeline_wait_usecs(enum power_timeline_event event, uint64_t usecs);
+#else
+static inline void power_timeline_record(enum power_timeline_event event) {}
+static inline int64_t power_timeline_elapsed_usecs(enum power_timeline_event event)
+{
+	return -1;
+}
+static inline void power_timeline_wait_usecs(enum power_timeline_event event, uint64_t usecs)
+{
+	udelay(usecs);
+}
+#endif
+
+static inline void power_timeline_wait_msecs(enum power_timeline_event event, uint64_t msecs)
+{
+	power_timeline_wait_usecs(event, msecs * USECS_PER_MSEC);
+}
+
+#endif /* __POWER_TIMELINE_H__ */
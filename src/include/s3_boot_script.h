@@ -0,0 +1,157 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+
+#ifndef _S3_BOOT_SCRIPT_H_
+#define _S3_BOOT_SCRIPT_H_
+
+#include <stdint.h>
+#include <types.h>
+
+#if ENV_X86 || ENV_TEST
+#include <arch/io.h>
+#include <device/mmio.h>
+#include <device/pci_ops.h>
+#include <timer.h>
+#endif
+
+/*
+ * The S3 boot script is a journal of register writes (and the conditions
+ * that have to be polled in between) that ramstage performs from device
+ * enumeration onwards. It is recorded into CBMEM during a normal boot. On
+ * S3 resume, ramstage replays it right after chip initialization and jumps
+ * to the OS waking vector, skipping enumeration, resource allocation and
+ * device initialization. If the journal is missing or invalid, resume
+ * falls back to the regular ramstage flow.
+ *
+ * Unlike reg_script tables, journal entries are self-contained (PCI devices
+ * are stored as BDF, addresses as 64-bit values), so that they can be
+ * validated and replayed without any ramstage device tree state.
+ *
+ * Drivers opt in by using the s3_script_*() accessors below instead of the
+ * plain ones. They always perform the access; recording only happens when
+ * CONFIG(S3_BOOT_SCRIPT) is enabled and ramstage is in a recording window.
+ */
+
+#define S3_SCRIPT_MAGIC		0x53335343	/* 'S3SC' */
+#define S3_SCRIPT_VERSION	1
+
+enum s3_script_op {
+	S3_SCRIPT_IO_WRITE = 1,
+	S3_SCRIPT_MEM_WRITE = 2,
+	S3_SCRIPT_PCI_WRITE = 3,
+	S3_SCRIPT_MEM_POLL = 4,
+};
+
+struct s3_script_entry {
+	uint8_t op;		/* enum s3_script_op */
+	uint8_t width;		/* access width in bytes: 1, 2 or 4 */
+	uint16_t reserved;
+	uint32_t value;
+	uint64_t addr;		/* I/O port, physical address or BDF | reg */
+	uint32_t mask;		/* polls only */
+	uint32_t timeout_us;	/* polls only */
+} __packed;
+
+struct s3_script_header {
+	uint32_t magic;
+	uint16_t version;
+	uint16_t entry_size;
+	uint32_t count;
+	uint32_t checksum;	/* ipchksum() over the entries */
+	struct s3_script_entry entries[];
+} __packed;
+
+#if CONFIG(S3_BOOT_SCRIPT) && ENV_RAMSTAGE
+void s3_script_record(enum s3_script_op op, uint8_t width, uint64_t addr,
+		      uint32_t value, uint32_t mask, uint32_t timeout_us);
+/*
+ * Called after chip initialization. On S3 resume, replays the journal and
+ * returns the OS waking vector. Returns NULL if the regular ramstage flow
+ * has to continue, either because this is a normal boot (recording starts)
+ * or because the journal could not be replayed.
+ */
+void *s3_script_resume(void);
+/*
+ * Store the journal in CBMEM at the end of the recording window. Nothing is
+ * stored if no entries were recorded or the journal overflowed.
+ */
+void s3_script_commit(void);
+/* Replay a journal after validating it. Exposed for tests. */
+enum cb_err s3_script_replay(const struct s3_script_header *script, size_t size);
+#else
+static inline void s3_script_record(enum s3_script_op op, uint8_t width,
+				    uint64_t addr, uint32_t value,
+				    uint32_t mask, uint32_t timeout_us) {}
+static inline void *s3_script_resume(void) { return NULL; }
+static inline void s3_script_commit(void) {}
+#endif
+
+#if ENV_X86 || ENV_TEST
+static inline void s3_script_outb(uint8_t value, uint16_t port)
+{
+	outb(value, port);
+	s3_script_record(S3_SCRIPT_IO_WRITE, sizeof(value), port, value, 0, 0);
+}
+
+static inline void s3_script_outw(uint16_t value, uint16_t port)
+{
+	outw(value, port);
+	s3_script_record(S3_SCRIPT_IO_WRITE, sizeof(value), port, value, 0, 0);
+}
+
+static inline void s3_script_outl(uint32_t value, uint16_t port)
+{
+	outl(value, port);
+	s3_script_record(S3_SCRIPT_IO_WRITE, sizeof(value), port, value, 0, 0);
+}
+
+static inline void s3_script_write8(uintptr_t addr, uint8_t value)
+{
+	write8p(addr, value);
+	s3_script_record(S3_SCRIPT_MEM_WRITE, sizeof(value), addr, value, 0, 0);
+}
+
+static inline void s3_script_write16(uintptr_t addr, uint16_t value)
+{
+	write16p(addr, value);
+	s3_script_record(S3_SCRIPT_MEM_WRITE, sizeof(value), addr, value, 0, 0);
+}
+
+static inline void s3_script_write32(uintptr_t addr, uint32_t value)
+{
+	write32p(addr, value);
+	s3_script_record(S3_SCRIPT_MEM_WRITE, sizeof(value), addr, value, 0, 0);
+}
+
+static inline void s3_script_pci_write8(pci_devfn_t dev, uint16_t reg, uint8_t value)
+{
+	pci_s_write_config8(dev, reg, value);
+	s3_script_record(S3_SCRIPT_PCI_WRITE, sizeof(value), dev | reg, value, 0, 0);
+}
+
+static inline void s3_script_pci_write16(pci_devfn_t dev, uint16_t reg, uint16_t value)
+{
+	pci_s_write_config16(dev, reg, value);
+	s3_script_record(S3_SCRIPT_PCI_WRITE, sizeof(value), dev | reg, value, 0, 0);
+}
+
+static inline void s3_script_pci_write32(pci_devfn_t dev, uint16_t reg, uint32_t value)
+{
+	pci_s_write_config32(dev, reg, value);
+	s3_script_record(S3_SCRIPT_PCI_WRITE, sizeof(value), dev | reg, value, 0, 0);
+}
+
+/*
+ * Wait until (read32(addr) & mask) == value, for at most timeout_us, and
+ * record the same condition for replay. Returns 0 on success, -1 on timeout.
+ */
+static inline int s3_script_poll32(uintptr_t addr, uint32_t mask, uint32_t value,
+				   uint32_t timeout_us)
+{
+	s3_script_record(S3_SCRIPT_MEM_POLL, sizeof(value), addr, value, mask, timeout_us);
+	if (!wait_us(timeout_us, (read32p(addr) & mask) == value))
+		return -1;
+	return 0;
+}
+#endif
+
+#endif /* _S3_BOOT_SCRIPT_H_ */
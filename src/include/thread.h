@@ -37,6 +37,9 @@ int thread_run_until(struct thread_handle *handle, enum cb_err (*func)(void *),
 /* Waits until the thread has terminated and returns the error code */
 enum cb_err thread_join(struct thread_handle *handle);
 
+/* Returns true if called from the thread started with the given handle */
+bool thread_is_current(const struct thread_handle *handle);
+
 #if ENV_SUPPORTS_COOP
 
 struct thread {
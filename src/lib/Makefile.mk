@@ -171,6 +171,11 @@ romstage-$(CONFIG_ROMSTAGE_VGA) += vga_gfx.c
 romstage-$(CONFIG_TIMER_QUEUE) += timer_queue.c
 ramstage-$(CONFIG_TIMER_QUEUE) += timer_queue.c
 
+bootblock-$(CONFIG_POWER_TIMELINE) += power_timeline.c
+verstage-$(CONFIG_POWER_TIMELINE) += power_timeline.c
+romstage-$(CONFIG_POWER_TIMELINE) += power_timeline.c
+ramstage-$(CONFIG_POWER_TIMELINE) += power_timeline.c
+
 romstage-$(CONFIG_COOP_MULTITASKING) += thread.c
 ramstage-$(CONFIG_COOP_MULTITASKING) += thread.c
 
@@ -219,6 +224,8 @@ ramstage-$(CONFIG_CBMEM_STAGE_CACHE) += cbmem_stage_cache.c
 romstage-$(CONFIG_CBMEM_STAGE_CACHE) += cbmem_stage_cache.c
 postcar-$(CONFIG_CBMEM_STAGE_CACHE) += cbmem_stage_cache.c
 
+ramstage-$(CONFIG_S3_BOOT_SCRIPT) += s3_boot_script.c
+
 romstage-y += boot_device.c
 ramstage-y += boot_device.c
 
@@ -333,11 +340,15 @@ endef
 
 endif
 
+ifeq ($(CONFIG_RMODULE_COMPACT_RELOCATIONS),y)
+RMODTOOL_FLAGS += --compact-relocs
+endif
+
 $(objcbfs)/%.debug.rmod: $(objcbfs)/%.debug | $(RMODTOOL)
-	$(RMODTOOL) -i $< -o $@
+	$(RMODTOOL) $(RMODTOOL_FLAGS) -i $< -o $@
 
 $(obj)/%.elf.rmod: $(obj)/%.elf | $(RMODTOOL)
-	$(RMODTOOL) -i $< -o $@
+	$(RMODTOOL) $(RMODTOOL_FLAGS) -i $< -o $@
 
 romstage-$(CONFIG_ROMSTAGE_ADA) += cb.ads
 ramstage-$(CONFIG_RAMSTAGE_ADA) += cb.ads
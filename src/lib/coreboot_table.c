@@ -3,6 +3,7 @@
 #include <acpi/acpi.h>
 #include <arch/cbconfig.h>
 #include <commonlib/bsd/ipchksum.h>
+#include <commonlib/sd_mmc_ctrlr.h>
 #include <console/console.h>
 #include <console/uart.h>
 #include <identity.h>
@@ -254,6 +255,25 @@ static void lb_mmc_info(struct lb_header *header)
 	rec->early_cmd1_status = *ms_cbmem;
 }
 
+static void lb_mmc_tuning(struct lb_header *header)
+{
+	struct lb_mmc_tuning *rec;
+	struct mmc_tuning_record saved;
+
+	if (mmc_tuning_record_load(&saved) || !mmc_tuning_record_valid(&saved))
+		return;
+
+	rec = (struct lb_mmc_tuning *)lb_new_record(header);
+
+	rec->tag = LB_TAG_MMC_TUNING;
+	rec->size = sizeof(*rec);
+	rec->ctrlr_id = saved.ctrlr_id;
+	memcpy(rec->cid, saved.cid, sizeof(rec->cid));
+	rec->timing = saved.timing;
+	rec->bus_width = saved.bus_width;
+	rec->tuning = saved.tuning;
+}
+
 static void add_cbmem_pointers(struct lb_header *header)
 {
 	/*
@@ -551,6 +571,10 @@ static uintptr_t write_coreboot_table(uintptr_t rom_table_end)
 	/* Pass mmc early init status */
 	lb_mmc_info(head);
 
+	/* Pass the eMMC bus tuning saved by a previous boot */
+	if (CONFIG(SD_MMC_TUNING_CACHE))
+		lb_mmc_tuning(head);
+
 	/* Add SPI flash description if available */
 	if (CONFIG(BOOT_DEVICE_SPI_FLASH))
 		lb_spi_flash(head);
@@ -19,6 +19,7 @@
 #include <device/device.h>
 #include <device/pci.h>
 #include <program_loading.h>
+#include <s3_boot_script.h>
 #include <thread.h>
 #include <timer.h>
 #include <timestamp.h>
@@ -98,6 +99,14 @@ static boot_state_t bs_dev_init_chips(void *arg)
 	/* Initialize chips early, they might disable unused devices. */
 	dev_initialize_chips();
 
+	if (CONFIG(S3_BOOT_SCRIPT)) {
+		void *wake_vector = s3_script_resume();
+		if (wake_vector != NULL) {
+			boot_states[BS_OS_RESUME].arg = wake_vector;
+			return BS_OS_RESUME;
+		}
+	}
+
 	return BS_DEV_ENUMERATE;
 }
 
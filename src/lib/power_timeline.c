@@ -0,0 +1,117 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+
+#include <cbmem.h>
+#include <console/console.h>
+#include <delay.h>
+#include <power_timeline.h>
+#include <string.h>
+#include <timer.h>
+
+struct power_timeline {
+	uint32_t recorded;	/* Bitmask of recorded events */
+	uint32_t reserved;
+	uint64_t usecs[POWER_TIMELINE_NUM_EVENTS];
+};
+
+/* Events of this stage, until CBMEM is around */
+static struct power_timeline early_timeline;
+
+static struct power_timeline *power_timeline(bool create)
+{
+	struct power_timeline *timeline = NULL;
+
+	if (cbmem_online()) {
+		if (create)
+			timeline = cbmem_add(CBMEM_ID_POWER_TIMELINE, sizeof(*timeline));
+		else
+			timeline = cbmem_find(CBMEM_ID_POWER_TIMELINE);
+	}
+
+	return timeline ? timeline : &early_timeline;
+}
+
+/*
+ * CBMEM may hold events of the previous boot after a resume, so the stage creating
+ * CBMEM always replaces them with its own. The entry is only added once there are
+ * events to keep.
+ */
+static void power_timeline_move_to_cbmem(int is_recovery)
+{
+	struct power_timeline *timeline;
+
+	if (early_timeline.recorded)
+		timeline = cbmem_add(CBMEM_ID_POWER_TIMELINE, sizeof(*timeline));
+	else
+		timeline = cbmem_find(CBMEM_ID_POWER_TIMELINE);
+
+	if (timeline)
+		memcpy(timeline, &early_timeline, sizeof(*timeline));
+}
+CBMEM_CREATION_HOOK(power_timeline_move_to_cbmem);
+
+void power_timeline_record(enum power_timeline_event event)
+{
+	struct power_timeline *timeline;
+	struct mono_time now;
+
+	if (!CONFIG(HAVE_MONOTONIC_TIMER) || event >= POWER_TIMELINE_NUM_EVENTS)
+		return;
+
+	timer_monotonic_get(&now);
+	timeline = power_timeline(true);
+	timeline->usecs[event] = now.microseconds;
+	timeline->recorded |= 1 << event;
+}
+
+static bool power_timeline_get(enum power_timeline_event event, struct mono_time *time)
+{
+	const struct power_timeline *timeline;
+
+	if (!CONFIG(HAVE_MONOTONIC_TIMER) || event >= POWER_TIMELINE_NUM_EVENTS)
+		return false;
+
+	timeline = power_timeline(false);
+	if (!(timeline->recorded & (1 << event)))
+		return false;
+
+	mono_time_set_usecs(time, timeline->usecs[event]);
+	return true;
+}
+
+int64_t power_timeline_elapsed_usecs(enum power_timeline_event event)
+{
+	struct mono_time then, now;
+
+	if (!power_timeline_get(event, &then))
+		return -1;
+
+	timer_monotonic_get(&now);
+	/* Don't trust records from the future, the timer may have been reset. */
+	if (mono_time_before(&now, &then))
+		return -1;
+
+	return mono_time_diff_microseconds(&then, &now);
+}
+
+void power_timeline_wait_usecs(enum power_timeline_event event, uint64_t usecs)
+{
+	struct stopwatch sw;
+	int64_t elapsed;
+
+	if (!CONFIG(HAVE_MONOTONIC_TIMER)) {
+		udelay(usecs);
+		return;
+	}
+
+	/* Unrecorded or stale (negative) events get the full delay */
+	elapsed = power_timeline_elapsed_usecs(event);
+	if (elapsed < 0)
+		elapsed = 0;
+	if ((uint64_t)elapsed >= usecs)
+		return;
+
+	printk(BIOS_SPEW, "Power timeline: waiting %llu of %llu us for event %d\n",
+	       usecs - elapsed, usecs, event);
+	stopwatch_init_usecs_expire(&sw, usecs - elapsed);
+	stopwatch_wait_until_expired(&sw);
+}
@@ -42,7 +42,8 @@ int rmodule_parse(void *ptr, struct rmodule *module)
 	/* Sanity check the raw data. */
 	if (rhdr->magic != RMODULE_MAGIC)
 		return -1;
-	if (rhdr->version != RMODULE_VERSION_1)
+	if (rhdr->version != RMODULE_VERSION_1 &&
+	    rhdr->version != RMODULE_VERSION_2)
 		return -1;
 
 	/* Indicate the module hasn't been loaded yet. */
@@ -101,16 +102,6 @@ static void rmodule_clear_bss(struct rmodule *module)
 	memset(begin, 0, size);
 }
 
-static inline size_t rmodule_number_relocations(const struct rmodule *module)
-{
-	size_t r;
-
-	r = module->header->relocations_end_offset;
-	r -= module->header->relocations_begin_offset;
-	r /= sizeof(uintptr_t);
-	return r;
-}
-
 static void rmodule_copy_payload(const struct rmodule *module)
 {
 	printk(BIOS_DEBUG, "Loading module at %p with entry %p. "
@@ -126,36 +117,66 @@ static void rmodule_copy_payload(const struct rmodule *module)
 	memcpy(module->location, module->payload, module->payload_size);
 }
 
+static inline void rmodule_adjust(const struct rmodule *module,
+				  uintptr_t reloc, uintptr_t adjustment)
+{
+	uintptr_t *adjust_loc;
+
+	adjust_loc = rmodule_load_addr(module, reloc);
+	printk(PK_ADJ_LEVEL, "Adjusting %p: 0x%08lx -> 0x%08lx\n",
+	       adjust_loc, (unsigned long) *adjust_loc,
+	       (unsigned long) (*adjust_loc + adjustment));
+	*adjust_loc += adjustment;
+}
+
 static int rmodule_relocate(const struct rmodule *module)
 {
-	size_t num_relocations;
-	const uintptr_t *reloc;
+	const uint8_t *begin, *end;
+	size_t num_relocations = 0;
 	uintptr_t adjustment;
 
 	/* Each relocation needs to be adjusted relative to the beginning of
 	 * the loaded program. */
 	adjustment = (uintptr_t)rmodule_load_addr(module, 0);
 
-	reloc = module->relocations;
-	num_relocations = rmodule_number_relocations(module);
+	begin = module->relocations;
+	end = begin + module->header->relocations_end_offset -
+	      module->header->relocations_begin_offset;
+
+	if (module->header->version == RMODULE_VERSION_1) {
+		const uintptr_t *reloc;
+
+		for (reloc = module->relocations; reloc < (const uintptr_t *)end; reloc++)
+			rmodule_adjust(module, *reloc, adjustment);
+		num_relocations = reloc - (const uintptr_t *)begin;
+	} else {
+		uintptr_t reloc = 0;
+		uint32_t delta;
+		size_t len;
+
+		while (begin < end) {
+			/* Most relocations are close together. */
+			if (!(*begin & 0x80)) {
+				delta = *begin;
+				len = 1;
+			} else {
+				len = rmodule_reloc_delta_decode(begin, end, &delta);
+				if (!len) {
+					printk(BIOS_ERR, "Corrupt rmodule relocation "
+					       "after 0x%08lx\n", (unsigned long)reloc);
+					return -1;
+				}
+			}
+			begin += len;
+			reloc += delta;
+			rmodule_adjust(module, reloc, adjustment);
+			num_relocations++;
+		}
+	}
 
-	printk(BIOS_DEBUG, "Processing %zu relocs. Offset value of 0x%08lx\n",
+	printk(BIOS_DEBUG, "Processed %zu relocs. Offset value of 0x%08lx\n",
 	       num_relocations, (unsigned long)adjustment);
 
-	while (num_relocations > 0) {
-		uintptr_t *adjust_loc;
-
-		/* If the adjustment location is non-NULL adjust it. */
-		adjust_loc = rmodule_load_addr(module, *reloc);
-		printk(PK_ADJ_LEVEL, "Adjusting %p: 0x%08lx -> 0x%08lx\n",
-		       adjust_loc, (unsigned long) *adjust_loc,
-		       (unsigned long) (*adjust_loc + adjustment));
-		*adjust_loc += adjustment;
-
-		reloc++;
-		num_relocations--;
-	}
-
 	return 0;
 }
 
@@ -0,0 +1,206 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+
+#include <acpi/acpi.h>
+#include <arch/io.h>
+#include <bootstate.h>
+#include <cbmem.h>
+#include <commonlib/bsd/ipchksum.h>
+#include <console/console.h>
+#include <device/mmio.h>
+#include <device/pci_ops.h>
+#include <s3_boot_script.h>
+#include <string.h>
+#include <timer.h>
+#include <timestamp.h>
+
+static struct s3_script_entry journal[CONFIG_S3_BOOT_SCRIPT_ENTRIES];
+static size_t journal_count;
+static bool recording;
+static bool overflowed;
+
+void s3_script_record(enum s3_script_op op, uint8_t width, uint64_t addr,
+		      uint32_t value, uint32_t mask, uint32_t timeout_us)
+{
+	if (!recording)
+		return;
+
+	if (journal_count >= ARRAY_SIZE(journal)) {
+		if (!overflowed)
+			printk(BIOS_ERR, "S3 boot script: journal full, "
+			       "S3 resume will take the full ramstage path.\n");
+		overflowed = true;
+		return;
+	}
+
+	journal[journal_count++] = (struct s3_script_entry) {
+		.op = op,
+		.width = width,
+		.addr = addr,
+		.value = value,
+		.mask = mask,
+		.timeout_us = timeout_us,
+	};
+}
+
+static enum cb_err replay_entry(const struct s3_script_entry *e)
+{
+	switch (e->op) {
+	case S3_SCRIPT_IO_WRITE:
+		switch (e->width) {
+		case 1:
+			outb(e->value, e->addr);
+			return CB_SUCCESS;
+		case 2:
+			outw(e->value, e->addr);
+			return CB_SUCCESS;
+		case 4:
+			outl(e->value, e->addr);
+			return CB_SUCCESS;
+		}
+		break;
+	case S3_SCRIPT_MEM_WRITE:
+		switch (e->width) {
+		case 1:
+			write8p(e->addr, e->value);
+			return CB_SUCCESS;
+		case 2:
+			write16p(e->addr, e->value);
+			return CB_SUCCESS;
+		case 4:
+			write32p(e->addr, e->value);
+			return CB_SUCCESS;
+		}
+		break;
+	case S3_SCRIPT_PCI_WRITE:
+		switch (e->width) {
+		case 1:
+			pci_s_write_config8(e->addr & ~0xfff, e->addr & 0xfff, e->value);
+			return CB_SUCCESS;
+		case 2:
+			pci_s_write_config16(e->addr & ~0xfff, e->addr & 0xfff, e->value);
+			return CB_SUCCESS;
+		case 4:
+			pci_s_write_config32(e->addr & ~0xfff, e->addr & 0xfff, e->value);
+			return CB_SUCCESS;
+		}
+		break;
+	case S3_SCRIPT_MEM_POLL:
+		if (e->width != 4)
+			break;
+		if (!wait_us(e->timeout_us, (read32p(e->addr) & e->mask) == e->value)) {
+			printk(BIOS_ERR, "S3 boot script: timeout polling 0x%llx\n",
+			       (unsigned long long)e->addr);
+			return CB_ERR;
+		}
+		return CB_SUCCESS;
+	}
+
+	printk(BIOS_ERR, "S3 boot script: invalid entry (op %u, width %u)\n",
+	       e->op, e->width);
+	return CB_ERR;
+}
+
+enum cb_err s3_script_replay(const struct s3_script_header *script, size_t size)
+{
+	size_t i;
+
+	/* An empty journal means nothing was recorded, not that there is nothing to do. */
+	if (size < sizeof(*script) || script->magic != S3_SCRIPT_MAGIC ||
+	    script->version != S3_SCRIPT_VERSION ||
+	    script->entry_size != sizeof(struct s3_script_entry) || script->count == 0 ||
+	    script->count > (size - sizeof(*script)) / sizeof(struct s3_script_entry)) {
+		printk(BIOS_ERR, "S3 boot script: invalid header\n");
+		return CB_ERR;
+	}
+
+	if (ipchksum(script->entries, script->count * sizeof(struct s3_script_entry))
+	    != script->checksum) {
+		printk(BIOS_ERR, "S3 boot script: checksum mismatch\n");
+		return CB_ERR;
+	}
+
+	for (i = 0; i < script->count; i++) {
+		if (replay_entry(&script->entries[i]) != CB_SUCCESS)
+			return CB_ERR;
+	}
+
+	return CB_SUCCESS;
+}
+
+void *s3_script_resume(void)
+{
+	const struct cbmem_entry *e;
+	void *wake_vector;
+
+	if (!acpi_is_wakeup_s3()) {
+		journal_count = 0;
+		overflowed = false;
+		recording = true;
+		return NULL;
+	}
+
+	e = cbmem_entry_find(CBMEM_ID_S3_SCRIPT);
+	if (e == NULL) {
+		printk(BIOS_INFO, "S3 boot script: no journal, taking full ramstage path.\n");
+		return NULL;
+	}
+
+	wake_vector = acpi_find_wakeup_vector();
+	if (wake_vector == NULL)
+		return NULL;
+
+	timestamp_add_now(TS_S3_BOOT_SCRIPT_START);
+
+	if (s3_script_replay(cbmem_entry_start(e), cbmem_entry_size(e)) != CB_SUCCESS) {
+		printk(BIOS_ERR, "S3 boot script: replay failed, taking full ramstage path.\n");
+		return NULL;
+	}
+
+	timestamp_add_now(TS_S3_BOOT_SCRIPT_END);
+
+	printk(BIOS_DEBUG, "S3 boot script: replayed %u entries.\n",
+	       ((const struct s3_script_header *)cbmem_entry_start(e))->count);
+
+	return wake_vector;
+}
+
+void s3_script_commit(void)
+{
+	struct s3_script_header *script;
+	const size_t entries_size = journal_count * sizeof(struct s3_script_entry);
+
+	if (!recording)
+		return;
+
+	recording = false;
+
+	/* Without a journal, S3 resume takes the full ramstage path. */
+	if (overflowed)
+		return;
+	if (journal_count == 0) {
+		printk(BIOS_INFO, "S3 boot script: nothing recorded.\n");
+		return;
+	}
+
+	script = cbmem_add(CBMEM_ID_S3_SCRIPT, sizeof(*script) + entries_size);
+	if (script == NULL) {
+		printk(BIOS_ERR, "S3 boot script: could not add journal to CBMEM\n");
+		return;
+	}
+
+	memcpy(script->entries, journal, entries_size);
+	script->magic = S3_SCRIPT_MAGIC;
+	script->version = S3_SCRIPT_VERSION;
+	script->entry_size = sizeof(struct s3_script_entry);
+	script->count = journal_count;
+	script->checksum = ipchksum(script->entries, entries_size);
+
+	printk(BIOS_DEBUG, "S3 boot script: recorded %zu entries.\n", journal_count);
+}
+
+static void s3_script_commit_bs(void *unused)
+{
+	s3_script_commit();
+}
+
+BOOT_STATE_INIT_ENTRY(BS_OS_RESUME_CHECK, BS_ON_ENTRY, s3_script_commit_bs, NULL);
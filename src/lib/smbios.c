@@ -1217,6 +1217,7 @@ static int smbios_walk_device_tree(struct device *tree, int *handle, unsigned lo
 			continue;
 
 		if (dev->ops && dev->ops->get_smbios_data) {
+			dev_ensure_initialized(dev);
 			printk(BIOS_INFO, "%s (%s)\n", dev_path(dev), dev_name(dev));
 			len += dev->ops->get_smbios_data(dev, handle, current);
 		} else {
@@ -405,6 +405,13 @@ enum cb_err thread_join(struct thread_handle *handle)
 	return handle->error;
 }
 
+bool thread_is_current(const struct thread_handle *handle)
+{
+	struct thread *current = current_thread();
+
+	return current && current->handle == handle;
+}
+
 void thread_mutex_lock(struct thread_mutex *mutex)
 {
 	struct stopwatch sw;
@@ -10,19 +10,20 @@
  */
 int get_recovery_mode_switch(void)
 {
-	FWCfgFile f;
+	uint8_t rec_mode;
+	int size;
 
-	if (!fw_cfg_check_file(&f, "opt/cros/recovery")) {
-		uint8_t rec_mode;
-		if (f.size != 1) {
-			printk(BIOS_ERR, "opt/cros/recovery invalid size %d\n", f.size);
-			return 0;
-		}
-		fw_cfg_get(f.select, &rec_mode, f.size);
-		if (rec_mode == '1') {
-			printk(BIOS_INFO, "Recovery is enabled.\n");
-			return 1;
-		}
+	size = fw_cfg_read_file("opt/cros/recovery", &rec_mode, sizeof(rec_mode));
+	if (size < 0)
+		return 0;
+
+	if (size != sizeof(rec_mode)) {
+		printk(BIOS_ERR, "opt/cros/recovery invalid size %d\n", size);
+		return 0;
+	}
+	if (rec_mode == '1') {
+		printk(BIOS_INFO, "Recovery is enabled.\n");
+		return 1;
 	}
 
 	return 0;
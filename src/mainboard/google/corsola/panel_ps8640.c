@@ -5,6 +5,7 @@
 #include <drivers/parade/ps8640/ps8640.h>
 #include <edid.h>
 #include <gpio.h>
+#include <power_timeline.h>
 #include <soc/i2c.h>
 #include <soc/regulator.h>
 
@@ -43,6 +44,7 @@ static void bridge_ps8640_power_on(void)
 	gpio_output(GPIO_EDPBRDG_RST_L, 0);
 	mdelay(55);
 	gpio_output(GPIO_EDPBRDG_RST_L, 1);
+	power_timeline_record(POWER_TIMELINE_BRIDGE_RESET);
 }
 
 static void panel_power_on(void)
@@ -5,6 +5,7 @@
 #include <drivers/parade/ps8640/ps8640.h>
 #include <edid.h>
 #include <gpio.h>
+#include <power_timeline.h>
 #include <soc/i2c.h>
 
 #include "panel.h"
@@ -23,6 +24,7 @@ static void power_on_ps8640(void)
 	gpio_output(GPIO_MIPIBRDG_PWRDN_L_1V8, 1);
 	mdelay(2);
 	gpio_output(GPIO_MIPIBRDG_RST_L_1V8, 1);
+	power_timeline_record(POWER_TIMELINE_BRIDGE_RESET);
 	gpio_output(GPIO_PP3300_LCM_EN, 1);
 }
 
@@ -8,6 +8,7 @@
 #include <drivers/parade/ps8640/ps8640.h>
 #include <edid.h>
 #include <gpio.h>
+#include <power_timeline.h>
 #include <soc/da9212.h>
 #include <soc/ddp.h>
 #include <soc/dsi.h>
@@ -177,6 +178,7 @@ static void configure_display(void)
 		gpio_output(GPIO(UCTS0), 1);
 	gpio_output(GPIO(PCM_CLK), 1); /* PS8640_MODE_CONF */
 	gpio_output(GPIO(URTS0), 1); /* PS8640_SYSRSTN */
+	power_timeline_record(POWER_TIMELINE_BRIDGE_RESET);
 	/* for level shift(1.8V to 3.3V) on */
 	udelay(100);
 }
@@ -8,6 +8,7 @@
 #include <device/i2c_simple.h>
 #include <device/mmio.h>
 #include <mipi/panel.h>
+#include <power_timeline.h>
 #include <drivers/ti/sn65dsi86bridge/sn65dsi86bridge.h>
 #include <drivers/parade/ps8640/ps8640.h>
 #include <edid.h>
@@ -122,6 +123,7 @@ static void power_on_ps8640_bridge(void)
 	mdelay(2);
 
 	gpio_output(GPIO_PS8640_EDP_BRIDGE_RST_L, 1);
+	power_timeline_record(POWER_TIMELINE_BRIDGE_RESET);
 }
 
 static void configure_mipi_panel(void)
@@ -255,7 +257,7 @@ static void display_startup(void)
 		if (!panel)
 			return;
 	} else if (is_ps8640_bridge()) {
-		power_on_ps8640_bridge();
+		/* Powered on in mainboard_init() */
 		ps8640_init(BRIDGE_BUS, BRIDGE_PS8640_CHIP);
 		if (ps8640_get_edid(BRIDGE_BUS, BRIDGE_PS8640_CHIP, &panel->edid) < 0)
 			return;
@@ -292,6 +294,10 @@ static void mainboard_init(struct device *dev)
 	if (CONFIG(TROGDOR_HAS_FINGERPRINT))
 		gpio_output(GPIO_FP_RST_L, 1);
 
+	/* The PS8640 needs 200ms after reset, let it come up meanwhile */
+	if (display_init_required() && !CONFIG(TROGDOR_HAS_MIPI_PANEL) && is_ps8640_bridge())
+		power_on_ps8640_bridge();
+
 	setup_usb();
 	qi2s_configure_gpios();
 	load_qup_fw();
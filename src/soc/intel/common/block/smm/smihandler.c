@@ -63,36 +63,34 @@ __weak void mainboard_smi_espi_handler(void)
 
 /* Common Functions */
 
-static void *find_save_state(const struct smm_save_state_ops *save_state_ops,
-	int cmd)
+static bool is_apmc_write(const struct smm_save_state_ops *save_state_ops, void *state)
 {
-	int node;
-	void *state = NULL;
-	uint32_t io_misc_info;
-	uint8_t reg_al;
+	const uint32_t io_misc_info = save_state_ops->get_io_misc_info(state);
+
+	/* Check for Synchronous IO (bit0==1) */
+	if (!(io_misc_info & (1 << 0)))
+		return false;
+	/* Make sure it was a write (bit4==0) */
+	if (io_misc_info & (1 << 4))
+		return false;
+	/* Check for APMC IO port */
+	return ((io_misc_info >> 16) & 0xff) == APM_CNT;
+}
 
-	/* Check all nodes looking for the one that issued the IO */
-	for (node = 0; node < CONFIG_MAX_CPUS; node++) {
-		state = smm_get_save_state(node);
+static bool is_apmc_cmd(void *state, u8 cmd)
+{
+	const struct smm_save_state_ops *save_state_ops = get_smm_save_state_ops();
 
-		io_misc_info = save_state_ops->get_io_misc_info(state);
+	/* Check AL against the requested command */
+	return is_apmc_write(save_state_ops, state) &&
+		(uint8_t)save_state_ops->get_reg(state, RAX) == cmd;
+}
 
-		/* Check for Synchronous IO (bit0==1) */
-		if (!(io_misc_info & (1 << 0)))
-			continue;
-		/* Make sure it was a write (bit4==0) */
-		if (io_misc_info & (1 << 4))
-			continue;
-		/* Check for APMC IO port */
-		if (((io_misc_info >> 16) & 0xff) != APM_CNT)
-			continue;
-		/* Check AL against the requested command */
-		reg_al = save_state_ops->get_reg(state, RAX);
-		if (reg_al != cmd)
-			continue;
-		break;
-	}
-	return state;
+bool smm_cpu_is_apmc_originator(int cpu)
+{
+	void *state = smm_get_save_state(cpu);
+
+	return state && is_apmc_write(get_smm_save_state_ops(), state);
 }
 
 /* Inherited from cpu/x86/smm.h resulting in a different signature */
@@ -249,7 +247,7 @@ static void southbridge_smi_gsmi(
 	void *io_smi = NULL;
 	uint32_t reg_ebx;
 
-	io_smi = find_save_state(save_state_ops, APM_CNT_ELOG_GSMI);
+	io_smi = smm_find_apmc_save_state(APM_CNT_ELOG_GSMI, is_apmc_cmd);
 	if (!io_smi)
 		return;
 	/* Command and return value in EAX */
@@ -285,7 +283,7 @@ static void southbridge_smi_store(
 	void *io_smi;
 	uint32_t reg_ebx;
 
-	io_smi = find_save_state(save_state_ops, APM_CNT_SMMSTORE);
+	io_smi = smm_find_apmc_save_state(APM_CNT_SMMSTORE, is_apmc_cmd);
 	if (!io_smi)
 		return;
 	/* Command and return value in EAX */
@@ -1,7 +1,17 @@
 # SPDX-License-Identifier: GPL-2.0-only
 
 tests-y += acpigen-test
+tests-y += acpi_apic-test
 
 acpigen-test-srcs += tests/acpi/acpigen-test.c
 acpigen-test-srcs += src/acpi/acpigen.c
 acpigen-test-srcs += tests/stubs/console.c
+
+acpi_apic-test-srcs += tests/acpi/acpi_apic-test.c
+acpi_apic-test-srcs += src/acpi/acpi_apic.c
+acpi_apic-test-srcs += src/commonlib/sort.c
+acpi_apic-test-srcs += src/device/cpu_device.c
+acpi_apic-test-srcs += tests/stubs/console.c
+acpi_apic-test-config += CONFIG_MAX_CPUS=1024 \
+			 CONFIG_ACPI_COMMON_MADT_LAPIC=1 \
+			 CONFIG_ACPI_COMMON_MADT_IOAPIC=0
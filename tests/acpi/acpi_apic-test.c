@@ -0,0 +1,177 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+
+#include <acpi/acpi.h>
+#include <arch/ioapic.h>
+#include <commonlib/sort.h>
+#include <cpu/cpu.h>
+#include <device/device.h>
+#include <stdlib.h>
+#include <string.h>
+#include <tests/test.h>
+#include <types.h>
+
+#define NUM_PACKAGES		4
+#define CORES_PER_PACKAGE	128
+#define THREADS_PER_CORE	2
+#define NUM_CPUS		(NUM_PACKAGES * CORES_PER_PACKAGE * THREADS_PER_CORE)
+#define MADT_BUFFER_SZ		(NUM_CPUS * sizeof(acpi_madt_lx2apic_t) + 64)
+
+static struct device cpus[NUM_CPUS];
+struct device *all_devices;
+
+bool is_enabled_cpu(const struct device *cpu)
+{
+	return cpu->path.type == DEVICE_PATH_APIC && cpu->enabled;
+}
+
+struct device *alloc_find_dev(struct bus *parent, struct device_path *path)
+{
+	return NULL;
+}
+
+DEVTREE_CONST struct device *find_dev_path(const struct bus *parent,
+					   const struct device_path *path)
+{
+	return NULL;
+}
+
+DEVTREE_CONST struct device *dev_find_path(DEVTREE_CONST struct device *prev_match,
+					   enum device_path_type path_type)
+{
+	return NULL;
+}
+
+const char *dev_path(const struct device *dev)
+{
+	return "APIC";
+}
+
+uintptr_t cpu_get_lapic_addr(void)
+{
+	return 0xfee00000;
+}
+
+u8 get_ioapic_id(uintptr_t ioapic_base)
+{
+	return 0;
+}
+
+unsigned int ioapic_get_max_vectors(uintptr_t ioapic_base)
+{
+	return 24;
+}
+
+void ioapic_get_sci_pin(u8 *gsi, u8 *irq, u8 *flags)
+{
+}
+
+/*
+ * Build a thousand-CPU devicetree the way MP init leaves it: CPUs in the order they
+ * checked in, which has nothing to do with their APIC IDs, a few of them disabled and
+ * enough packages for APIC IDs to need x2APIC entries.
+ */
+static void build_topology(void)
+{
+	size_t i;
+
+	memset(cpus, 0, sizeof(cpus));
+	for (i = 0; i < NUM_CPUS; i++) {
+		/* 389 is coprime to NUM_CPUS, so this visits every CPU once. */
+		const unsigned int n = (i * 389) % NUM_CPUS;
+		const unsigned int thread = n % THREADS_PER_CORE;
+		const unsigned int core = (n / THREADS_PER_CORE) % CORES_PER_PACKAGE;
+		const unsigned int package = n / (THREADS_PER_CORE * CORES_PER_PACKAGE);
+		struct device *cpu = &cpus[i];
+
+		cpu->path.type = DEVICE_PATH_APIC;
+		cpu->path.apic.thread_id = thread;
+		cpu->path.apic.core_id = core;
+		cpu->path.apic.package_id = package;
+		cpu->path.apic.apic_id = package << 8 | core << 1 | thread;
+		cpu->enabled = (n % 97) != 5;
+		cpu->next = i + 1 < NUM_CPUS ? &cpus[i + 1] : NULL;
+	}
+	all_devices = &cpus[0];
+}
+
+/* The MADT LAPIC entries as they were generated before the topology snapshot existed. */
+static unsigned long reference_madt_lapics(unsigned long current)
+{
+	static int apic_ids[CONFIG_MAX_CPUS];
+	struct device *cpu;
+	int index, num_cpus = 0, sort_start = 0;
+
+	for (unsigned int thread_id = 0; thread_id <= 1; thread_id++) {
+		for (cpu = all_devices; cpu; cpu = cpu->next) {
+			if (!is_enabled_cpu(cpu))
+				continue;
+			if (num_cpus >= ARRAY_SIZE(apic_ids))
+				break;
+			if (cpu->path.apic.thread_id != thread_id)
+				continue;
+			apic_ids[num_cpus++] = cpu->path.apic.apic_id;
+		}
+		bubblesort(&apic_ids[sort_start], num_cpus - sort_start, NUM_ASCENDING);
+		sort_start = num_cpus;
+	}
+	for (index = 0; index < num_cpus; index++)
+		current = acpi_create_madt_one_lapic(current, index, apic_ids[index]);
+
+	return acpi_create_madt_lapic_nmis(current);
+}
+
+static void test_cpu_topology_snapshot(void **state)
+{
+	const struct cpu_topology *topology = cpu_topology_snapshot();
+	size_t enabled = 0;
+
+	for (size_t i = 0; i < NUM_CPUS; i++)
+		enabled += cpus[i].enabled;
+
+	assert_int_equal(enabled, topology->num_cpus);
+	for (size_t i = 1; i < topology->num_cpus; i++) {
+		const struct apic_path *prev = &topology->cpus[i - 1]->path.apic;
+		const struct apic_path *cur = &topology->cpus[i]->path.apic;
+
+		assert_true(is_enabled_cpu(topology->cpus[i]));
+		assert_true(prev->thread_id < cur->thread_id ||
+			    (prev->thread_id == cur->thread_id && prev->apic_id < cur->apic_id));
+	}
+
+	/* The snapshot is only taken once. */
+	assert_ptr_equal(topology, cpu_topology_snapshot());
+}
+
+static void test_madt_lapics(void **state)
+{
+	u8 *expected = calloc(1, MADT_BUFFER_SZ);
+	u8 *actual = calloc(1, MADT_BUFFER_SZ);
+	acpi_madt_t madt = {};
+	size_t expected_len, actual_len;
+
+	expected_len = reference_madt_lapics((uintptr_t)expected) - (uintptr_t)expected;
+	actual_len = acpi_arch_fill_madt(&madt, (uintptr_t)actual) - (uintptr_t)actual;
+
+	assert_int_equal(expected_len, actual_len);
+	assert_memory_equal(expected, actual, expected_len);
+	assert_true(actual_len <= MADT_BUFFER_SZ);
+
+	free(expected);
+	free(actual);
+}
+
+static int setup_topology(void **state)
+{
+	build_topology();
+	return 0;
+}
+
+int main(void)
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(test_cpu_topology_snapshot),
+		cmocka_unit_test(test_madt_lapics),
+	};
+
+	return cb_run_group_tests(tests, setup_topology, NULL);
+}
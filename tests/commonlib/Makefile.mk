@@ -1,11 +1,13 @@
 # SPDX-License-Identifier: GPL-2.0-only
 
 subdirs-y += bsd
+subdirs-y += storage
 
 tests-y += list-test
 tests-y += rational-test
 tests-y += region-test
 tests-y += device_tree-test
+tests-y += sort-test
 
 device_tree-test-srcs += tests/commonlib/device_tree-test.c
 device_tree-test-srcs += tests/stubs/console.c
@@ -20,3 +22,6 @@ rational-test-srcs += src/commonlib/rational.c
 
 region-test-srcs += tests/commonlib/region-test.c
 region-test-srcs += src/commonlib/region.c
+
+sort-test-srcs += tests/commonlib/sort-test.c
+sort-test-srcs += src/commonlib/sort.c
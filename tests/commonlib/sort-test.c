@@ -0,0 +1,112 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+
+#include <commonlib/sort.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <tests/test.h>
+#include <types.h>
+
+static int compare_ints(const void *a, const void *b)
+{
+	const int x = *(const int *)a, y = *(const int *)b;
+
+	return (x > y) - (x < y);
+}
+
+static void assert_sorted(const int *v, size_t n)
+{
+	for (size_t i = 1; i < n; i++)
+		assert_true(v[i - 1] <= v[i]);
+}
+
+static void test_bubblesort(void **state)
+{
+	int v[] = { 5, -1, 3, 3, 0, 42, -7 };
+	const int ascending[] = { -7, -1, 0, 3, 3, 5, 42 };
+	const int descending[] = { 42, 5, 3, 3, 0, -1, -7 };
+
+	bubblesort(v, ARRAY_SIZE(v), NUM_ASCENDING);
+	assert_memory_equal(ascending, v, sizeof(v));
+	bubblesort(v, ARRAY_SIZE(v), NUM_DESCENDING);
+	assert_memory_equal(descending, v, sizeof(v));
+}
+
+static void test_heap_sort_ints(void **state)
+{
+	const size_t sizes[] = { 0, 1, 2, 3, 7, 64, 1000, 4099 };
+	int *v, *ref;
+
+	for (size_t s = 0; s < ARRAY_SIZE(sizes); s++) {
+		const size_t n = sizes[s];
+
+		v = malloc(n * sizeof(*v) + 1);
+		ref = malloc(n * sizeof(*ref) + 1);
+		for (size_t i = 0; i < n; i++)
+			v[i] = (int)((i * 2654435761u) % 512) - 256;
+		memcpy(ref, v, n * sizeof(*v));
+
+		heap_sort(v, n, sizeof(*v), compare_ints);
+		bubblesort(ref, n, NUM_ASCENDING);
+		assert_sorted(v, n);
+		assert_memory_equal(ref, v, n * sizeof(*v));
+
+		/* Already sorted and reversed input */
+		heap_sort(v, n, sizeof(*v), compare_ints);
+		assert_memory_equal(ref, v, n * sizeof(*v));
+		for (size_t i = 0; i < n / 2; i++) {
+			const int tmp = v[i];
+			v[i] = v[n - i - 1];
+			v[n - i - 1] = tmp;
+		}
+		heap_sort(v, n, sizeof(*v), compare_ints);
+		assert_memory_equal(ref, v, n * sizeof(*v));
+
+		free(v);
+		free(ref);
+	}
+}
+
+struct record {
+	uint16_t key;
+	char payload[13];
+};
+
+static int compare_records(const void *a, const void *b)
+{
+	const struct record *x = a, *y = b;
+
+	return (int)x->key - (int)y->key;
+}
+
+static void test_heap_sort_records(void **state)
+{
+	struct record v[300];
+
+	for (size_t i = 0; i < ARRAY_SIZE(v); i++) {
+		v[i].key = (i * 7919) % ARRAY_SIZE(v);
+		snprintf(v[i].payload, sizeof(v[i].payload), "rec%u", v[i].key);
+	}
+
+	heap_sort(v, ARRAY_SIZE(v), sizeof(v[0]), compare_records);
+
+	/* Whole elements are moved, not just the keys */
+	for (size_t i = 0; i < ARRAY_SIZE(v); i++) {
+		char expected[sizeof(v[i].payload)];
+
+		assert_int_equal(i, v[i].key);
+		snprintf(expected, sizeof(expected), "rec%zu", i);
+		assert_string_equal(expected, v[i].payload);
+	}
+}
+
+int main(void)
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(test_bubblesort),
+		cmocka_unit_test(test_heap_sort_ints),
+		cmocka_unit_test(test_heap_sort_records),
+	};
+
+	return cb_run_group_tests(tests, NULL, NULL);
+}
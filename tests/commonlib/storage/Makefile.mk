@@ -0,0 +1,8 @@
+# SPDX-License-Identifier: GPL-2.0-only
+
+tests-y += mmc_tuning-test
+
+mmc_tuning-test-srcs += tests/commonlib/storage/mmc_tuning-test.c
+mmc_tuning-test-srcs += tests/stubs/console.c
+mmc_tuning-test-srcs += src/commonlib/bsd/ipchksum.c
+mmc_tuning-test-srcs += src/commonlib/storage/mmc_tuning.c
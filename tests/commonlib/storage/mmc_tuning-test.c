@@ -0,0 +1,223 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+
+#include <commonlib/sd_mmc_ctrlr.h>
+#include <commonlib/storage.h>
+#include <stdbool.h>
+#include <string.h>
+#include <tests/test.h>
+
+#include "../../../src/commonlib/storage/sd_mmc.h"
+
+#define GOOD_TUNING	0x2a
+
+/* Mock controller: the bus only works with the GOOD_TUNING sampling point */
+struct mock_ctrlr {
+	struct sd_mmc_ctrlr ctrlr;
+	uint32_t tuning;
+	size_t set_tuning_calls;
+	size_t transfers;
+};
+
+static struct mock_ctrlr mock;
+static struct storage_media media;
+
+static int mock_get_tuning(struct sd_mmc_ctrlr *ctrlr, uint32_t *tuning)
+{
+	*tuning = ((struct mock_ctrlr *)ctrlr)->tuning;
+	return 0;
+}
+
+static int mock_set_tuning(struct sd_mmc_ctrlr *ctrlr, uint32_t tuning)
+{
+	((struct mock_ctrlr *)ctrlr)->tuning = tuning;
+	((struct mock_ctrlr *)ctrlr)->set_tuning_calls++;
+	return 0;
+}
+
+int mmc_send_tuning_seq(struct sd_mmc_ctrlr *ctrlr, char *buffer)
+{
+	struct mock_ctrlr *m = (struct mock_ctrlr *)ctrlr;
+
+	m->transfers++;
+	return m->tuning == GOOD_TUNING ? 0 : -1;
+}
+
+/* Platform storage backing the record */
+static struct mmc_tuning_record stored;
+static bool stored_valid;
+static size_t stored_writes;
+
+int mmc_tuning_record_load(struct mmc_tuning_record *record)
+{
+	if (!stored_valid)
+		return -1;
+	*record = stored;
+	return 0;
+}
+
+void mmc_tuning_record_save(const struct mmc_tuning_record *record)
+{
+	stored = *record;
+	stored_valid = true;
+	stored_writes++;
+}
+
+static int setup_mock(void **state)
+{
+	memset(&mock, 0, sizeof(mock));
+	mock.ctrlr.get_tuning = mock_get_tuning;
+	mock.ctrlr.set_tuning = mock_set_tuning;
+	mock.ctrlr.id = 0xfe000000;
+	mock.ctrlr.timing = BUS_TIMING_MMC_HS200;
+	mock.ctrlr.bus_width = 8;
+
+	memset(&media, 0, sizeof(media));
+	media.ctrlr = &mock.ctrlr;
+	media.cid[0] = 0x15010038;
+	media.cid[1] = 0x47443650;
+	media.cid[2] = 0x4d420112;
+	media.cid[3] = 0x3456789a;
+
+	memset(&stored, 0, sizeof(stored));
+	stored_valid = false;
+	stored_writes = 0;
+	return 0;
+}
+
+/* Tune once and clear the controller as a reset would */
+static void save_good_tuning(void)
+{
+	mock.tuning = GOOD_TUNING;
+	mmc_tuning_save(&media);
+	mock.tuning = 0;
+	mock.set_tuning_calls = 0;
+	mock.transfers = 0;
+}
+
+static void test_restore_without_record(void **state)
+{
+	assert_int_equal(-1, mmc_tuning_restore(&media));
+	assert_int_equal(0, mock.set_tuning_calls);
+	assert_int_equal(0, mock.transfers);
+}
+
+static void test_restore_saved_tuning(void **state)
+{
+	save_good_tuning();
+	assert_int_equal(1, stored_writes);
+
+	assert_int_equal(0, mmc_tuning_restore(&media));
+	assert_int_equal(GOOD_TUNING, mock.tuning);
+	assert_int_equal(1, mock.set_tuning_calls);
+	/* A single verification transfer replaces the tuning loop */
+	assert_int_equal(1, mock.transfers);
+}
+
+static void test_save_skips_unchanged_record(void **state)
+{
+	save_good_tuning();
+	save_good_tuning();
+	assert_int_equal(1, stored_writes);
+
+	/* A new tuning result replaces the record */
+	mock.tuning = GOOD_TUNING + 1;
+	mmc_tuning_save(&media);
+	assert_int_equal(2, stored_writes);
+	assert_int_equal(GOOD_TUNING + 1, stored.tuning);
+}
+
+static void test_restore_other_card(void **state)
+{
+	save_good_tuning();
+
+	media.cid[3] ^= 1;
+	assert_int_equal(-1, mmc_tuning_restore(&media));
+	assert_int_equal(0, mock.set_tuning_calls);
+	assert_int_equal(0, mock.transfers);
+}
+
+static void test_restore_other_controller_or_mode(void **state)
+{
+	save_good_tuning();
+
+	mock.ctrlr.id++;
+	assert_int_equal(-1, mmc_tuning_restore(&media));
+	mock.ctrlr.id--;
+
+	mock.ctrlr.timing = BUS_TIMING_MMC_HS400;
+	assert_int_equal(-1, mmc_tuning_restore(&media));
+	mock.ctrlr.timing = BUS_TIMING_MMC_HS200;
+
+	mock.ctrlr.bus_width = 4;
+	assert_int_equal(-1, mmc_tuning_restore(&media));
+	mock.ctrlr.bus_width = 8;
+
+	assert_int_equal(0, mock.transfers);
+	assert_int_equal(0, mmc_tuning_restore(&media));
+}
+
+static void test_restore_corrupted_record(void **state)
+{
+	save_good_tuning();
+
+	stored.checksum ^= 0x100;
+	assert_int_equal(-1, mmc_tuning_restore(&media));
+	assert_int_equal(0, mock.transfers);
+}
+
+static void test_record_valid(void **state)
+{
+	struct mmc_tuning_record erased;
+
+	save_good_tuning();
+	assert_true(mmc_tuning_record_valid(&stored));
+
+	stored.tuning++;
+	assert_false(mmc_tuning_record_valid(&stored));
+
+	/* An erased flash region must not be taken for a record */
+	memset(&erased, 0xff, sizeof(erased));
+	assert_false(mmc_tuning_record_valid(&erased));
+}
+
+static void test_restore_failed_verification(void **state)
+{
+	/* The sampling point drifted since the record was written */
+	mock.tuning = GOOD_TUNING + 1;
+	mmc_tuning_save(&media);
+	mock.transfers = 0;
+
+	assert_int_equal(-1, mmc_tuning_restore(&media));
+	assert_int_equal(1, mock.transfers);
+}
+
+static void test_controller_without_tuning_access(void **state)
+{
+	mock.ctrlr.get_tuning = NULL;
+	mock.tuning = GOOD_TUNING;
+	mmc_tuning_save(&media);
+	assert_false(stored_valid);
+
+	mock.ctrlr.get_tuning = mock_get_tuning;
+	save_good_tuning();
+	mock.ctrlr.set_tuning = NULL;
+	assert_int_equal(-1, mmc_tuning_restore(&media));
+	assert_int_equal(0, mock.transfers);
+}
+
+int main(void)
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test_setup(test_restore_without_record, setup_mock),
+		cmocka_unit_test_setup(test_restore_saved_tuning, setup_mock),
+		cmocka_unit_test_setup(test_save_skips_unchanged_record, setup_mock),
+		cmocka_unit_test_setup(test_restore_other_card, setup_mock),
+		cmocka_unit_test_setup(test_restore_other_controller_or_mode, setup_mock),
+		cmocka_unit_test_setup(test_restore_corrupted_record, setup_mock),
+		cmocka_unit_test_setup(test_record_valid, setup_mock),
+		cmocka_unit_test_setup(test_restore_failed_verification, setup_mock),
+		cmocka_unit_test_setup(test_controller_without_tuning_access, setup_mock),
+	};
+
+	return cb_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,8 @@
+# SPDX-License-Identifier: GPL-2.0-only
+
+tests-y += smm_apmc-test
+
+smm_apmc-test-srcs += tests/cpu/x86/smm_apmc-test.c
+smm_apmc-test-srcs += src/cpu/x86/smm/apmc_originator.c
+smm_apmc-test-stage := smm
+smm_apmc-test-config += CONFIG_MAX_CPUS=8
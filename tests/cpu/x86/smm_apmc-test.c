@@ -0,0 +1,119 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+
+#include <cpu/x86/smm.h>
+#include <string.h>
+#include <tests/test.h>
+
+#define TEST_CPUS	4
+
+/* Mocked save states: whether the CPU trapped on an APM_CNT write, and with what */
+static struct save_state {
+	bool apmc_write;
+	u8 cmd;
+} save_states[TEST_CPUS];
+
+/* Save states inspected by the search */
+static unsigned int checked;
+
+void *smm_get_save_state(int cpu)
+{
+	if (cpu >= TEST_CPUS)
+		return NULL;
+	return &save_states[cpu];
+}
+
+bool smm_cpu_is_apmc_originator(int cpu)
+{
+	return save_states[cpu].apmc_write;
+}
+
+static bool is_apmc_cmd(void *state, u8 cmd)
+{
+	const struct save_state *s = state;
+
+	checked++;
+	return s->apmc_write && s->cmd == cmd;
+}
+
+static void smi_entry(void)
+{
+	for (int cpu = 0; cpu < TEST_CPUS; cpu++)
+		smm_apmc_check_originator(cpu);
+}
+
+static int setup_save_states(void **state)
+{
+	memset(save_states, 0, sizeof(save_states));
+	smm_apmc_clear_originator();
+	checked = 0;
+	return 0;
+}
+
+static void test_apmc_originator_found(void **state)
+{
+	save_states[2] = (struct save_state){ true, APM_CNT_SMMSTORE };
+	smi_entry();
+	assert_int_equal(2, smm_apmc_originator());
+
+	/* Only the originator's save state is looked at */
+	assert_ptr_equal(&save_states[2], smm_find_apmc_save_state(APM_CNT_SMMSTORE,
+								   is_apmc_cmd));
+	assert_int_equal(1, checked);
+
+	/* The handler is done with the SMI */
+	smm_apmc_clear_originator();
+	assert_int_equal(-1, smm_apmc_originator());
+}
+
+static void test_apmc_originator_late(void **state)
+{
+	/* The originator wasn't in SMM yet when the others checked */
+	smi_entry();
+	save_states[3] = (struct save_state){ true, APM_CNT_ELOG_GSMI };
+	assert_int_equal(-1, smm_apmc_originator());
+
+	assert_ptr_equal(&save_states[3], smm_find_apmc_save_state(APM_CNT_ELOG_GSMI,
+								   is_apmc_cmd));
+	assert_int_equal(TEST_CPUS, checked);
+}
+
+static void test_apmc_originator_other_cmd(void **state)
+{
+	/* The recorded originator wrote something else, another CPU wrote the command */
+	save_states[0] = (struct save_state){ true, APM_CNT_SMMSTORE };
+	save_states[1] = (struct save_state){ true, APM_CNT_ELOG_GSMI };
+	smi_entry();
+	assert_int_equal(1, smm_apmc_originator());
+
+	assert_ptr_equal(&save_states[0], smm_find_apmc_save_state(APM_CNT_SMMSTORE,
+								   is_apmc_cmd));
+}
+
+static void test_apmc_no_match(void **state)
+{
+	save_states[1] = (struct save_state){ true, APM_CNT_SMMSTORE };
+	smi_entry();
+
+	/* Nothing matches, the search stops at the last populated save state */
+	assert_null(smm_find_apmc_save_state(APM_CNT_ELOG_GSMI, is_apmc_cmd));
+	assert_int_equal(1 + TEST_CPUS, checked);
+
+	/* No CPU trapped on APM_CNT at all */
+	memset(save_states, 0, sizeof(save_states));
+	smm_apmc_clear_originator();
+	smi_entry();
+	assert_int_equal(-1, smm_apmc_originator());
+	assert_null(smm_find_apmc_save_state(APM_CNT_SMMSTORE, is_apmc_cmd));
+}
+
+int main(void)
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test_setup(test_apmc_originator_found, setup_save_states),
+		cmocka_unit_test_setup(test_apmc_originator_late, setup_save_states),
+		cmocka_unit_test_setup(test_apmc_originator_other_cmd, setup_save_states),
+		cmocka_unit_test_setup(test_apmc_no_match, setup_save_states),
+	};
+
+	return cb_run_group_tests(tests, NULL, NULL);
+}
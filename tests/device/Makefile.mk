@@ -2,6 +2,7 @@
 
 tests-y += i2c-test
 tests-y += ddr4-test
+tests-y += pci_ops-test
 
 i2c-test-srcs += tests/device/i2c-test.c
 i2c-test-srcs += src/device/i2c.c
@@ -10,3 +11,11 @@ i2c-test-mocks += platform_i2c_transfer
 ddr4-test-srcs += tests/device/ddr4-test.c
 ddr4-test-srcs += tests/stubs/console.c
 ddr4-test-srcs += src/device/dram/ddr4.c
+
+pci_ops-test-srcs += tests/device/pci_ops-test.c
+pci_ops-test-srcs += tests/stubs/console.c
+pci_ops-test-srcs += tests/stubs/die.c
+pci_ops-test-srcs += src/device/pci_ops.c
+pci_ops-test-stage := ramstage
+pci_ops-test-config += CONFIG_PCI_CONFIG_SHADOW=1 CONFIG_ECAM_MMCONF_SUPPORT=0 \
+		       CONFIG_PCI_IO_CFG_EXT=1 CONFIG_ECAM_MMCONF_BASE_ADDRESS=0xe0000000
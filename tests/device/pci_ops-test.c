@@ -0,0 +1,229 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+
+#include <arch/io.h>
+#include <commonlib/endian.h>
+#include <device/device.h>
+#include <device/pci.h>
+#include <device/pci_ops.h>
+#include <stdlib.h>
+#include <string.h>
+#include <tests/test.h>
+
+#define TEST_DEVFN	PCI_DEVFN(3, 0)
+
+/* Configuration space of a single PCIe function behind the 0xcf8/0xcfc ports */
+static u8 config[4096];
+static u32 config_addr;
+static size_t config_reads;
+
+static struct bus test_bus = { .secondary = 1 };
+static struct device test_dev = {
+	.path = { .type = DEVICE_PATH_PCI, .pci = { .devfn = TEST_DEVFN } },
+	.upstream = &test_bus,
+};
+
+/* Returns the register the last address write selected, or -1 for other functions */
+static int config_reg(uint16_t port)
+{
+	const u32 bdf = (1 << 16) | (TEST_DEVFN << 8);
+
+	assert_true(config_addr & (1U << 31));
+	if ((config_addr & 0x00ffff00) != bdf)
+		return -1;
+	return (config_addr & 0xfc) | (config_addr >> 16 & 0xf00) | (port & 3);
+}
+
+static u32 config_read(uint16_t port, size_t size)
+{
+	const int reg = config_reg(port);
+	u32 value = 0;
+
+	config_reads++;
+	if (reg < 0)
+		return 0xffffffff;
+	for (size_t i = 0; i < size; i++)
+		value |= config[reg + i] << (8 * i);
+	return value;
+}
+
+static void config_write(u32 value, uint16_t port, size_t size)
+{
+	const int reg = config_reg(port);
+
+	if (reg < 0)
+		return;
+	for (size_t i = 0; i < size; i++)
+		config[reg + i] = value >> (8 * i);
+}
+
+void outl(uint32_t value, uint16_t port)
+{
+	if (port == PCI_IO_CONFIG_INDEX)
+		config_addr = value;
+	else
+		config_write(value, port, sizeof(value));
+}
+
+void outb(uint8_t value, uint16_t port) { config_write(value, port, sizeof(value)); }
+void outw(uint16_t value, uint16_t port) { config_write(value, port, sizeof(value)); }
+uint8_t inb(uint16_t port) { return config_read(port, sizeof(uint8_t)); }
+uint16_t inw(uint16_t port) { return config_read(port, sizeof(uint16_t)); }
+uint32_t inl(uint16_t port) { return config_read(port, sizeof(uint32_t)); }
+
+/* Chain `num` capabilities starting at 0x40, each 8 bytes apart */
+static void add_caps(const u8 *ids, size_t num)
+{
+	config[PCI_STATUS] |= PCI_STATUS_CAP_LIST;
+	config[PCI_CAPABILITY_LIST] = num ? 0x40 : 0;
+	for (size_t i = 0; i < num; i++) {
+		config[0x40 + 8 * i + PCI_CAP_LIST_ID] = ids[i];
+		config[0x40 + 8 * i + PCI_CAP_LIST_NEXT] = i + 1 < num ? 0x40 + 8 * (i + 1) : 0;
+	}
+}
+
+/* Chain `num` extended capabilities starting at 0x100, each 0x10 bytes apart */
+static void add_ext_caps(const u16 *ids, size_t num)
+{
+	for (size_t i = 0; i < num; i++) {
+		const u32 next = i + 1 < num ? PCIE_EXT_CAP_OFFSET + 0x10 * (i + 1) : 0;
+
+		write_le32(&config[PCIE_EXT_CAP_OFFSET + 0x10 * i], next << 20 | 1 << 16 | ids[i]);
+	}
+}
+
+static int setup_device(void **state)
+{
+	static const u8 caps[] = { PCI_CAP_ID_PM, PCI_CAP_ID_MSI, PCI_CAP_ID_PCIE,
+				   PCI_CAP_ID_MSI };
+	static const u16 ext_caps[] = { PCIE_EXT_CAP_AER_ID, PCIE_EXT_CAP_L1SS_ID,
+					PCIE_EXT_CAP_LTR_ID };
+
+	memset(config, 0, sizeof(config));
+	write_le16(&config[PCI_VENDOR_ID], 0x8086);
+	add_caps(caps, ARRAY_SIZE(caps));
+	add_ext_caps(ext_caps, ARRAY_SIZE(ext_caps));
+
+	free(test_dev.pci_shadow);
+	test_dev.pci_shadow = NULL;
+	config_reads = 0;
+	return 0;
+}
+
+static void test_pci_shadow_caps_cached(void **state)
+{
+	assert_int_equal(0x48, pci_find_capability(&test_dev, PCI_CAP_ID_MSI));
+	assert_int_not_equal(0, config_reads);
+
+	/* Later lookups, including misses and iterations, don't touch the device */
+	config_reads = 0;
+	assert_int_equal(0x40, pci_find_capability(&test_dev, PCI_CAP_ID_PM));
+	assert_int_equal(0x58, pci_find_next_capability(&test_dev, PCI_CAP_ID_MSI, 0x48));
+	assert_int_equal(0, pci_find_next_capability(&test_dev, PCI_CAP_ID_MSI, 0x58));
+	assert_int_equal(0, pci_find_capability(&test_dev, PCI_CAP_ID_VPD));
+	assert_int_equal(0, config_reads);
+}
+
+static void test_pci_shadow_ext_caps_cached(void **state)
+{
+	assert_int_equal(0x110, pci_shadow_find_ext_cap(&test_dev, PCIE_EXT_CAP_L1SS_ID, 0));
+	assert_int_not_equal(0, config_reads);
+
+	config_reads = 0;
+	assert_int_equal(0x120, pci_shadow_find_ext_cap(&test_dev, PCIE_EXT_CAP_LTR_ID, 0));
+	assert_int_equal(0x120, pci_shadow_find_ext_cap(&test_dev, PCIE_EXT_CAP_LTR_ID, 0x100));
+	assert_int_equal(0, pci_shadow_find_ext_cap(&test_dev, PCIE_EXT_CAP_AER_ID, 0x100));
+	/* Continuing after an offset that is no capability is left to the device */
+	assert_int_equal(-1, pci_shadow_find_ext_cap(&test_dev, PCIE_EXT_CAP_AER_ID, 0x104));
+	assert_int_equal(0, config_reads);
+}
+
+static void test_pci_shadow_overflow(void **state)
+{
+	u8 caps[24];
+	u16 ext_caps[40];
+	size_t reads;
+
+	/* More capabilities than the shadow has room for */
+	memset(caps, PCI_CAP_ID_VPD, sizeof(caps));
+	caps[ARRAY_SIZE(caps) - 1] = PCI_CAP_ID_PM;
+	add_caps(caps, ARRAY_SIZE(caps));
+	for (size_t i = 0; i < ARRAY_SIZE(ext_caps); i++)
+		ext_caps[i] = PCIE_EXT_CAP_SRIOV_ID;
+	add_ext_caps(ext_caps, ARRAY_SIZE(ext_caps));
+
+	/* Lookups still give the right answer, straight from the device */
+	assert_int_equal(0x40 + 8 * 23, pci_find_capability(&test_dev, PCI_CAP_ID_PM));
+	reads = config_reads;
+	assert_int_equal(0x40 + 8 * 23, pci_find_capability(&test_dev, PCI_CAP_ID_PM));
+	assert_true(config_reads >= 2 * reads);
+
+	assert_int_equal(-1, pci_shadow_find_ext_cap(&test_dev, PCIE_EXT_CAP_AER_ID, 0));
+}
+
+static void test_pci_shadow_missing_device(void **state)
+{
+	static u8 present[sizeof(config)];
+
+	memcpy(present, config, sizeof(config));
+	memset(config, 0xff, sizeof(config));
+	assert_int_equal(0, pci_find_capability(&test_dev, PCI_CAP_ID_MSI));
+	assert_int_equal(-1, pci_shadow_find_ext_cap(&test_dev, PCIE_EXT_CAP_LTR_ID, 0));
+
+	/* A function that shows up later is walked then */
+	memcpy(config, present, sizeof(config));
+	assert_int_equal(0x48, pci_find_capability(&test_dev, PCI_CAP_ID_MSI));
+	assert_int_equal(0x120, pci_shadow_find_ext_cap(&test_dev, PCIE_EXT_CAP_LTR_ID, 0));
+}
+
+static void test_pci_shadow_invalidated_by_header_write(void **state)
+{
+	assert_int_equal(0x50, pci_find_capability(&test_dev, PCI_CAP_ID_PCIE));
+	assert_int_equal(0x120, pci_shadow_find_ext_cap(&test_dev, PCIE_EXT_CAP_LTR_ID, 0));
+
+	/* Writes outside of capability headers keep the cache */
+	pci_write_config16(&test_dev, 0x40 + 2, 0x1234);
+	pci_write_config32(&test_dev, 0x110 + 4, 0x1234);
+	config_reads = 0;
+	assert_int_equal(0x50, pci_find_capability(&test_dev, PCI_CAP_ID_PCIE));
+	assert_int_equal(0x120, pci_shadow_find_ext_cap(&test_dev, PCIE_EXT_CAP_LTR_ID, 0));
+	assert_int_equal(0, config_reads);
+
+	/* Unlinking the PCIe capability drops the lists */
+	pci_write_config8(&test_dev, 0x48 + PCI_CAP_LIST_NEXT, 0x58);
+	assert_int_equal(0, pci_find_capability(&test_dev, PCI_CAP_ID_PCIE));
+	assert_int_not_equal(0, config_reads);
+
+	/* So does rewriting the list pointer */
+	pci_write_config8(&test_dev, PCI_CAPABILITY_LIST, 0x58);
+	assert_int_equal(0x58, pci_find_capability(&test_dev, PCI_CAP_ID_MSI));
+	assert_int_equal(0, pci_find_capability(&test_dev, PCI_CAP_ID_PM));
+
+	/* And an extended capability header */
+	pci_write_config32(&test_dev, 0x110, 0x120 << 20 | 1 << 16 | PCIE_EXT_CAP_AER_ID);
+	assert_int_equal(0x110, pci_shadow_find_ext_cap(&test_dev, PCIE_EXT_CAP_AER_ID, 0x100));
+}
+
+static void test_pci_shadow_invalidate(void **state)
+{
+	assert_int_equal(0x40, pci_find_capability(&test_dev, PCI_CAP_ID_PM));
+
+	/* Changes behind the accessors' back need an explicit invalidation */
+	config[0x40 + PCI_CAP_LIST_ID] = PCI_CAP_ID_VPD;
+	assert_int_equal(0x40, pci_find_capability(&test_dev, PCI_CAP_ID_PM));
+	pci_shadow_invalidate(&test_dev);
+	assert_int_equal(0, pci_find_capability(&test_dev, PCI_CAP_ID_PM));
+}
+
+int main(void)
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test_setup(test_pci_shadow_caps_cached, setup_device),
+		cmocka_unit_test_setup(test_pci_shadow_ext_caps_cached, setup_device),
+		cmocka_unit_test_setup(test_pci_shadow_overflow, setup_device),
+		cmocka_unit_test_setup(test_pci_shadow_missing_device, setup_device),
+		cmocka_unit_test_setup(test_pci_shadow_invalidated_by_header_write, setup_device),
+		cmocka_unit_test_setup(test_pci_shadow_invalidate, setup_device),
+	};
+
+	return cb_run_group_tests(tests, NULL, NULL);
+}
@@ -11,3 +11,25 @@ efivars-test-cflags += -I src/vendorcode/intel/edk2/UDK2017/MdePkg/Include/
 efivars-test-cflags += -I src/vendorcode/intel/edk2/UDK2017/MdePkg/Include/Ia32/
 efivars-test-cflags += -I src/vendorcode/intel/edk2/UDK2017/MdePkg/Include/Pi/
 efivars-test-cflags += -I src/vendorcode/intel/edk2/UDK2017/MdeModulePkg/Include/
+
+tests-y += cmos_option-test
+
+cmos_option-test-srcs += tests/drivers/cmos_option.c
+cmos_option-test-srcs += tests/stubs/console.c
+cmos_option-test-cflags += -I tests/include/tests/drivers/cmos_option
+cmos_option-test-config += CONFIG_USE_OPTION_TABLE=1 CONFIG_OPTION_BACKEND_NONE=0
+
+tests-y += flashconsole-test
+
+flashconsole-test-srcs += tests/drivers/flashconsole.c
+flashconsole-test-srcs += src/drivers/spi/flashconsole.c
+flashconsole-test-srcs += tests/stubs/console.c
+flashconsole-test-srcs += src/commonlib/region.c
+flashconsole-test-cflags += -I tests/include/tests/lib/fmap
+
+tests-y += ipmi_bt-test
+
+ipmi_bt-test-srcs += tests/drivers/ipmi_bt.c
+ipmi_bt-test-srcs += src/drivers/ipmi/ipmi_bt.c
+ipmi_bt-test-srcs += tests/stubs/console.c
+ipmi_bt-test-config += CONFIG_IPMI_KCS_REGISTER_SPACING=1 CONFIG_IPMI_KCS_TIMEOUT_MS=100
@@ -0,0 +1,254 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+
+#include "../drivers/pc80/rtc/option.c"
+
+#include <commonlib/coreboot_tables.h>
+#include <string.h>
+#include <tests/test.h>
+
+/* Fake RTC: index/data port pair in front of 128 bytes of CMOS RAM */
+static u8 cmos_ram[128];
+static u8 cmos_index;
+static size_t port_accesses;
+
+void outb(uint8_t value, uint16_t port)
+{
+	port_accesses++;
+	if (port == RTC_BASE_PORT_BANK0)
+		cmos_index = value & 0x7f;
+	else if (port == RTC_BASE_PORT_BANK0 + 1)
+		cmos_ram[cmos_index] = value;
+	else
+		fail_msg("Unexpected port write: %#x", port);
+}
+
+uint8_t inb(uint16_t port)
+{
+	port_accesses++;
+	assert_int_equal(RTC_BASE_PORT_BANK0 + 1, port);
+	return cmos_ram[cmos_index];
+}
+
+int cmos_checksum_valid(int range_start, int range_end, int cks_loc)
+{
+	fail_msg("Checksum has to be validated through the snapshot");
+	return 0;
+}
+
+void cmos_set_checksum(int range_start, int range_end, int cks_loc)
+{
+	fail_msg("Checksum has to be updated through the snapshot");
+}
+
+int cmos_error(void)
+{
+	return 0;
+}
+
+static u16 cmos_sum(const u8 *image)
+{
+	u16 sum = 0;
+
+	for (int i = LB_CKS_RANGE_START; i <= LB_CKS_RANGE_END; i++)
+		sum += image[i];
+	return sum;
+}
+
+static void cmos_update_checksum(u8 *image)
+{
+	const u16 sum = cmos_sum(image);
+
+	image[LB_CKS_LOC] = sum >> 8;
+	image[LB_CKS_LOC + 1] = sum & 0xff;
+}
+
+#define TEST_ENTRY(_name, _bit, _length, _config) \
+	{ \
+		.tag = LB_TAG_OPTION, \
+		.size = sizeof(struct cmos_entries), \
+		.bit = _bit, \
+		.length = _length, \
+		.config = _config, \
+		.name = _name, \
+	}
+
+static struct {
+	struct cmos_option_table header;
+	struct cmos_entries entries[5];
+	u32 end_tag;
+} __packed cmos_layout = {
+	.header = {
+		.tag = LB_TAG_CMOS_OPTION_TABLE,
+		.size = sizeof(cmos_layout),
+		.header_length = sizeof(struct cmos_option_table),
+	},
+	.entries = {
+		TEST_ENTRY("boot_option", 384, 1, 'e'),
+		TEST_ENTRY("debug_level", 392, 4, 'e'),
+		TEST_ENTRY("power_on_after_fail", 396, 1, 'e'),
+		TEST_ENTRY("hex_value", 400, 16, 'h'),
+		TEST_ENTRY("string_value", 416, 64, 's'),
+	},
+	.end_tag = LB_TAG_OPTION_CHECKSUM,
+};
+
+static u8 cmos_default[128];
+
+void *_cbfs_alloc(const char *name, cbfs_allocator_t allocator, void *arg,
+		  size_t *size_out, bool force_ro, enum cbfs_type *type)
+{
+	if (!strcmp(name, "cmos_layout.bin")) {
+		if (size_out)
+			*size_out = sizeof(cmos_layout);
+		return &cmos_layout;
+	}
+	if (!strcmp(name, "cmos.default")) {
+		if (size_out)
+			*size_out = sizeof(cmos_default);
+		return cmos_default;
+	}
+	return NULL;
+}
+
+static int setup_cmos(void **state)
+{
+	memset(cmos_ram, 0, sizeof(cmos_ram));
+	cmos_ram[384 / 8] = 0x1;		/* boot_option = 1 */
+	cmos_ram[392 / 8] = 0x5 | (1 << 4);	/* debug_level = 5, power_on_after_fail = 1 */
+	cmos_ram[400 / 8] = 0x34;		/* hex_value = 0x1234 */
+	cmos_ram[400 / 8 + 1] = 0x12;
+	cmos_update_checksum(cmos_ram);
+
+	cmos_snapshot.loaded = false;
+	port_accesses = 0;
+	return 0;
+}
+
+static void test_get_uint_option(void **state)
+{
+	assert_int_equal(1, get_uint_option("boot_option", 7));
+	assert_int_equal(5, get_uint_option("debug_level", 7));
+	assert_int_equal(1, get_uint_option("power_on_after_fail", 7));
+	assert_int_equal(0x1234, get_uint_option("hex_value", 7));
+
+	/* Unknown and non-integer options fall back without touching CMOS */
+	assert_int_equal(7, get_uint_option("no_such_option", 7));
+	assert_int_equal(7, get_uint_option("string_value", 7));
+}
+
+static void test_get_uint_option_reads_cmos_once(void **state)
+{
+	size_t accesses;
+
+	/* Each byte is an index write and a data read */
+	get_uint_option("debug_level", 0);
+	accesses = port_accesses;
+	assert_int_equal(2 * (LB_CKS_RANGE_END - LB_CKS_RANGE_START + 1 + 2), accesses);
+
+	get_uint_option("power_on_after_fail", 0);
+	get_uint_option("hex_value", 0);
+	assert_int_equal(accesses, port_accesses);
+
+	/* boot_option lives outside of the checksummed range */
+	get_uint_option("boot_option", 0);
+	assert_int_equal(accesses + 2, port_accesses);
+}
+
+static void test_get_uint_option_bad_checksum(void **state)
+{
+	size_t accesses;
+
+	cmos_ram[LB_CKS_LOC] ^= 0xff;
+
+	assert_int_equal(7, get_uint_option("debug_level", 7));
+	accesses = port_accesses;
+	assert_int_equal(7, get_uint_option("hex_value", 7));
+	assert_int_equal(accesses, port_accesses);
+	assert_false(cmos_lb_cks_valid());
+}
+
+static void test_set_uint_option(void **state)
+{
+	assert_int_equal(CB_SUCCESS, set_uint_option("debug_level", 8));
+	assert_int_equal(CB_SUCCESS, set_uint_option("hex_value", 0xbeef));
+
+	/* CMOS got the new values, neighbouring bits were preserved */
+	assert_int_equal(0x8 | (1 << 4), cmos_ram[392 / 8]);
+	assert_int_equal(0xef, cmos_ram[400 / 8]);
+	assert_int_equal(0xbe, cmos_ram[400 / 8 + 1]);
+
+	/* The checksum stored in CMOS matches its contents */
+	assert_int_equal(cmos_sum(cmos_ram), cmos_ram[LB_CKS_LOC] << 8 | cmos_ram[LB_CKS_LOC + 1]);
+	assert_true(cmos_lb_cks_valid());
+
+	assert_int_equal(8, get_uint_option("debug_level", 0));
+	assert_int_equal(1, get_uint_option("power_on_after_fail", 0));
+	assert_int_equal(0xbeef, get_uint_option("hex_value", 0));
+
+	assert_int_equal(CB_CMOS_OPTION_NOT_FOUND, set_uint_option("no_such_option", 1));
+	assert_int_equal(CB_ERR_ARG, set_uint_option("string_value", 1));
+}
+
+static void test_set_uint_option_fixes_checksum(void **state)
+{
+	cmos_ram[LB_CKS_LOC] ^= 0xff;
+	assert_false(cmos_lb_cks_valid());
+
+	assert_int_equal(CB_SUCCESS, set_uint_option("debug_level", 2));
+
+	assert_true(cmos_lb_cks_valid());
+	assert_int_equal(cmos_sum(cmos_ram), cmos_ram[LB_CKS_LOC] << 8 | cmos_ram[LB_CKS_LOC + 1]);
+	assert_int_equal(2, get_uint_option("debug_level", 1));
+}
+
+static void test_cmos_write_invalidates_snapshot(void **state)
+{
+	assert_int_equal(0x1234, get_uint_option("hex_value", 0));
+
+	/* Direct writes to the option range are picked up */
+	cmos_write(0x78, 400 / 8);
+	cmos_write(0x56, 400 / 8 + 1);
+	assert_int_equal(7, get_uint_option("hex_value", 7));
+	assert_false(cmos_lb_cks_valid());
+
+	/* So are direct checksum updates */
+	cmos_update_checksum(cmos_ram);
+	cmos_write(cmos_ram[LB_CKS_LOC], LB_CKS_LOC);
+	assert_int_equal(0x5678, get_uint_option("hex_value", 7));
+
+	/* Writes outside of it keep the snapshot */
+	cmos_write(0, 384 / 8);
+	assert_true(cmos_snapshot.loaded);
+}
+
+static void test_sanitize_cmos_reloads_snapshot(void **state)
+{
+	/* Defaults only differ in debug_level */
+	memcpy(cmos_default, cmos_ram, sizeof(cmos_default));
+	cmos_default[392 / 8] = 0x3 | (1 << 4);
+	cmos_update_checksum(cmos_default);
+
+	/* Corrupt the live copy, so that sanitize_cmos() restores the defaults */
+	cmos_ram[LB_CKS_LOC] ^= 0xff;
+	assert_int_equal(0, get_uint_option("debug_level", 0));
+
+	sanitize_cmos();
+
+	assert_true(cmos_lb_cks_valid());
+	assert_int_equal(3, get_uint_option("debug_level", 0));
+}
+
+int main(void)
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test_setup(test_get_uint_option, setup_cmos),
+		cmocka_unit_test_setup(test_get_uint_option_reads_cmos_once, setup_cmos),
+		cmocka_unit_test_setup(test_get_uint_option_bad_checksum, setup_cmos),
+		cmocka_unit_test_setup(test_set_uint_option, setup_cmos),
+		cmocka_unit_test_setup(test_set_uint_option_fixes_checksum, setup_cmos),
+		cmocka_unit_test_setup(test_cmos_write_invalidates_snapshot, setup_cmos),
+		cmocka_unit_test_setup(test_sanitize_cmos_reloads_snapshot, setup_cmos),
+	};
+
+	return cb_run_group_tests(tests, NULL, NULL);
+}
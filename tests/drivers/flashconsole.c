@@ -0,0 +1,179 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+
+#include <commonlib/region.h>
+#include <console/flash.h>
+#include <fmap.h>
+#include <string.h>
+#include <tests/test.h>
+
+#define CONSOLE_SIZE	0x10000
+#define PAGE_SIZE	0x100
+
+/* Simulated CONSOLE region, counting the accesses of each stage */
+static uint8_t flash[CONSOLE_SIZE];
+static size_t reads;
+static size_t writes;
+
+static ssize_t flash_readat(const struct region_device *rd, void *b, size_t offset,
+			    size_t size)
+{
+	reads++;
+	memcpy(b, &flash[offset], size);
+	return size;
+}
+
+static ssize_t flash_writeat(const struct region_device *rd, const void *b, size_t offset,
+			     size_t size)
+{
+	const uint8_t *data = b;
+
+	writes++;
+	/* Each write has to be a single page program */
+	assert_int_equal(offset / PAGE_SIZE, (offset + size - 1) / PAGE_SIZE);
+	for (size_t i = 0; i < size; i++) {
+		/* Programming can only clear bits */
+		assert_int_equal(0xff, flash[offset + i]);
+		flash[offset + i] &= data[i];
+	}
+	return size;
+}
+
+static const struct region_device_ops flash_ops = {
+	.readat = flash_readat,
+	.writeat = flash_writeat,
+};
+
+static const struct region_device flash_rdev = REGION_DEV_INIT(&flash_ops, 0, CONSOLE_SIZE);
+
+int fmap_locate_area_as_rdev_rw(const char *name, struct region_device *area)
+{
+	assert_string_equal("CONSOLE", name);
+	return rdev_chain_full(area, &flash_rdev);
+}
+
+static void fill_log(size_t len)
+{
+	memset(flash, 0xff, sizeof(flash));
+	memset(flash, 'a', len);
+}
+
+static void new_stage(void)
+{
+	reads = 0;
+	writes = 0;
+	flashconsole_init();
+}
+
+static void print(const char *str)
+{
+	while (*str)
+		flashconsole_tx_byte(*str++);
+	flashconsole_tx_flush();
+}
+
+static size_t log_len(void)
+{
+	const uint8_t *end = memchr(flash, 0xff, CONSOLE_SIZE);
+
+	return end ? end - flash : CONSOLE_SIZE;
+}
+
+static size_t log2_chunks(void)
+{
+	size_t n = 0;
+
+	while ((1UL << n) < CONSOLE_SIZE / 0x100)
+		n++;
+	return n;
+}
+
+static void test_find_end(void **state)
+{
+	const size_t lengths[] = {
+		0, 1, 0xff, 0x100, 0x101, 0x1234, CONSOLE_SIZE / 2, CONSOLE_SIZE - 2,
+	};
+
+	for (size_t i = 0; i < ARRAY_SIZE(lengths); i++) {
+		fill_log(lengths[i]);
+		new_stage();
+
+		/* Logarithmic in the region size, plus reading the last chunk */
+		assert_true(reads <= log2_chunks() + 2);
+
+		print("x");
+		assert_int_equal(lengths[i] + 1, log_len());
+		assert_int_equal('x', flash[lengths[i]]);
+	}
+}
+
+static void test_full_region(void **state)
+{
+	fill_log(CONSOLE_SIZE);
+	new_stage();
+	print("lost");
+	assert_int_equal(0, writes);
+}
+
+static void test_stages_append(void **state)
+{
+	const char *stages[] = { "bootblock\n", "romstage\n", "ramstage\n" };
+	char expected[64] = "";
+
+	fill_log(0);
+	for (size_t i = 0; i < ARRAY_SIZE(stages); i++) {
+		new_stage();
+		print(stages[i]);
+		assert_int_equal(1, writes);
+		strcat(expected, stages[i]);
+	}
+	assert_int_equal(strlen(expected), log_len());
+	assert_memory_equal(expected, flash, strlen(expected));
+}
+
+static void test_writes_coalesced_per_page(void **state)
+{
+	char line[33];
+
+	/* Start in the middle of a page, so the first write only fills it up */
+	fill_log(0x80);
+	new_stage();
+
+	memset(line, 'b', sizeof(line) - 2);
+	line[sizeof(line) - 2] = '\n';
+	line[sizeof(line) - 1] = '\0';
+	for (size_t i = 0; i < 60; i++) {
+		for (const char *c = line; *c; c++)
+			flashconsole_tx_byte(*c);
+	}
+	/* 0x80 + 60 * 32 bytes end on a page boundary: 0x80 bytes, then 7 pages */
+	assert_int_equal(8, writes);
+
+	flashconsole_tx_flush();
+	assert_int_equal(8, writes);
+	assert_int_equal(0x80 + 60 * 32, log_len());
+}
+
+static void test_flush_writes_partial_page(void **state)
+{
+	fill_log(0xf0);
+	new_stage();
+
+	/* Flushed data crossing a page boundary still takes one write per page */
+	print("0123456789abcdefXYZ");
+	assert_int_equal(2, writes);
+	assert_int_equal(0xf0 + 19, log_len());
+	assert_memory_equal("0123456789abcdefXYZ", &flash[0xf0], 19);
+}
+
+int main(void)
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(test_find_end),
+		cmocka_unit_test(test_full_region),
+		cmocka_unit_test(test_stages_append),
+		cmocka_unit_test(test_writes_coalesced_per_page),
+		cmocka_unit_test(test_flush_writes_partial_page),
+	};
+
+	return cb_run_group_tests(tests, NULL, NULL);
+}
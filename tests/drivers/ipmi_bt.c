@@ -0,0 +1,247 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+
+#include <arch/io.h>
+#include <string.h>
+#include <tests/test.h>
+#include <timer.h>
+
+#include "../../src/drivers/ipmi/ipmi_if.h"
+
+#define BT_PORT		0xe4
+#define BT_CTRL		BT_PORT
+#define BT_BUF		(BT_PORT + CONFIG_IPMI_KCS_REGISTER_SPACING)
+
+#define BT_CTRL_CLR_WR_PTR	(1 << 0)
+#define BT_CTRL_CLR_RD_PTR	(1 << 1)
+#define BT_CTRL_H2B_ATN		(1 << 2)
+#define BT_CTRL_B2H_ATN		(1 << 3)
+#define BT_CTRL_H_BUSY		(1 << 6)
+#define BT_CTRL_B_BUSY		(1 << 7)
+
+/* Request buffer size the simulated BMC reports */
+#define BMC_INPUT_BUFFER	80
+
+#define TEST_CMD		0x2a
+
+/* Simulated BT BMC */
+static struct {
+	uint8_t ctrl;
+	uint8_t req[256];
+	size_t req_len;
+	uint8_t rsp[256];
+	size_t rsp_len;
+	size_t rsp_pos;
+	unsigned int requests;
+	/* Error injection */
+	bool stuck_busy;
+	uint8_t seq_offset;
+	bool short_response;
+} bmc;
+
+static void bmc_respond(void)
+{
+	const uint8_t netfn_lun = bmc.req[1];
+	const uint8_t seq = bmc.req[2];
+	const uint8_t cmd = bmc.req[3];
+	uint8_t *rsp = bmc.rsp;
+
+	/* The length byte has to match what was written */
+	assert_int_equal(bmc.req[0], bmc.req_len - 1);
+	bmc.requests++;
+
+	rsp[1] = netfn_lun + (1 << 2);
+	rsp[2] = seq + bmc.seq_offset;
+	rsp[3] = cmd;
+	rsp[4] = 0; /* completion code */
+	bmc.rsp_len = 5;
+
+	if ((netfn_lun >> 2) == IPMI_NETFN_APPLICATION &&
+	    cmd == IPMI_BMC_GET_BT_INTERFACE_CAPABILITIES) {
+		rsp[bmc.rsp_len++] = 1;
+		rsp[bmc.rsp_len++] = BMC_INPUT_BUFFER;
+		rsp[bmc.rsp_len++] = BMC_INPUT_BUFFER;
+		rsp[bmc.rsp_len++] = 1;
+		rsp[bmc.rsp_len++] = 1;
+	} else {
+		/* Echo the request data back */
+		memcpy(&rsp[bmc.rsp_len], &bmc.req[4], bmc.req_len - 4);
+		bmc.rsp_len += bmc.req_len - 4;
+	}
+
+	if (bmc.short_response)
+		bmc.rsp_len = 3;
+
+	rsp[0] = bmc.rsp_len - 1;
+	bmc.ctrl |= BT_CTRL_B2H_ATN;
+}
+
+void outb(uint8_t value, uint16_t port)
+{
+	if (port == BT_BUF) {
+		assert_true(bmc.req_len < ARRAY_SIZE(bmc.req));
+		bmc.req[bmc.req_len++] = value;
+		return;
+	}
+
+	assert_int_equal(BT_CTRL, port);
+	if (value & BT_CTRL_CLR_WR_PTR)
+		bmc.req_len = 0;
+	if (value & BT_CTRL_CLR_RD_PTR)
+		bmc.rsp_pos = 0;
+	if (value & BT_CTRL_B2H_ATN)
+		bmc.ctrl &= ~BT_CTRL_B2H_ATN;
+	if (value & BT_CTRL_H_BUSY)
+		bmc.ctrl ^= BT_CTRL_H_BUSY;
+	/* The BMC picks the request up right away */
+	if (value & BT_CTRL_H2B_ATN)
+		bmc_respond();
+}
+
+uint8_t inb(uint16_t port)
+{
+	if (port == BT_BUF) {
+		assert_true(bmc.rsp_pos < bmc.rsp_len);
+		return bmc.rsp[bmc.rsp_pos++];
+	}
+
+	assert_int_equal(BT_CTRL, port);
+	return bmc.ctrl | (bmc.stuck_busy ? BT_CTRL_B_BUSY : 0);
+}
+
+void outw(uint16_t value, uint16_t port) { fail(); }
+void outl(uint32_t value, uint16_t port) { fail(); }
+uint16_t inw(uint16_t port) { fail(); return 0; }
+uint32_t inl(uint16_t port) { fail(); return 0; }
+
+void timer_monotonic_get(struct mono_time *mt)
+{
+	static uint64_t now_usecs;
+
+	now_usecs += USECS_PER_MSEC;
+	mono_time_set_usecs(mt, now_usecs);
+}
+
+static int setup_bmc(void **state)
+{
+	memset(&bmc, 0, sizeof(bmc));
+	return 0;
+}
+
+static int send_request(size_t len, uint8_t *rsp, size_t rsp_size)
+{
+	uint8_t req[256];
+
+	for (size_t i = 0; i < len; i++)
+		req[i] = i;
+
+	return ipmi_bt_message(BT_PORT, IPMI_NETFN_APPLICATION, 0, TEST_CMD,
+			       req, len, rsp, rsp_size);
+}
+
+/* Has to run first, the driver only asks for the capabilities once */
+static void test_bt_capabilities(void **state)
+{
+	uint8_t rsp[8];
+
+	assert_int_equal(3 + 2, send_request(2, rsp, sizeof(rsp)));
+	/* Capabilities query, then the actual request */
+	assert_int_equal(2, bmc.requests);
+	/* The driver must not hold on to the buffer */
+	assert_int_equal(0, bmc.ctrl & (BT_CTRL_H_BUSY | BT_CTRL_B2H_ATN));
+}
+
+static void test_bt_framing(void **state)
+{
+	struct ipmi_rsp *resp;
+	uint8_t rsp[16];
+
+	assert_int_equal(3 + 5, send_request(5, rsp, sizeof(rsp)));
+	assert_int_equal(1, bmc.requests);
+
+	/* Length, netfn/lun, seq, cmd and data */
+	assert_int_equal(5 + 3, bmc.req[0]);
+	assert_int_equal(IPMI_NETFN_APPLICATION << 2, bmc.req[1]);
+	assert_int_equal(TEST_CMD, bmc.req[3]);
+	for (int i = 0; i < 5; i++)
+		assert_int_equal(i, bmc.req[4 + i]);
+
+	/* The sequence number is dropped from the response */
+	resp = (struct ipmi_rsp *)rsp;
+	assert_int_equal((IPMI_NETFN_APPLICATION + 1) << 2, resp->lun);
+	assert_int_equal(TEST_CMD, resp->cmd);
+	assert_int_equal(0, resp->completion_code);
+	for (int i = 0; i < 5; i++)
+		assert_int_equal(i, rsp[sizeof(*resp) + i]);
+
+	/* Each request gets a new sequence number */
+	const uint8_t seq = bmc.req[2];
+	assert_int_equal(3, send_request(0, rsp, sizeof(rsp)));
+	assert_int_equal((uint8_t)(seq + 1), bmc.req[2]);
+}
+
+static void test_bt_truncated_response(void **state)
+{
+	uint8_t rsp[4];
+
+	/* Only as much as fits is copied */
+	assert_int_equal(sizeof(rsp), send_request(10, rsp, sizeof(rsp)));
+	assert_int_equal(0, rsp[3]);
+}
+
+static void test_bt_request_too_long(void **state)
+{
+	uint8_t rsp[8];
+
+	/* The length byte covers netfn/lun, seq and cmd but not itself */
+	assert_int_equal(sizeof(rsp), send_request(BMC_INPUT_BUFFER - 4, rsp, sizeof(rsp)));
+	assert_int_equal(1, bmc.requests);
+
+	assert_int_equal(-1, send_request(BMC_INPUT_BUFFER - 3, rsp, sizeof(rsp)));
+	assert_int_equal(1, bmc.requests);
+}
+
+static void test_bt_timeout(void **state)
+{
+	uint8_t rsp[8];
+
+	bmc.stuck_busy = true;
+	assert_int_equal(-1, send_request(1, rsp, sizeof(rsp)));
+	assert_int_equal(0, bmc.requests);
+}
+
+static void test_bt_bad_seq(void **state)
+{
+	uint8_t rsp[8];
+
+	bmc.seq_offset = 1;
+	assert_int_equal(-1, send_request(1, rsp, sizeof(rsp)));
+	assert_int_equal(1, bmc.requests);
+
+	/* The next request goes through with a fresh sequence number */
+	bmc.seq_offset = 0;
+	assert_int_equal(4, send_request(1, rsp, sizeof(rsp)));
+}
+
+static void test_bt_short_response(void **state)
+{
+	uint8_t rsp[8];
+
+	bmc.short_response = true;
+	assert_int_equal(-1, send_request(1, rsp, sizeof(rsp)));
+	assert_int_equal(0, bmc.ctrl & (BT_CTRL_H_BUSY | BT_CTRL_B2H_ATN));
+}
+
+int main(void)
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test_setup(test_bt_capabilities, setup_bmc),
+		cmocka_unit_test_setup(test_bt_framing, setup_bmc),
+		cmocka_unit_test_setup(test_bt_truncated_response, setup_bmc),
+		cmocka_unit_test_setup(test_bt_request_too_long, setup_bmc),
+		cmocka_unit_test_setup(test_bt_timeout, setup_bmc),
+		cmocka_unit_test_setup(test_bt_bad_seq, setup_bmc),
+		cmocka_unit_test_setup(test_bt_short_response, setup_bmc),
+	};
+
+	return cb_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,20 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+
+#ifndef MOCKS_ARCH_IO_H
+#define MOCKS_ARCH_IO_H
+
+#include <stdint.h>
+
+/*
+ * Port I/O cannot be performed by unit tests. Tests using code that relies
+ * on it have to provide these functions, usually modelling the device behind
+ * the accessed ports.
+ */
+void outb(uint8_t value, uint16_t port);
+void outw(uint16_t value, uint16_t port);
+void outl(uint32_t value, uint16_t port);
+uint8_t inb(uint16_t port);
+uint16_t inw(uint16_t port);
+uint32_t inl(uint16_t port);
+
+#endif /* MOCKS_ARCH_IO_H */
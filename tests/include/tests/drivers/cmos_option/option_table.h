@@ -0,0 +1,11 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+
+#ifndef TESTS_OPTION_TABLE_H
+#define TESTS_OPTION_TABLE_H
+
+/* This file mimics output of build_opt_tbl for a typical cmos.layout */
+#define LB_CKS_RANGE_START 49
+#define LB_CKS_RANGE_END 125
+#define LB_CKS_LOC 126
+
+#endif /* TESTS_OPTION_TABLE_H */
@@ -39,6 +39,9 @@ tests-y += cbfs-lookup-no-mcache-test
 tests-y += cbfs-lookup-has-mcache-test
 tests-y += lzma-test
 tests-y += ux_locales-test
+tests-y += rmodule-test
+tests-y += power_timeline-test
+tests-y += s3_boot_script-test
 
 lib-test-srcs += tests/lib/lib-test.c
 
@@ -251,3 +254,23 @@ ux_locales-test-mocks += _cbfs_alloc \
 			vb2api_get_locale_id \
 			vboot_get_context
 ux_locales-test-config += CONFIG_VBOOT=1
+
+rmodule-test-srcs += tests/lib/rmodule-test.c
+rmodule-test-srcs += src/lib/rmodule.c
+rmodule-test-srcs += tests/stubs/console.c
+rmodule-test-config += CONFIG_RELOCATABLE_MODULES=1
+
+power_timeline-test-srcs += tests/lib/power_timeline-test.c
+power_timeline-test-srcs += src/lib/power_timeline.c
+power_timeline-test-srcs += tests/stubs/console.c
+power_timeline-test-config += CONFIG_HAVE_MONOTONIC_TIMER=1 CONFIG_POWER_TIMELINE=1
+
+s3_boot_script-test-srcs += tests/lib/s3_boot_script-test.c
+s3_boot_script-test-srcs += src/lib/s3_boot_script.c
+s3_boot_script-test-srcs += src/commonlib/bsd/ipchksum.c
+s3_boot_script-test-srcs += tests/stubs/console.c
+s3_boot_script-test-stage := ramstage
+s3_boot_script-test-config += CONFIG_HAVE_ACPI_RESUME=1 \
+			      CONFIG_HAVE_MONOTONIC_TIMER=1 \
+			      CONFIG_S3_BOOT_SCRIPT=1 \
+			      CONFIG_S3_BOOT_SCRIPT_ENTRIES=8
@@ -0,0 +1,169 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+
+#include <cbmem.h>
+#include <commonlib/bsd/cbmem_id.h>
+#include <delay.h>
+#include <power_timeline.h>
+#include <string.h>
+#include <tests/test.h>
+#include <timer.h>
+
+/* Every read of the timer takes this long. */
+#define TIMER_READ_USECS	5
+#define BRIDGE_DELAY_USECS	(200 * USECS_PER_MSEC)
+
+static uint64_t now_usecs;
+
+int cbmem_initialized;
+static bool cbmem_entry_present;
+static uint8_t cbmem_entry[64];
+
+void timer_monotonic_get(struct mono_time *mt)
+{
+	now_usecs += TIMER_READ_USECS;
+	mono_time_set_usecs(mt, now_usecs);
+}
+
+void udelay(unsigned int usecs)
+{
+	now_usecs += usecs;
+}
+
+void *cbmem_find(u32 id)
+{
+	assert_int_equal(CBMEM_ID_POWER_TIMELINE, id);
+	return cbmem_entry_present ? cbmem_entry : NULL;
+}
+
+void *cbmem_add(u32 id, u64 size)
+{
+	assert_int_equal(CBMEM_ID_POWER_TIMELINE, id);
+	assert_true(size <= sizeof(cbmem_entry));
+	if (!cbmem_entry_present) {
+		memset(cbmem_entry, 0, sizeof(cbmem_entry));
+		cbmem_entry_present = true;
+	}
+	return cbmem_entry;
+}
+
+static int setup_timeline(void **state)
+{
+	now_usecs = 10 * USECS_PER_SEC;
+	cbmem_initialized = 1;
+	cbmem_entry_present = false;
+	cbmem_add(CBMEM_ID_POWER_TIMELINE, 0);
+	return 0;
+}
+
+/* Returns how long power_timeline_wait_usecs() took. */
+static uint64_t timed_wait(enum power_timeline_event event, uint64_t usecs)
+{
+	const uint64_t start = now_usecs;
+
+	power_timeline_wait_usecs(event, usecs);
+	return now_usecs - start;
+}
+
+static void test_power_timeline_not_recorded(void **state)
+{
+	uint64_t waited;
+
+	assert_int_equal(-1, power_timeline_elapsed_usecs(POWER_TIMELINE_BRIDGE_RESET));
+
+	waited = timed_wait(POWER_TIMELINE_BRIDGE_RESET, BRIDGE_DELAY_USECS);
+	assert_in_range(waited, BRIDGE_DELAY_USECS, BRIDGE_DELAY_USECS + 4 * TIMER_READ_USECS);
+}
+
+static void test_power_timeline_waits_for_remainder(void **state)
+{
+	const uint64_t passed = 150 * USECS_PER_MSEC;
+	uint64_t waited;
+
+	power_timeline_record(POWER_TIMELINE_BRIDGE_RESET);
+	now_usecs += passed;
+	assert_in_range(power_timeline_elapsed_usecs(POWER_TIMELINE_BRIDGE_RESET), passed,
+			passed + 2 * TIMER_READ_USECS);
+
+	waited = timed_wait(POWER_TIMELINE_BRIDGE_RESET, BRIDGE_DELAY_USECS);
+	assert_in_range(waited, BRIDGE_DELAY_USECS - passed - 2 * TIMER_READ_USECS,
+			BRIDGE_DELAY_USECS - passed + 4 * TIMER_READ_USECS);
+}
+
+static void test_power_timeline_already_expired(void **state)
+{
+	power_timeline_record(POWER_TIMELINE_BRIDGE_RESET);
+	now_usecs += 300 * USECS_PER_MSEC;
+
+	assert_in_range(timed_wait(POWER_TIMELINE_BRIDGE_RESET, BRIDGE_DELAY_USECS), 0,
+			2 * TIMER_READ_USECS);
+}
+
+static void test_power_timeline_rerecord(void **state)
+{
+	uint64_t waited;
+
+	power_timeline_record(POWER_TIMELINE_BRIDGE_RESET);
+	now_usecs += 300 * USECS_PER_MSEC;
+	/* The line was toggled again, the delay starts over. */
+	power_timeline_record(POWER_TIMELINE_BRIDGE_RESET);
+
+	waited = timed_wait(POWER_TIMELINE_BRIDGE_RESET, BRIDGE_DELAY_USECS);
+	assert_in_range(waited, BRIDGE_DELAY_USECS - 2 * TIMER_READ_USECS,
+			BRIDGE_DELAY_USECS + 4 * TIMER_READ_USECS);
+}
+
+static void test_power_timeline_from_the_future(void **state)
+{
+	uint64_t waited;
+
+	/* E.g. a record left in CBMEM by a previous boot */
+	now_usecs += USECS_PER_SEC;
+	power_timeline_record(POWER_TIMELINE_BRIDGE_RESET);
+	now_usecs -= 2 * USECS_PER_SEC;
+
+	assert_int_equal(-1, power_timeline_elapsed_usecs(POWER_TIMELINE_BRIDGE_RESET));
+	waited = timed_wait(POWER_TIMELINE_BRIDGE_RESET, BRIDGE_DELAY_USECS);
+	assert_in_range(waited, BRIDGE_DELAY_USECS, BRIDGE_DELAY_USECS + 4 * TIMER_READ_USECS);
+}
+
+static void test_power_timeline_invalid_event(void **state)
+{
+	power_timeline_record(POWER_TIMELINE_NUM_EVENTS);
+	assert_int_equal(-1, power_timeline_elapsed_usecs(POWER_TIMELINE_NUM_EVENTS));
+	assert_in_range(timed_wait(POWER_TIMELINE_NUM_EVENTS, 100), 100,
+			100 + 4 * TIMER_READ_USECS);
+}
+
+static void test_power_timeline_before_cbmem(void **state)
+{
+	/* Events recorded before CBMEM is up stay local to the stage... */
+	cbmem_initialized = 0;
+	cbmem_entry_present = false;
+	power_timeline_record(POWER_TIMELINE_BRIDGE_RESET);
+	assert_false(cbmem_entry_present);
+	now_usecs += 4 * USECS_PER_MSEC;
+	assert_in_range(power_timeline_elapsed_usecs(POWER_TIMELINE_BRIDGE_RESET),
+			4 * USECS_PER_MSEC, 4 * USECS_PER_MSEC + 2 * TIMER_READ_USECS);
+
+	/* ...and once it is, new ones go there. */
+	cbmem_initialized = 1;
+	power_timeline_record(POWER_TIMELINE_BRIDGE_RESET);
+	assert_true(cbmem_entry_present);
+	assert_in_range(power_timeline_elapsed_usecs(POWER_TIMELINE_BRIDGE_RESET), 0,
+			2 * TIMER_READ_USECS);
+}
+
+int main(void)
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test_setup(test_power_timeline_not_recorded, setup_timeline),
+		cmocka_unit_test_setup(test_power_timeline_waits_for_remainder, setup_timeline),
+		cmocka_unit_test_setup(test_power_timeline_already_expired, setup_timeline),
+		cmocka_unit_test_setup(test_power_timeline_rerecord, setup_timeline),
+		cmocka_unit_test_setup(test_power_timeline_from_the_future, setup_timeline),
+		cmocka_unit_test_setup(test_power_timeline_invalid_event, setup_timeline),
+		cmocka_unit_test_setup(test_power_timeline_before_cbmem, setup_timeline),
+	};
+
+	return cb_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,204 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+
+#include <cbfs.h>
+#include <cbmem.h>
+#include <commonlib/rmodule-defs.h>
+#include <program_loading.h>
+#include <rmodule.h>
+#include <string.h>
+#include <tests/test.h>
+
+void prog_segment_loaded(uintptr_t start, size_t size, int flags)
+{
+}
+
+int prog_locate_hook(struct prog *prog)
+{
+	return 0;
+}
+
+void *cbmem_add(u32 id, u64 size)
+{
+	return NULL;
+}
+
+void *_cbfs_alloc(const char *name, cbfs_allocator_t allocator, void *arg,
+		  size_t *size_out, bool force_ro, enum cbfs_type *type)
+{
+	return NULL;
+}
+
+const void *cbfs_find_attr(const union cbfs_mdata *mdata, uint32_t attr_tag, size_t size_check)
+{
+	return NULL;
+}
+
+#define LINK_START	0x1000
+#define PAYLOAD_WORDS	16
+
+/* Words of the payload that hold addresses within the module. */
+static const size_t reloc_words[] = { 0, 1, 2, 7, 8, 12, 13, 15 };
+
+static union {
+	struct rmodule_header header;
+	uint8_t raw[sizeof(struct rmodule_header) + PAYLOAD_WORDS * sizeof(uintptr_t)
+		    + ARRAY_SIZE(reloc_words) * sizeof(uintptr_t)];
+} blob __aligned(sizeof(uintptr_t));
+
+static uintptr_t loaded[PAYLOAD_WORDS];
+
+static uintptr_t *blob_payload(void)
+{
+	return (uintptr_t *)&blob.raw[sizeof(struct rmodule_header)];
+}
+
+/* Build a module whose relocations are in the given format. */
+static void build_module(uint8_t version)
+{
+	struct rmodule_header *const hdr = &blob.header;
+	uintptr_t *const payload = blob_payload();
+	uint8_t *relocs = (uint8_t *)&payload[PAYLOAD_WORDS];
+	uintptr_t prev = 0;
+	size_t i;
+
+	memset(&blob, 0, sizeof(blob));
+	for (i = 0; i < PAYLOAD_WORDS; i++)
+		payload[i] = 0x5a5a0000 + i;
+	for (i = 0; i < ARRAY_SIZE(reloc_words); i++)
+		payload[reloc_words[i]] = LINK_START + 8 * i;
+
+	hdr->magic = RMODULE_MAGIC;
+	hdr->version = version;
+	hdr->payload_begin_offset = sizeof(*hdr);
+	hdr->payload_end_offset = hdr->payload_begin_offset + PAYLOAD_WORDS * sizeof(uintptr_t);
+	hdr->relocations_begin_offset = hdr->payload_end_offset;
+	hdr->module_link_start_address = LINK_START;
+	hdr->module_program_size = PAYLOAD_WORDS * sizeof(uintptr_t);
+	hdr->module_entry_point = LINK_START;
+
+	for (i = 0; i < ARRAY_SIZE(reloc_words); i++) {
+		const uintptr_t addr = LINK_START + reloc_words[i] * sizeof(uintptr_t);
+
+		if (version == RMODULE_VERSION_1) {
+			memcpy(relocs, &addr, sizeof(addr));
+			relocs += sizeof(addr);
+		} else {
+			relocs += rmodule_reloc_delta_encode(relocs, addr - prev);
+			prev = addr;
+		}
+	}
+	hdr->relocations_end_offset = relocs - blob.raw;
+}
+
+static void check_loaded(void)
+{
+	const uintptr_t adjustment = (uintptr_t)loaded - LINK_START;
+	size_t i, j = 0;
+
+	for (i = 0; i < PAYLOAD_WORDS; i++) {
+		if (j < ARRAY_SIZE(reloc_words) && reloc_words[j] == i) {
+			assert_int_equal(LINK_START + 8 * j + adjustment, loaded[i]);
+			j++;
+		} else {
+			assert_int_equal(0x5a5a0000 + i, loaded[i]);
+		}
+	}
+}
+
+static void test_rmodule_reloc_delta_round_trip(void **state)
+{
+	static const struct {
+		uint32_t delta;
+		size_t len;
+	} cases[] = {
+		{ 0, 1 }, { 1, 1 }, { 0x7f, 1 }, { 0x80, 2 }, { 0x3fff, 2 }, { 0x4000, 3 },
+		{ 0x1fffff, 3 }, { 0x200000, 4 }, { 0xfffffff, 4 }, { 0x10000000, 5 },
+		{ UINT32_MAX, 5 },
+	};
+	uint8_t buf[RMODULE_RELOC_DELTA_MAX_BYTES + 1];
+	uint32_t delta;
+	size_t i;
+
+	for (i = 0; i < ARRAY_SIZE(cases); i++) {
+		assert_int_equal(cases[i].len, rmodule_reloc_delta_encode(buf, cases[i].delta));
+		assert_int_equal(cases[i].len,
+				 rmodule_reloc_delta_decode(buf, buf + cases[i].len, &delta));
+		assert_int_equal(cases[i].delta, delta);
+
+		/* Truncated encodings are rejected. */
+		assert_int_equal(0, rmodule_reloc_delta_decode(buf, buf + cases[i].len - 1,
+							       &delta));
+	}
+
+	/* So are encodings that don't fit 32 bits. */
+	memset(buf, 0x80, sizeof(buf));
+	buf[RMODULE_RELOC_DELTA_MAX_BYTES] = 0;
+	assert_int_equal(0, rmodule_reloc_delta_decode(buf, buf + sizeof(buf), &delta));
+
+	/* Or that set bits above bit 31 in the last byte. */
+	memset(buf, 0xff, sizeof(buf));
+	buf[RMODULE_RELOC_DELTA_MAX_BYTES - 1] = 0x1f;
+	assert_int_equal(0, rmodule_reloc_delta_decode(buf, buf + sizeof(buf), &delta));
+}
+
+static void test_rmodule_load(void **state)
+{
+	const uint8_t version = *(uint8_t *)*state;
+	struct rmodule module;
+
+	build_module(version);
+	assert_int_equal(0, rmodule_parse(&blob, &module));
+	assert_int_equal(0, rmodule_load(loaded, &module));
+	check_loaded();
+	assert_ptr_equal(loaded, rmodule_entry(&module));
+}
+
+static void test_rmodule_compact_is_smaller(void **state)
+{
+	size_t v1_size, v2_size;
+
+	build_module(RMODULE_VERSION_1);
+	v1_size = blob.header.relocations_end_offset - blob.header.relocations_begin_offset;
+	build_module(RMODULE_VERSION_2);
+	v2_size = blob.header.relocations_end_offset - blob.header.relocations_begin_offset;
+
+	assert_int_equal(ARRAY_SIZE(reloc_words) * sizeof(uintptr_t), v1_size);
+	/* All deltas but the first one fit in a single byte. */
+	assert_int_equal(ARRAY_SIZE(reloc_words) + 1, v2_size);
+}
+
+static void test_rmodule_load_corrupt_relocs(void **state)
+{
+	struct rmodule module;
+
+	build_module(RMODULE_VERSION_2);
+	/* Cut the stream in the middle of the first (two byte) delta. */
+	blob.header.relocations_end_offset = blob.header.relocations_begin_offset + 1;
+	assert_int_equal(0, rmodule_parse(&blob, &module));
+	assert_int_equal(-1, rmodule_load(loaded, &module));
+}
+
+static void test_rmodule_parse_unknown_version(void **state)
+{
+	struct rmodule module;
+
+	build_module(RMODULE_VERSION_2);
+	blob.header.version = RMODULE_VERSION_2 + 1;
+	assert_int_equal(-1, rmodule_parse(&blob, &module));
+}
+
+int main(void)
+{
+	static const uint8_t v1 = RMODULE_VERSION_1;
+	static const uint8_t v2 = RMODULE_VERSION_2;
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(test_rmodule_reloc_delta_round_trip),
+		cmocka_unit_test_prestate(test_rmodule_load, (void *)&v1),
+		cmocka_unit_test_prestate(test_rmodule_load, (void *)&v2),
+		cmocka_unit_test(test_rmodule_compact_is_smaller),
+		cmocka_unit_test(test_rmodule_load_corrupt_relocs),
+		cmocka_unit_test(test_rmodule_parse_unknown_version),
+	};
+
+	return cb_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,239 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+
+#include <acpi/acpi.h>
+#include <arch/io.h>
+#include <cbmem.h>
+#include <commonlib/bsd/ipchksum.h>
+#include <s3_boot_script.h>
+#include <string.h>
+#include <tests/test.h>
+#include <timer.h>
+#include <timestamp.h>
+
+#define WAKE_VECTOR	((void *)0xfeedf00d)
+
+/* Enough for a header and a few entries */
+static uint8_t cbmem_buf[1024] __aligned(8);
+static bool cbmem_entry_present;
+static bool resuming;
+
+/* Port writes the replay performed, value << 16 | port */
+static uint32_t io_log[16];
+static size_t io_count;
+static uint32_t mmio_reg;
+
+static void io_write(uint32_t value, uint16_t port)
+{
+	assert_true(io_count < ARRAY_SIZE(io_log));
+	io_log[io_count++] = value << 16 | port;
+}
+
+void outb(uint8_t value, uint16_t port) { io_write(value, port); }
+void outw(uint16_t value, uint16_t port) { io_write(value, port); }
+void outl(uint32_t value, uint16_t port) { io_write(value & 0xffff, port); }
+
+int romstage_handoff_is_resume(void)
+{
+	return resuming;
+}
+
+void *acpi_find_wakeup_vector(void)
+{
+	return WAKE_VECTOR;
+}
+
+void timestamp_add_now(enum timestamp_id id) {}
+
+/* Polls time out after a few reads of the timer */
+void timer_monotonic_get(struct mono_time *mt)
+{
+	static uint64_t now_usecs;
+
+	mono_time_set_usecs(mt, now_usecs++);
+}
+
+void *cbmem_add(u32 id, u64 size)
+{
+	assert_int_equal(CBMEM_ID_S3_SCRIPT, id);
+	assert_true(size <= sizeof(cbmem_buf));
+	cbmem_entry_present = true;
+	return cbmem_buf;
+}
+
+const struct cbmem_entry *cbmem_entry_find(u32 id)
+{
+	assert_int_equal(CBMEM_ID_S3_SCRIPT, id);
+	return cbmem_entry_present ? (const struct cbmem_entry *)cbmem_buf : NULL;
+}
+
+void *cbmem_entry_start(const struct cbmem_entry *entry)
+{
+	return cbmem_buf;
+}
+
+u64 cbmem_entry_size(const struct cbmem_entry *entry)
+{
+	return sizeof(cbmem_buf);
+}
+
+static int setup_script(void **state)
+{
+	memset(cbmem_buf, 0, sizeof(cbmem_buf));
+	cbmem_entry_present = false;
+	resuming = false;
+	io_count = 0;
+	mmio_reg = 0;
+	return 0;
+}
+
+/* Normal boot: start recording, run the writes and commit the journal. */
+static void record_boot(void)
+{
+	assert_null(s3_script_resume());
+
+	s3_script_outb(0x12, 0x80);
+	s3_script_write32((uintptr_t)&mmio_reg, 0xcafe);
+	assert_int_equal(0, s3_script_poll32((uintptr_t)&mmio_reg, 0xff00, 0xca00, 10));
+	s3_script_outw(0x3456, 0x84);
+
+	s3_script_commit();
+}
+
+static struct s3_script_header *script(void)
+{
+	return (struct s3_script_header *)cbmem_buf;
+}
+
+static void test_record_and_replay(void **state)
+{
+	record_boot();
+	assert_true(cbmem_entry_present);
+	assert_int_equal(S3_SCRIPT_MAGIC, script()->magic);
+	assert_int_equal(4, script()->count);
+	assert_int_equal(ipchksum(script()->entries, 4 * sizeof(struct s3_script_entry)),
+			 script()->checksum);
+
+	/* S3 resume: the registers lost their contents */
+	io_count = 0;
+	mmio_reg = 0;
+	resuming = true;
+	assert_ptr_equal(WAKE_VECTOR, s3_script_resume());
+	assert_int_equal(0xcafe, mmio_reg);
+	assert_int_equal(2, io_count);
+	assert_int_equal(0x12 << 16 | 0x80, io_log[0]);
+	assert_int_equal(0x3456 << 16 | 0x84, io_log[1]);
+}
+
+static void test_empty_journal(void **state)
+{
+	struct s3_script_header empty = {
+		.magic = S3_SCRIPT_MAGIC,
+		.version = S3_SCRIPT_VERSION,
+		.entry_size = sizeof(struct s3_script_entry),
+		.count = 0,
+		.checksum = ipchksum(NULL, 0),
+	};
+
+	/* Nothing recorded, nothing committed */
+	assert_null(s3_script_resume());
+	s3_script_commit();
+	assert_false(cbmem_entry_present);
+
+	resuming = true;
+	assert_null(s3_script_resume());
+
+	/* An empty journal from elsewhere doesn't allow the fast path either */
+	assert_int_equal(CB_ERR, s3_script_replay(&empty, sizeof(empty)));
+}
+
+static void test_checksum_mismatch(void **state)
+{
+	record_boot();
+	script()->entries[1].value ^= 1;
+
+	io_count = 0;
+	mmio_reg = 0;
+	resuming = true;
+	assert_null(s3_script_resume());
+	/* Nothing was replayed */
+	assert_int_equal(0, io_count);
+	assert_int_equal(0, mmio_reg);
+}
+
+static void test_invalid_header(void **state)
+{
+	struct s3_script_header saved;
+
+	record_boot();
+	saved = *script();
+
+	script()->magic ^= 1;
+	assert_int_equal(CB_ERR, s3_script_replay(script(), sizeof(cbmem_buf)));
+	*script() = saved;
+
+	script()->version++;
+	assert_int_equal(CB_ERR, s3_script_replay(script(), sizeof(cbmem_buf)));
+	*script() = saved;
+
+	script()->entry_size--;
+	assert_int_equal(CB_ERR, s3_script_replay(script(), sizeof(cbmem_buf)));
+	*script() = saved;
+
+	/* More entries than fit in the CBMEM entry */
+	script()->count = sizeof(cbmem_buf) / sizeof(struct s3_script_entry) + 1;
+	assert_int_equal(CB_ERR, s3_script_replay(script(), sizeof(cbmem_buf)));
+	*script() = saved;
+
+	assert_int_equal(CB_ERR, s3_script_replay(script(), sizeof(*script()) - 1));
+	assert_int_equal(CB_SUCCESS, s3_script_replay(script(), sizeof(cbmem_buf)));
+}
+
+static void test_poll_timeout(void **state)
+{
+	record_boot();
+
+	/* The condition that held while recording never comes true on resume */
+	script()->entries[2].value = 0xbe00;
+	script()->checksum = ipchksum(script()->entries,
+				      script()->count * sizeof(struct s3_script_entry));
+	io_count = 0;
+	assert_int_equal(CB_ERR, s3_script_replay(script(), sizeof(cbmem_buf)));
+	/* Replay stops at the poll */
+	assert_int_equal(1, io_count);
+}
+
+static void test_invalid_entry(void **state)
+{
+	record_boot();
+	script()->entries[0].width = 3;
+	script()->checksum = ipchksum(script()->entries,
+				      script()->count * sizeof(struct s3_script_entry));
+
+	assert_int_equal(CB_ERR, s3_script_replay(script(), sizeof(cbmem_buf)));
+}
+
+static void test_overflow(void **state)
+{
+	int i;
+
+	assert_null(s3_script_resume());
+	for (i = 0; i <= CONFIG_S3_BOOT_SCRIPT_ENTRIES; i++)
+		s3_script_outb(i, 0x80);
+	s3_script_commit();
+	assert_false(cbmem_entry_present);
+}
+
+int main(void)
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test_setup(test_record_and_replay, setup_script),
+		cmocka_unit_test_setup(test_empty_journal, setup_script),
+		cmocka_unit_test_setup(test_checksum_mismatch, setup_script),
+		cmocka_unit_test_setup(test_invalid_header, setup_script),
+		cmocka_unit_test_setup(test_poll_timeout, setup_script),
+		cmocka_unit_test_setup(test_invalid_entry, setup_script),
+		cmocka_unit_test_setup(test_overflow, setup_script),
+	};
+
+	return cb_run_group_tests(tests, NULL, NULL);
+}
@@ -48,6 +48,8 @@ static struct param {
 	const char *bootblock;
 	const char *ignore_sections;
 	const char *ucode_region;
+	/* Image whose file offsets add commands try to keep */
+	const char *reference_image;
 	uint64_t u64val;
 	uint32_t type;
 	uint32_t baseaddress;
@@ -863,6 +865,59 @@ static int add_topswap_bootblock(struct buffer *buffer, uint32_t *offset)
 	return convert_region_offset(buffer_size(buffer), offset);
 }
 
+/*
+ * Return the content offset of |name| in the same region of the
+ * --keep-offsets image, or 0 if it has no such file.
+ */
+static uint32_t reference_content_offset(const char *name)
+{
+	partitioned_file_t *file;
+	struct cbfs_image image;
+	struct cbfs_file *entry;
+	struct buffer region;
+	uint32_t offset = 0;
+
+	file = partitioned_file_reopen(param.reference_image, false);
+	if (!file)
+		return 0;
+
+	if (partitioned_file_read_region(&region, file, param.region_name) &&
+	    region.size == buffer_size(param.image_region) &&
+	    !cbfs_image_from_buffer(&image, &region, param.headeroffset)) {
+		entry = cbfs_get_entry(&image, name);
+		if (entry)
+			offset = cbfs_get_entry_addr(&image, entry) +
+				 be32toh(entry->offset);
+	}
+
+	partitioned_file_close(file);
+	return offset;
+}
+
+/* Check if a file with |header_size| bytes of metadata fits at |content_offset|. */
+static bool cbfs_offset_is_free(struct cbfs_image *image, uint32_t content_offset,
+				uint32_t header_size, size_t size)
+{
+	struct cbfs_file *entry;
+
+	cbfs_legacy_walk(image, cbfs_merge_empty_entry, NULL);
+
+	for (entry = cbfs_find_first_entry(image);
+	     entry && cbfs_is_valid_entry(image, entry);
+	     entry = cbfs_find_next_entry(image, entry)) {
+		if (be32toh(entry->type) != CBFS_TYPE_NULL)
+			continue;
+
+		uint32_t addr = cbfs_get_entry_addr(image, entry);
+		uint32_t addr_next = cbfs_get_entry_addr(image,
+					cbfs_find_next_entry(image, entry));
+		if (addr + header_size <= content_offset &&
+		    content_offset + size <= addr_next)
+			return true;
+	}
+	return false;
+}
+
 static int cbfs_add_component(const char *filename,
 			      const char *name,
 			      uint32_t headeroffset,
@@ -882,7 +937,10 @@ static int cbfs_add_component(const char *filename,
 	 * 3. If --align was passed and the offset is still undecided at this point,
 	 *    do_cbfs_locate() is called to find an appropriately aligned location.
 	 *
-	 * 4. If |offset| is still 0 at the end, cbfs_add_entry() will find the first available
+	 * 4. If --keep-offsets was passed, the offset is still undecided and the file was
+	 *    present in the reference image, its old location is used if it is still free.
+	 *
+	 * 5. If |offset| is still 0 at the end, cbfs_add_entry() will find the first available
 	 *    location that fits.
 	 */
 	uint32_t offset = param.baseaddress_assigned ? param.baseaddress : 0;
@@ -1028,6 +1086,16 @@ static int cbfs_add_component(const char *filename,
 			goto error;
 	}
 
+	if (!offset && param.reference_image) {
+		uint32_t old_offset = reference_content_offset(name);
+
+		if (old_offset && cbfs_offset_is_free(&image, old_offset,
+					be32toh(header->offset), buffer_size(&buffer))) {
+			INFO("Keeping '%s' at offset 0x%x\n", name, old_offset);
+			offset = old_offset;
+		}
+	}
+
 	if (cbfs_add_entry(&image, &buffer, offset, header, len_align) != 0) {
 		ERROR("Failed to add '%s' into ROM image.\n", filename);
 		goto error;
@@ -1756,6 +1824,77 @@ static int cbfs_copy(void)
 	return cbfs_copy_instance(&src_image, param.image_region);
 }
 
+static int cbfs_delta(void)
+{
+	const size_t block_size = param.size ? param.size : 4 * KiB;
+	const enum vb2_hash_algorithm algo = param.hash != VB2_HASH_INVALID ?
+					     param.hash : VB2_HASH_SHA256;
+	const struct buffer *new_region = param.image_region;
+	partitioned_file_t *old_file;
+	struct buffer old_region;
+	bool same_layout = false;
+	size_t changed = 0;
+	size_t total = 0;
+	int ret = 1;
+
+	if (!param.filename) {
+		ERROR("You need to specify -f/--filename.\n");
+		return 1;
+	}
+
+	if (!IS_POWER_OF_2(block_size)) {
+		ERROR("Erase block size 0x%zx is not a power of 2.\n", block_size);
+		return 1;
+	}
+
+	old_file = partitioned_file_reopen(param.filename, false);
+	if (!old_file)
+		return 1;
+
+	/* A region that moved or was resized has to be rewritten as a whole */
+	if (partitioned_file_read_region(&old_region, old_file, param.region_name))
+		same_layout = old_region.offset == new_region->offset &&
+			      old_region.size == new_region->size;
+	if (!same_layout)
+		WARN("Region '%s' has a different layout in '%s', reporting all of it.\n",
+		     param.region_name, param.filename);
+
+	printf("region\t%s\t0x%zx\t0x%zx\n", param.region_name,
+	       new_region->offset, new_region->size);
+
+	/* Blocks are aligned to the flash, not to the region */
+	const size_t start = new_region->offset;
+	const size_t end = start + new_region->size;
+	for (size_t block = ALIGN_DOWN(start, block_size); block < end;
+	     block += block_size) {
+		const size_t from = MAX(block, start);
+		const size_t size = MIN(block + block_size, end) - from;
+		const char *data = new_region->data + (from - start);
+		struct vb2_hash hash;
+
+		total++;
+		if (same_layout && !memcmp(data, old_region.data + (from - start), size))
+			continue;
+
+		if (vb2_hash_calculate(false, data, size, algo, &hash)) {
+			ERROR("Failed to hash block at 0x%zx.\n", from);
+			goto out;
+		}
+		printf("block\t0x%zx\t0x%zx\t%s:", from, size,
+		       vb2_get_hash_algorithm_name(algo));
+		for (size_t i = 0; i < vb2_digest_size(algo); i++)
+			printf("%02x", hash.raw[i]);
+		printf("\n");
+		changed++;
+	}
+
+	printf("changed\t%zu\t%zu\n", changed, total);
+	ret = 0;
+out:
+	partitioned_file_close(old_file);
+	return ret;
+}
+
 static int cbfs_compact(void)
 {
 	struct cbfs_image image;
@@ -1811,6 +1950,7 @@ static const struct command commands[] = {
 	{"compact", "r:h?", cbfs_compact, true, true},
 	{"copy", "r:R:h?", cbfs_copy, true, true},
 	{"create", "M:r:s:B:b:H:o:m:vh?", cbfs_create, true, true},
+	{"delta", "r:f:s:A:vh?", cbfs_delta, true, false},
 	{"extract", "H:r:m:n:f:Uvh?", cbfs_extract, true, false},
 	{"layout", "wvh?", cbfs_layout, false, false},
 	{"print", "H:r:vkh?", cbfs_print, true, false},
@@ -1826,6 +1966,7 @@ enum {
 	LONGOPT_START = 256,
 	LONGOPT_IBB = LONGOPT_START,
 	LONGOPT_MMAP,
+	LONGOPT_KEEP_OFFSETS,
 	LONGOPT_END,
 };
 
@@ -1868,6 +2009,7 @@ static struct option long_options[] = {
 	{"unprocessed",   no_argument,       0, 'U' },
 	{"ibb",           no_argument,       0, LONGOPT_IBB },
 	{"mmap",          required_argument, 0, LONGOPT_MMAP },
+	{"keep-offsets",  required_argument, 0, LONGOPT_KEEP_OFFSETS },
 	{NULL,            0,                 0,  0  }
 };
 
@@ -1968,6 +2110,7 @@ static void usage(char *name)
 	     "  -F               Force action\n"
 	     "  -g               Generate position and alignment arguments\n"
 	     "  -U               Unprocessed; don't decompress or make ELF\n"
+	     "  --keep-offsets FILE  Place added files where FILE had them\n"
 	     "  -v               Provide verbose output (-v=INFO -vv=DEBUG output)\n"
 	     "  -h               Display this help message\n\n"
 	     "COMMANDs:\n"
@@ -2010,6 +2153,9 @@ static void usage(char *name)
 			"Create a legacy ROM file with CBFS master header*\n"
 	     " create -M flashmap [-r list,of,regions,containing,cbfses]   "
 			"Create a new-style partitioned firmware image\n"
+	     " delta [-r image,regions] -f OLD-FILE [-s erase-block-size] \\\n"
+	     "        [-A hash]                                            "
+			"List erase blocks changed since OLD-FILE\n"
 	     " layout [-w]                                                 "
 			"List mutable (or, with -w, readable) image regions\n"
 	     " print [-r image,regions] [-k]                               "
@@ -2309,6 +2455,9 @@ int main(int argc, char **argv)
 				if (decode_mmap_arg(optarg))
 					return 1;
 				break;
+			case LONGOPT_KEEP_OFFSETS:
+				param.reference_image = optarg;
+				break;
 			case 'h':
 			case '?':
 				usage(argv[0]);
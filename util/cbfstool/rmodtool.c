@@ -9,10 +9,11 @@
 #include "common.h"
 #include "rmodule.h"
 
-static const char *optstring  = "i:o:vh?";
+static const char *optstring  = "i:o:cvh?";
 static struct option long_options[] = {
 	{"inelf",        required_argument, 0, 'i' },
 	{"outelf",       required_argument, 0, 'o' },
+	{"compact-relocs", no_argument,     0, 'c' },
 	{"verbose",      no_argument,       0, 'v' },
 	{"help",         no_argument,       0, 'h' },
 	{NULL,           0,                 0,  0  }
@@ -22,7 +23,10 @@ static void usage(char *name)
 {
 	printf(
 		"rmodtool: utility for creating rmodules\n\n"
-		"USAGE: %s [-h] [-v] <-i|--inelf name> <-o|--outelf name>\n",
+		"USAGE: %s [-h] [-v] [-c|--compact-relocs] <-i|--inelf name> "
+		"<-o|--outelf name>\n\n"
+		"  -c|--compact-relocs  Store relocations delta encoded "
+		"(rmodule version 2)\n",
 		name
 	);
 }
@@ -34,6 +38,7 @@ int main(int argc, char *argv[])
 	struct buffer elfout;
 	const char *input_file = NULL;
 	const char *output_file = NULL;
+	bool compact_relocs = false;
 
 	if (argc < 3) {
 		usage(argv[0]);
@@ -58,6 +63,9 @@ int main(int argc, char *argv[])
 		case 'o':
 			output_file = optarg;
 			break;
+		case 'c':
+			compact_relocs = true;
+			break;
 		case 'v':
 			verbose++;
 			break;
@@ -76,7 +84,7 @@ int main(int argc, char *argv[])
 		return 1;
 	}
 
-	if (rmodule_create(&elfin, &elfout)) {
+	if (rmodule_create(&elfin, &elfout, compact_relocs)) {
 		ERROR("Unable to create rmodule from '%s'.\n", input_file);
 		return 1;
 	}
@@ -494,9 +494,41 @@ add_section(struct elf_writer *ew, struct buffer *data, const char *name,
 	return ret;
 }
 
+static int
+write_relocs(const struct rmod_context *ctx, struct buffer *relocs, int bit64,
+	     bool compact_relocs)
+{
+	uint8_t delta[RMODULE_RELOC_DELTA_MAX_BYTES];
+	Elf64_Addr prev = 0;
+
+	for (unsigned i = 0; i < ctx->nrelocs; i++) {
+		const Elf64_Addr addr = ctx->emitted_relocs[i];
+
+		if (!compact_relocs) {
+			if (bit64)
+				ctx->xdr->put64(relocs, addr);
+			else
+				ctx->xdr->put32(relocs, addr);
+			continue;
+		}
+
+		/* The relocations are sorted, so the deltas are positive. */
+		if (addr - prev > UINT32_MAX) {
+			ERROR("Relocation 0x%llx too far from the previous one.\n",
+			      (long long)addr);
+			return -1;
+		}
+		bputs(relocs, delta,
+		      rmodule_reloc_delta_encode(delta, addr - prev));
+		prev = addr;
+	}
+
+	return 0;
+}
+
 static int
 write_elf(const struct rmod_context *ctx, const struct buffer *in,
-	  struct buffer *out)
+	  struct buffer *out, bool compact_relocs)
 {
 	int ret;
 	int bit64;
@@ -531,7 +563,9 @@ write_elf(const struct rmod_context *ctx, const struct buffer *in,
 
 	/* Create buffer for header and relocations. */
 	rmod_data_size = sizeof(struct rmodule_header);
-	if (bit64)
+	if (compact_relocs)
+		rmod_data_size += ctx->nrelocs * RMODULE_RELOC_DELTA_MAX_BYTES;
+	else if (bit64)
 		rmod_data_size += ctx->nrelocs * sizeof(Elf64_Addr);
 	else
 		rmod_data_size += ctx->nrelocs * sizeof(Elf32_Addr);
@@ -562,9 +596,17 @@ write_elf(const struct rmod_context *ctx, const struct buffer *in,
 		return -1;
 	}
 
+	/* Write the relocations. */
+	if (write_relocs(ctx, &relocs, bit64, compact_relocs)) {
+		buffer_delete(&rmod_data);
+		elf_writer_destroy(ew);
+		return -1;
+	}
+
 	/* Write out rmodule_header. */
 	ctx->xdr->put16(&rmod_header, RMODULE_MAGIC);
-	ctx->xdr->put8(&rmod_header, RMODULE_VERSION_1);
+	ctx->xdr->put8(&rmod_header, compact_relocs ? RMODULE_VERSION_2 :
+							RMODULE_VERSION_1);
 	ctx->xdr->put8(&rmod_header, 0);
 	/* payload_begin_offset */
 	loc = sizeof(struct rmodule_header);
@@ -575,10 +617,7 @@ write_elf(const struct rmod_context *ctx, const struct buffer *in,
 	/* relocations_begin_offset */
 	ctx->xdr->put32(&rmod_header, loc);
 	/* relocations_end_offset */
-	if (bit64)
-		loc += ctx->nrelocs * sizeof(Elf64_Addr);
-	else
-		loc += ctx->nrelocs * sizeof(Elf32_Addr);
+	loc += buffer_size(&relocs);
 	ctx->xdr->put32(&rmod_header, loc);
 	/* module_link_start_address */
 	ctx->xdr->put32(&rmod_header, ctx->phdr->p_vaddr);
@@ -600,14 +639,6 @@ write_elf(const struct rmod_context *ctx, const struct buffer *in,
 	ctx->xdr->put32(&rmod_header, 0);
 	ctx->xdr->put32(&rmod_header, 0);
 
-	/* Write the relocations. */
-	for (unsigned i = 0; i < ctx->nrelocs; i++) {
-		if (bit64)
-			ctx->xdr->put64(&relocs, ctx->emitted_relocs[i]);
-		else
-			ctx->xdr->put32(&relocs, ctx->emitted_relocs[i]);
-	}
-
 	total_size = 0;
 	addr = 0;
 
@@ -742,7 +773,8 @@ void rmodule_cleanup(struct rmod_context *ctx)
 	parsed_elf_destroy(&ctx->pelf);
 }
 
-int rmodule_create(const struct buffer *elfin, struct buffer *elfout)
+int rmodule_create(const struct buffer *elfin, struct buffer *elfout,
+		   bool compact_relocs)
 {
 	struct rmod_context ctx;
 	int ret = -1;
@@ -756,7 +788,7 @@ int rmodule_create(const struct buffer *elfin, struct buffer *elfout)
 	if (populate_rmodule_info(&ctx))
 		goto out;
 
-	if (write_elf(&ctx, elfin, elfout))
+	if (write_elf(&ctx, elfin, elfout, compact_relocs))
 		goto out;
 
 	ret = 0;
@@ -812,7 +844,8 @@ int rmodule_stage_to_elf(Elf64_Ehdr *ehdr, struct buffer *buff)
 	/* Indicate that file is not an rmodule if initial checks fail. */
 	if (rmod.magic != RMODULE_MAGIC)
 		return 1;
-	if (rmod.version != RMODULE_VERSION_1)
+	if (rmod.version != RMODULE_VERSION_1 &&
+	    rmod.version != RMODULE_VERSION_2)
 		return 1;
 
 	if (rmod.payload_begin_offset > input_sz ||
@@ -899,10 +932,25 @@ int rmodule_stage_to_elf(Elf64_Ehdr *ehdr, struct buffer *buff)
 	ssize_t relocs_sz = rmod.relocations_end_offset;
 	relocs_sz -= rmod.relocations_begin_offset;
 	buffer_splice(&reader, buff, rmod.relocations_begin_offset, relocs_sz);
+	Elf64_Addr addr = 0;
 	while (relocs_sz > 0) {
-		Elf64_Addr addr;
-
-		if (bit64) {
+		if (rmod.version == RMODULE_VERSION_2) {
+			const uint8_t *p = buffer_get(&reader);
+			uint32_t delta;
+			size_t len;
+
+			len = rmodule_reloc_delta_decode(p, p + relocs_sz,
+							 &delta);
+			if (!len) {
+				ERROR("Corrupt relocation after 0x%llx.\n",
+				      (long long)addr);
+				elf_writer_destroy(ew);
+				return -1;
+			}
+			buffer_seek(&reader, len);
+			relocs_sz -= len;
+			addr += delta;
+		} else if (bit64) {
 			relocs_sz -= sizeof(Elf64_Addr);
 			addr = xdr->get64(&reader);
 		} else {
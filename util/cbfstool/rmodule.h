@@ -3,6 +3,8 @@
 #ifndef TOOL_RMODULE_H
 #define TOOL_RMODULE_H
 
+#include <stdbool.h>
+
 #include "elfparsing.h"
 #include "common.h"
 
@@ -55,9 +57,12 @@ struct reloc_filter {
 
 /*
  * Parse an ELF file within the elfin buffer and fill in the elfout buffer
- * with a created rmodule in ELF format. Return 0 on success, < 0 on error.
+ * with a created rmodule in ELF format. With compact_relocs the relocations
+ * are stored delta encoded (RMODULE_VERSION_2). Return 0 on success, < 0 on
+ * error.
  */
-int rmodule_create(const struct buffer *elfin, struct buffer *elfout);
+int rmodule_create(const struct buffer *elfin, struct buffer *elfout,
+		   bool compact_relocs);
 
 /*
  * Initialize an rmodule context from an ELF buffer. Returns 0 on scucess, < 0
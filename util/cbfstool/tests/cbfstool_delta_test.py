@@ -0,0 +1,221 @@
+#!/usr/bin/python3
+# SPDX-License-Identifier: BSD-3-Clause
+
+import hashlib
+import os
+import pytest
+import random
+import subprocess
+
+BLOCK_SIZE = 0x1000
+
+# COREBOOT holds a CBFS, RW_DATA is raw
+FMD = """FLASH@0 0x10000 {
+	FMAP@0 0x1000
+	COREBOOT(CBFS)@0x1000 0x8000
+	RW_DATA@0x9000 0x7000
+}
+"""
+
+# Same size, but RW_DATA moved
+FMD_MOVED = """FLASH@0 0x10000 {
+	FMAP@0 0x1000
+	COREBOOT(CBFS)@0x1000 0x8000
+	RW_DATA@0xa000 0x6000
+}
+"""
+
+
+@pytest.fixture(scope="session")
+def cbfstool_path(request):
+    exe = request.config.option.cbfstool_path
+    assert os.path.exists(exe)
+    return exe
+
+
+@pytest.fixture(scope="session")
+def fmaptool_path(request):
+    exe = request.config.option.fmaptool_path
+    assert os.path.exists(exe)
+    return exe
+
+
+def random_file(tmp_path, name: str, size: int, seed: int) -> str:
+    path = tmp_path / name
+    path.write_bytes(random.Random(seed).randbytes(size))
+    return str(path)
+
+
+def create_image(cbfstool_path, fmaptool_path, tmp_path, name: str,
+                 fmd: str = FMD) -> str:
+    fmd_path = tmp_path / (name + ".fmd")
+    fmap_path = tmp_path / (name + ".fmap")
+    fmd_path.write_text(fmd)
+    subprocess.run([fmaptool_path, fmd_path, fmap_path], check=True,
+                   capture_output=True)
+    path = str(tmp_path / name)
+    subprocess.run([cbfstool_path, path, 'create', '-M', fmap_path],
+                   check=True, capture_output=True)
+    return path
+
+
+def cbfs_add(cbfstool_path, image: str, file: str, name: str,
+             keep_offsets: str = None) -> None:
+    cmd = [cbfstool_path, image, 'add', '-f', file, '-n', name, '-t', 'raw']
+    if keep_offsets:
+        cmd += ['--keep-offsets', keep_offsets]
+    subprocess.run(cmd, check=True, capture_output=True)
+
+
+def cbfs_offsets(cbfstool_path, image: str) -> dict:
+    output = subprocess.run([cbfstool_path, image, 'print', '-k'],
+                            capture_output=True, check=True)
+    offsets = {}
+    for line in output.stdout.decode("utf-8").splitlines():
+        fields = line.split("\t")
+        if len(fields) > 2 and fields[0] != "Name" and not fields[0].startswith("["):
+            offsets[fields[0]] = int(fields[1], 0)
+    return offsets
+
+
+def delta(cbfstool_path, new: str, old: str, *args) -> dict:
+    output = subprocess.run([cbfstool_path, new, 'delta', '-f', old] + list(args),
+                            capture_output=True, check=True)
+    manifest = {}
+    region = None
+    for line in output.stdout.decode("utf-8").splitlines():
+        fields = line.split("\t")
+        if fields[0] == "region":
+            region = fields[1]
+            manifest[region] = {"offset": int(fields[2], 0),
+                                "size": int(fields[3], 0),
+                                "blocks": []}
+        elif fields[0] == "block":
+            manifest[region]["blocks"].append(
+                (int(fields[1], 0), int(fields[2], 0), fields[3]))
+        elif fields[0] == "changed":
+            manifest[region]["changed"] = int(fields[1])
+            manifest[region]["total"] = int(fields[2])
+        else:
+            assert False, line
+    return manifest
+
+
+def patch(image: str, offset: int, data: bytes) -> None:
+    with open(image, "r+b") as fd:
+        fd.seek(offset)
+        fd.write(data)
+
+
+@pytest.fixture(scope="function")
+def images(cbfstool_path, fmaptool_path, tmp_path):
+    old = create_image(cbfstool_path, fmaptool_path, tmp_path, "old.rom")
+    cbfs_add(cbfstool_path, old, random_file(tmp_path, "a", 0x1800, 1), "a")
+    cbfs_add(cbfstool_path, old, random_file(tmp_path, "b", 0x2800, 2), "b")
+    new = str(tmp_path / "new.rom")
+    with open(old, "rb") as src, open(new, "wb") as dst:
+        dst.write(src.read())
+    return old, new
+
+
+def test_identical_images(cbfstool_path, images):
+    old, new = images
+    manifest = delta(cbfstool_path, new, old, '-r', 'COREBOOT,RW_DATA')
+
+    assert manifest["COREBOOT"]["changed"] == 0
+    assert manifest["COREBOOT"]["total"] == 8
+    assert manifest["RW_DATA"]["changed"] == 0
+    assert manifest["RW_DATA"]["total"] == 7
+
+
+def test_changed_blocks(cbfstool_path, images):
+    old, new = images
+    patch(new, 0x9000 + 0x1234, b"\x55")
+    patch(new, 0x9000 + 0x5ffe, b"\x55\x55")
+
+    manifest = delta(cbfstool_path, new, old, '-r', 'RW_DATA')
+    blocks = manifest["RW_DATA"]["blocks"]
+    assert manifest["RW_DATA"]["changed"] == 2
+    assert [(offset, size) for offset, size, _ in blocks] == [
+        (0xa000, BLOCK_SIZE), (0xe000, BLOCK_SIZE)]
+
+    # The hashes describe the new contents
+    with open(new, "rb") as fd:
+        data = fd.read()
+    for offset, size, digest in blocks:
+        algo, value = digest.split(":")
+        assert algo == "SHA256"
+        assert value == hashlib.sha256(data[offset:offset + size]).hexdigest()
+
+
+def test_erase_block_size(cbfstool_path, images):
+    old, new = images
+    patch(new, 0x9000 + 0x1234, b"\x55")
+
+    manifest = delta(cbfstool_path, new, old, '-r', 'RW_DATA', '-s', '64K')
+    # A 64K erase block covers the whole flash, clipped to the region
+    assert manifest["RW_DATA"]["total"] == 1
+    assert manifest["RW_DATA"]["blocks"][0][:2] == (0x9000, 0x7000)
+
+    manifest = delta(cbfstool_path, new, old, '-r', 'RW_DATA', '-s', '0x100')
+    assert manifest["RW_DATA"]["total"] == 0x70
+    assert manifest["RW_DATA"]["blocks"][0][:2] == (0xa200, 0x100)
+
+    result = subprocess.run([cbfstool_path, new, 'delta', '-f', old,
+                             '-r', 'RW_DATA', '-s', '3000'], capture_output=True)
+    assert result.returncode != 0
+
+
+def test_moved_region(cbfstool_path, fmaptool_path, tmp_path, images):
+    old, _ = images
+    new = create_image(cbfstool_path, fmaptool_path, tmp_path, "moved.rom",
+                       FMD_MOVED)
+
+    manifest = delta(cbfstool_path, new, old, '-r', 'RW_DATA')
+    assert manifest["RW_DATA"]["offset"] == 0xa000
+    assert manifest["RW_DATA"]["changed"] == 6
+    assert manifest["RW_DATA"]["total"] == 6
+
+
+def test_keep_offsets(cbfstool_path, fmaptool_path, tmp_path, images):
+    old, _ = images
+    old_offsets = cbfs_offsets(cbfstool_path, old)
+
+    # 'a' shrinks, 'b' is unchanged
+    a = random_file(tmp_path, "a2", 0x800, 3)
+    b = str(tmp_path / "b")
+
+    packed = create_image(cbfstool_path, fmaptool_path, tmp_path, "packed.rom")
+    cbfs_add(cbfstool_path, packed, a, "a")
+    cbfs_add(cbfstool_path, packed, b, "b")
+
+    kept = create_image(cbfstool_path, fmaptool_path, tmp_path, "kept.rom")
+    cbfs_add(cbfstool_path, kept, a, "a", keep_offsets=old)
+    cbfs_add(cbfstool_path, kept, b, "b", keep_offsets=old)
+
+    # 'b' moves up behind the smaller 'a' unless its old offset is kept
+    assert cbfs_offsets(cbfstool_path, packed)["b"] != old_offsets["b"]
+    kept_offsets = cbfs_offsets(cbfstool_path, kept)
+    assert kept_offsets["a"] == old_offsets["a"]
+    assert kept_offsets["b"] == old_offsets["b"]
+
+    changed_packed = delta(cbfstool_path, packed, old)["COREBOOT"]["changed"]
+    changed_kept = delta(cbfstool_path, kept, old)["COREBOOT"]["changed"]
+    assert changed_kept < changed_packed
+
+
+def test_keep_offsets_falls_back(cbfstool_path, fmaptool_path, tmp_path, images):
+    old, _ = images
+    old_offsets = cbfs_offsets(cbfstool_path, old)
+
+    # 'a' grows into the space 'b' had, so 'b' has to go elsewhere
+    a = random_file(tmp_path, "a2", 0x3000, 4)
+    b = str(tmp_path / "b")
+
+    image = create_image(cbfstool_path, fmaptool_path, tmp_path, "new.rom")
+    cbfs_add(cbfstool_path, image, a, "a", keep_offsets=old)
+    cbfs_add(cbfstool_path, image, b, "b", keep_offsets=old)
+
+    offsets = cbfs_offsets(cbfstool_path, image)
+    assert offsets["a"] == old_offsets["a"]
+    assert offsets["b"] > old_offsets["b"]
@@ -10,3 +10,13 @@ def pytest_addoption(parser):
         type=pathlib.Path,
         default=(here / ".." / "elogtool").resolve(),
     )
+    parser.addoption(
+        "--cbfstool-path",
+        type=pathlib.Path,
+        default=(here / ".." / "cbfstool").resolve(),
+    )
+    parser.addoption(
+        "--fmaptool-path",
+        type=pathlib.Path,
+        default=(here / ".." / "fmaptool").resolve(),
+    )